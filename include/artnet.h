@@ -0,0 +1,46 @@
+#ifndef _ARTNET_H_
+#define _ARTNET_H_
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#define ARTNET_PORT 6454
+#define ARTNET_HEADER_SIZE 18 // ArtDmx header size, DMX data follows directly after it
+#define ARTNET_POLLREPLY_SIZE 239
+#define ARTNET_PROTOCOL_VERSION 14
+#define ARTNET_MAX_PORTS 4 // Output ports one ArtPollReply can describe
+
+class ArtNetNode {
+    public:
+        enum class opcode_t : uint16_t {none = 0x0000, poll = 0x2000, pollreply = 0x2100, dmx = 0x5000};
+        struct header_t {
+            opcode_t opcode;
+            uint8_t sequence;
+            uint16_t portaddress; // 15 bit Port-Address: net (7 bits), subnet (4 bits), universe (4 bits)
+            uint16_t length; // Number of DMX slots following the header
+        };
+        ArtNetNode();
+        ArtNetNode(uint8_t net, uint8_t subnet, uint8_t universe);
+        void begin(const char * shortname, const char * longname);
+        void setPortAddress(uint8_t net, uint8_t subnet, uint8_t universe);
+        bool setPorts(int count);
+        int port();
+        uint16_t portAddress();
+        uint16_t receive();
+        size_t readDMX(uint8_t * dest, size_t size);
+        unsigned long dmxPackets();
+        static bool decodeHeader(const uint8_t * packet, size_t size, header_t & header);
+
+    protected:
+        WiFiUDP udp;
+        uint16_t port_address;
+        uint16_t pending; // DMX slots waiting to be read out of the current packet
+        int ports; // Outputs, on consecutive universes starting at port_address
+        int current_port; // Output the packet waiting for readDMX() is for
+        uint8_t last_sequence[ARTNET_MAX_PORTS];
+        unsigned long dmx_packets;
+        uint8_t reply[ARTNET_POLLREPLY_SIZE];
+        void buildPollReply(const char * shortname, const char * longname);
+        void sendPollReply(IPAddress destination);
+};
+#endif
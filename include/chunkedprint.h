@@ -0,0 +1,28 @@
+#ifndef _CHUNKEDPRINT_H_
+#define _CHUNKEDPRINT_H_
+#include <Arduino.h>
+
+#define HTTP_CHUNK_SIZE 512 // Bytes collected before a chunk is sent to the client
+
+class ChunkedPrint : public Print {
+    public:
+        ChunkedPrint(Print & target, bool chunked);
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t * data, size_t size) override;
+        using Print::write;
+        void flush() override;
+        void end();
+        size_t bytesSent();
+        unsigned long firstByteTime();
+
+    protected:
+        Print & out;
+        bool chunked; // Use HTTP/1.1 chunked transfer encoding, or just pass the data through (HTTP/1.0 clients)
+        uint8_t buffer[HTTP_CHUNK_SIZE];
+        size_t used;
+        size_t sent;
+        bool stalled; // A write came up short, the client isn't taking data. Nothing more is sent
+        unsigned long start_time;
+        unsigned long first_byte_time;
+};
+#endif
@@ -0,0 +1,45 @@
+#ifndef _CURVES_H_
+#define _CURVES_H_
+#include <Arduino.h>
+#include <Preferences.h>
+#include <atomic>
+#include <esp_dmx.h>
+#include "dmxframe.h"
+
+#define CURVE_MAX 8 // Curves that can be defined, curve 0 is always the straight line
+#define CURVE_POINTS 8 // Most points of a custom curve
+
+class ResponseCurves {
+    public:
+        struct curve_t { // Stored as is in flash
+            uint16_t gamma; // Exponent * 100, 100 is a straight line, 220 typical for LEDs
+            uint8_t min; // Output for input 0
+            uint8_t max; // Output for input 255
+            uint8_t points; // 0 for a gamma curve, otherwise the number of in/out points of a custom curve
+            uint8_t in[CURVE_POINTS]; // Ascending
+            uint8_t out[CURVE_POINTS];
+        };
+        ResponseCurves();
+        ResponseCurves(const char * name);
+        void begin();
+        bool define(int id, const curve_t & c);
+        bool assign(int first, int last, int id);
+        const curve_t & curve(int id);
+        int curveOf(int address);
+        int channels(int id);
+        int assigned();
+        const uint8_t * apply(const uint8_t * frame, int slots);
+        static bool parseGamma(const char * s, size_t length, uint16_t & gamma);
+
+    protected:
+        Preferences prefs;
+        const char * prefs_name; // NVS namespace, one per universe
+        curve_t curves[CURVE_MAX];
+        uint8_t map[DMXArraySize]; // Curve of each address
+        uint8_t luts[CURVE_MAX][256]; // Built from curves, never stored
+        uint8_t out[DMX_PACKET_SIZE]; // Transformed frame, start code at 0. DMX task only
+        std::atomic<int> used; // Addresses with a curve other than 0. None means apply() has nothing to do
+        void build(int id);
+        void count();
+};
+#endif
@@ -0,0 +1,44 @@
+#ifndef _DMXFRAME_H_
+#define _DMXFRAME_H_
+#include <Arduino.h>
+#include <atomic>
+#include <esp_dmx.h>
+
+#define DMXArraySize 512
+
+class DMXFrameBuffer {
+    public:
+        DMXFrameBuffer();
+        void begin();
+        uint8_t * beginWrite(TickType_t timeout);
+        void markDirty(int first, int count);
+        void endWrite();
+        const uint8_t * acquire(int & first, int & last);
+        const uint8_t * current();
+        int slotsUsed();
+        uint32_t version();
+        uint32_t slotVersion(int slot);
+
+    protected:
+        struct range_t {
+            uint16_t first; // First changed slot
+            uint16_t last; // One past the last changed slot, range is empty if last <= first
+        };
+        static const uint8_t fresh = 0x04; // Flag in middle telling the reader a new frame is waiting, the low bits are the index
+        static const uint32_t no_range = 0x0000ffff; // Packed empty range_t (first = 0xffff, last = 0)
+        uint8_t working[DMXArraySize]; // Producers' copy, slot 0 is DMX address 1. Protected by lock
+        uint8_t published[DMXArraySize]; // Working copy as of the last publish, to tell real changes from rewrites of the same value. Protected by lock
+        uint8_t frames[3][DMX_PACKET_SIZE]; // Complete packets including start code
+        range_t stale[3]; // Per frame: slots of the working copy changed since that frame was last written. Protected by lock
+        range_t changed; // Slots changed by the producer currently holding the lock
+        uint8_t back; // Frame the producers publish into next. Only touched while holding lock
+        uint8_t front; // Frame the reader is using. Only touched by the reader
+        std::atomic<uint8_t> middle; // Frame in the middle, swapped with back on publish and with front on acquire
+        std::atomic<uint32_t> dirty; // Packed range_t of slots the reader hasn't written out yet
+        std::atomic<uint16_t> used; // Highest slot ever marked dirty + 1
+        std::atomic<uint32_t> frame_version; // Frames published since boot. Only changed while holding lock
+        uint32_t slot_versions[DMXArraySize]; // Frame that last changed each slot, 0 for never. Protected by lock
+        SemaphoreHandle_t lock;
+        static void extend(range_t & r, range_t with);
+};
+#endif
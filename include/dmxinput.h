@@ -0,0 +1,48 @@
+#ifndef _DMXINPUT_H_
+#define _DMXINPUT_H_
+#include <Arduino.h>
+#include <atomic>
+#include <esp_dmx.h>
+#include "dmxframe.h"
+
+#define DMX_INPUT_TIMEOUT 1000 // ms without a good frame before the input counts as lost
+
+class DMXInput {
+    public:
+        enum class merge_t : uint8_t {htp, ltp};
+        DMXInput(dmx_port_t port);
+        void begin(int rx_pin);
+        bool receive(TickType_t timeout);
+        bool live();
+        int slots();
+        int framesPerSecond();
+        unsigned long frames();
+        unsigned long errors();
+        const uint8_t * current();
+        void setMerge(int address, merge_t mode);
+        merge_t getMerge(int address);
+        int merge(const uint8_t * network, int network_slots, uint8_t * out);
+        unsigned long mergeTime();
+        unsigned long mergeTimeMax();
+        void resetMergeTime();
+        static bool parseMerge(const char * name, size_t length, merge_t & mode);
+
+    protected:
+        dmx_port_t port;
+        DMXFrameBuffer buffer; // Hands received frames to the DMX task, same as the network producers do
+        volatile int slot_count; // Slots in the last good frame
+        volatile unsigned long last_frame; // millis() of the last good frame
+        volatile bool received; // Had at least one good frame
+        volatile int fps;
+        volatile unsigned long frame_total;
+        volatile unsigned long error_total;
+        int fps_count; // Input task only
+        unsigned long fps_start; // Input task only
+        std::atomic<uint32_t> ltp_bits[DMXArraySize / 32]; // One bit per address, set for LTP
+        uint8_t last_network[DMX_PACKET_SIZE]; // What each side sent last frame, to tell who moved a channel last. DMX task only
+        uint8_t last_input[DMX_PACKET_SIZE];
+        uint8_t owner[DMX_PACKET_SIZE]; // Per slot, 1 if the input moved it last (for LTP). DMX task only
+        volatile unsigned long merge_time; // us taken by the last merge
+        volatile unsigned long merge_time_max; // Worst case since boot or the last reset
+};
+#endif
@@ -0,0 +1,50 @@
+#ifndef _E131_H_
+#define _E131_H_
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#define E131_PORT 5568
+#define E131_HEADER_SIZE 126 // Root, framing and DMP layer up to and including the start code, DMX data follows directly after it
+#define E131_MAX_SOURCES 4 // Sources merged at the same time, any more are ignored until one times out
+#define E131_SOURCE_TIMEOUT 2500 // ms without packets before a source is considered lost (E1.31 network data loss)
+
+class E131Receiver {
+    public:
+        struct header_t {
+            const uint8_t * cid; // Points into the packet, 16 bytes
+            uint8_t priority;
+            uint8_t sequence;
+            uint8_t options;
+            uint16_t universe;
+            uint8_t startcode;
+            uint16_t length; // Number of DMX slots following the header
+        };
+        E131Receiver();
+        E131Receiver(uint16_t universe);
+        void begin();
+        void setUniverse(uint16_t universe);
+        uint16_t universe();
+        bool receive();
+        bool expire();
+        int merge(uint8_t * dest);
+        int sources();
+        static bool decodeHeader(const uint8_t * packet, size_t size, header_t & header);
+
+    protected:
+        struct source_t {
+            bool active;
+            uint8_t cid[16];
+            uint8_t priority;
+            uint8_t sequence;
+            unsigned long last_seen;
+            uint16_t length; // Slots sent in the last packet
+            uint8_t data[512];
+        };
+        WiFiUDP udp;
+        uint16_t universe_number;
+        bool running;
+        source_t source_list[E131_MAX_SOURCES];
+        int findSource(const uint8_t * cid);
+};
+#endif
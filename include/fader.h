@@ -0,0 +1,53 @@
+#ifndef _FADER_H_
+#define _FADER_H_
+#include <Arduino.h>
+#include <atomic>
+#include <esp_dmx.h>
+#include "dmxframe.h"
+
+#define FADE_QUEUE_SIZE 128 // Fade commands waiting for the DMX task
+#define FADE_ALL 0xffff // Command address meaning the whole universe (crossfade)
+
+class FadeEngine {
+    public:
+        enum class curve_t : uint8_t {linear, in, out, smooth};
+        FadeEngine();
+        void begin();
+        bool fade(int address, uint8_t target, unsigned long duration, curve_t curve);
+        void cancel(int address);
+        bool fading(int address);
+        bool crossfade(unsigned long duration, curve_t curve);
+        bool crossfading();
+        void update(const uint8_t * output);
+        void apply(uint8_t * output, const uint8_t * frame, unsigned long now);
+        int active();
+        static bool parseCurve(const char * name, size_t length, curve_t & curve);
+
+    protected:
+        struct command_t {
+            uint16_t address;
+            uint8_t target;
+            curve_t curve;
+            uint32_t duration; // ms, 0 cancels
+        };
+        struct fade_t {
+            uint16_t address;
+            uint8_t start;
+            uint8_t target;
+            curve_t curve;
+            uint32_t start_time;
+            uint32_t duration;
+            uint32_t rate; // 2^32 / duration, turns elapsed ms into 16 bit fixed point progress with a multiply
+        };
+        QueueHandle_t queue;
+        fade_t fades[DMXArraySize]; // Active fades, packed at the start. DMX task only
+        int16_t index[DMXArraySize]; // Where each address is in fades, -1 if it isn't fading. DMX task only
+        int count;
+        fade_t xfade; // Whole universe crossfade, from xfade_from to the frame. Only start_time, duration, rate and curve are used
+        volatile bool xfading;
+        uint8_t xfade_from[DMX_PACKET_SIZE]; // What was going out when the crossfade started, start code at 0 like the frames
+        std::atomic<uint32_t> fading_bits[DMXArraySize / 32]; // One bit per address, for other tasks to check cheaply
+        void remove(int i);
+        static uint32_t shape(curve_t curve, uint32_t p);
+};
+#endif
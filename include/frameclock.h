@@ -0,0 +1,51 @@
+#ifndef _FRAMECLOCK_H_
+#define _FRAMECLOCK_H_
+#include <Arduino.h>
+#include <esp_timer.h>
+#include <Preferences.h>
+#include <atomic>
+
+#define FRAME_RATE_MAX 830 // Frames/s. The standard wants at least 1204 us from one break to the next
+#define FRAME_CLOCK_SAMPLES 1024 // Frame intervals kept by one measurement
+#define FRAME_RATE_AUTO 0 // setRate(): the period follows the length of the frames, see fit()
+#define FRAME_RATE_FREE -1 // setRate(): no timer, a frame as soon as the last one is out and the tick allows
+#define FRAME_CLOCK_MARGIN 500 // us on top of the frame time in auto mode, for the DMX task to prepare the next frame and wake up in time
+
+class FrameClock { // Paces the DMX task off a periodic esp_timer, rather than the tick and however long the last frame took
+    public:
+        FrameClock();
+        void begin(TaskHandle_t task, int fps);
+        bool setRate(int fps);
+        int rate();
+        uint32_t period();
+        int pacedRate();
+        void fit(uint32_t frame_us);
+        uint32_t wait();
+        uint32_t jitter();
+        uint32_t overruns();
+        void measure(int frames);
+        bool measuring();
+        void printMeasurement(Print & out);
+
+    protected:
+        esp_timer_handle_t timer;
+        TaskHandle_t task; // Woken on every tick
+        volatile int frame_rate; // Setting: frames/s, FRAME_RATE_AUTO or FRAME_RATE_FREE
+        volatile uint32_t frame_period; // us between ticks of the running timer, 0 without one. Only the DMX task changes the timer
+        volatile uint32_t frame_time; // us the next frame takes on the wire, from fit()
+        int64_t last_start; // DMX task only
+        uint32_t last_interval;
+        volatile uint32_t last_jitter;
+        std::atomic<uint32_t> missed; // Ticks that came while the last frame was still going
+        // Measurement: the DMX task fills samples up to target, whoever started it reads them once it's there
+        uint16_t samples[FRAME_CLOCK_SAMPLES]; // Interval deviation in us, capped at 65535
+        std::atomic<int> sample_count;
+        std::atomic<int> sample_target;
+        std::atomic<int> sample_request; // Frames asked for by measure(), picked up by the DMX task
+        uint32_t measure_rate; // What the rate was while measuring
+        uint32_t measure_missed; // missed when the measurement started
+        Preferences prefs; // The rate, so it survives a reboot
+        uint32_t periodFor(int fps);
+        static void tick(void * arg);
+};
+#endif
@@ -0,0 +1,62 @@
+#ifndef _HTTPPARSER_H_
+#define _HTTPPARSER_H_
+#include <Arduino.h>
+
+#define HTTP_REQUEST_BUFFER_SIZE 1024 // Holds the request line and the headers we keep
+#define HTTP_MAX_HEADERS 16 // Headers beyond this are parsed but dropped
+#define HTTP_READ_CHUNK 256 // Bytes read from the client in one go
+#define HTTP_MAX_BODY 1024 // Largest request body accepted, enough for a whole universe in hex
+
+struct StrView { // Pointer and length into someone else's buffer - NOT null terminated, and only valid as long as that buffer is
+    const char * data;
+    size_t length;
+    bool empty() const;
+    bool equals(const char * s) const;
+    bool equalsIgnoreCase(const char * s) const;
+    const char * find(const char * s) const;
+    bool toInt(int & value) const;
+    StrView token(char delimiter);
+    bool nextPair(StrView & name, StrView & value);
+};
+
+class HttpRequestParser {
+    public:
+        enum class state_t{requestline, headers, skipline, body, done, error, toolarge};
+        HttpRequestParser();
+        void reset();
+        size_t feed(const char * data, size_t length);
+        bool done();
+        bool failed();
+        bool tooLarge();
+        bool idle();
+        StrView method();
+        StrView path();
+        StrView query();
+        StrView version();
+        StrView requestLine();
+        StrView header(const char * name);
+        StrView body();
+
+    protected:
+        struct header_t {
+            StrView name;
+            StrView value;
+        };
+        char buffer[HTTP_REQUEST_BUFFER_SIZE];
+        size_t used; // Bytes of buffer in use
+        size_t line_start; // Where the line currently being received starts in buffer
+        state_t state;
+        StrView method_view;
+        StrView path_view;
+        StrView query_view;
+        StrView version_view;
+        header_t headers[HTTP_MAX_HEADERS];
+        int header_count;
+        char body_buffer[HTTP_MAX_BODY];
+        size_t body_length; // Received so far
+        size_t body_expected; // Content-Length
+        state_t startBody();
+        bool parseRequestLine(StrView line);
+        void parseHeaderLine(StrView line);
+};
+#endif
@@ -0,0 +1,55 @@
+#ifndef _HTTPSERVER_H_
+#define _HTTPSERVER_H_
+#include <Arduino.h>
+#include <WiFi.h>
+#include "httpparser.h"
+#include "websocket.h"
+#include "metrics.h"
+
+#define HTTP_MAX_CONNECTIONS 4 // Connection slots, each holds a request parser (2.4 KB) and WebSocket buffers (1.5 KB)
+#define HTTP_SLOT_SIZE 4352 // Upper bound on the RAM one slot takes, checked at compile time. The parser and WebSocket sizes are where it goes
+#define HTTP_IDLE_TIMEOUT 5000 // ms a connection may sit idle before it is closed
+#define HTTP_WRITE_TIMEOUT 1000 // ms a write may wait for a client to take data. A client stalled longer than that loses the rest of its response and its connection
+
+class HttpServer {
+    public:
+        typedef void (*handler_t)(WiFiClient & client, HttpRequestParser & request, bool keepalive); // Sends the complete response. keepalive tells it which Connection header to send
+        typedef void (*ws_handler_t)(int slot, const uint8_t * message, size_t length); // Binary WebSocket message from the connection in slot. Called with NULL when the connection opens
+        HttpServer(uint16_t port, handler_t handler);
+        void begin();
+        void onWebSocket(const char * path, ws_handler_t handler);
+        void poll();
+        int connections();
+        unsigned long requests();
+        bool webSocketWritable(int slot);
+        bool webSocketSend(int slot, const uint8_t * data, size_t length);
+        MetricTiming & parseTime();
+        MetricTiming & responseTime();
+
+    protected:
+        struct connection_t {
+            bool active;
+            bool websocket; // Upgraded, ws is in use rather than request
+            WiFiClient client;
+            HttpRequestParser request;
+            WebSocket ws;
+            unsigned long last_active;
+            unsigned long parse_time; // us spent parsing the request so far
+        };
+        static_assert(sizeof(connection_t) <= HTTP_SLOT_SIZE, "A connection slot outgrew HTTP_SLOT_SIZE, update the figures above");
+        WiFiServer server;
+        handler_t handler;
+        const char * ws_path;
+        ws_handler_t ws_handler;
+        connection_t slots[HTTP_MAX_CONNECTIONS];
+        unsigned long request_count;
+        MetricTiming parse_metric; // us spent in the parser per request
+        MetricTiming response_metric; // us the handler took to send the response
+        void accept();
+        void service(connection_t & c);
+        void serviceWebSocket(connection_t & c);
+        void receiveWebSocket(connection_t & c, const uint8_t * data, size_t length);
+        void upgrade(connection_t & c);
+        void close(connection_t & c);
+};
+#endif
@@ -0,0 +1,67 @@
+#ifndef _LOG_H_
+#define _LOG_H_
+#include <Arduino.h>
+#include <atomic>
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL // Set with -DLOG_LEVEL=... in build_flags. Anything above it isn't even compiled in
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_SLOTS 32 // Lines buffered, must be a power of two. Any more before the task gets to them are dropped
+#define LOG_LINE_SIZE 124 // Longest line, longer ones are cut short
+#define LOG_DRAIN_INTERVAL 10 // ms between checks for new lines
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) Log.write(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) Log.write(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) Log.write(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) Log.write(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+class Logger {
+    public:
+        Logger();
+        void begin(Print & out);
+        void write(int level, const char * format, ...) __attribute__ ((format (printf, 3, 4)));
+        bool drain();
+        uint32_t dropped();
+
+    protected:
+        struct slot_t {
+            std::atomic<uint32_t> seq; // Equal to the write position when free, position + 1 once the line is ready to print
+            uint8_t level;
+            char text[LOG_LINE_SIZE];
+        };
+        slot_t slots[LOG_SLOTS];
+        std::atomic<uint32_t> head; // Next position to write, shared by all writers
+        uint32_t tail; // Next position to print, only touched by the task
+        std::atomic<uint32_t> drop_count;
+        uint32_t drops_reported;
+        Print * output;
+        TaskHandle_t task;
+        slot_t * reserve(uint32_t & pos);
+        static void taskFunc(void * p);
+};
+
+extern Logger Log;
+#endif
@@ -1,19 +1,61 @@
 #ifndef _MAIN_H_
 #define _MAIN_H_
 #include "statusled.h"
+#include "artnet.h"
+#include "e131.h"
+#include "httpparser.h"
+#include "chunkedprint.h"
+#include "dmxframe.h"
+#include "httpserver.h"
+#include "fader.h"
+#include "scenes.h"
+#include "dmxinput.h"
+#include "metrics.h"
+#include "wifistore.h"
+#include "log.h"
+#include "curves.h"
+#include "patch.h"
+#include "universe.h"
+#include "frameclock.h"
+#include "voltage.h"
+#include "webui.h"
 #include <Arduino.h>
 #include <WiFi.h>
 #include <esp_wps.h>
 #include <esp_dmx.h>
+#include <mbedtls/base64.h>
 
 void ADCTaskFunc (void * p);
 void DMXTaskFunc (void * p);
-void LEDTaskFunc (void * p);
-void sendHTTPResponse(WiFiClient client, String resourceRequested);
-void handleResponseLED(String action);
-void handleResponseDMX(String action);
-String readHTTPResponse(String line);
-
-enum class dmxsemaphore_t{free, busy, updated};
+void DMXInputTaskFunc (void * p);
+void ArtNetTaskFunc (void * p);
+void E131TaskFunc (void * p);
+void HTTPTaskFunc (void * p);
+void handleHTTPRequest(WiFiClient & client, HttpRequestParser & request, bool keepalive);
+void handleWebSocketMessage(int slot, const uint8_t * message, size_t length);
+void pushWebSockets();
+void sendHTTPResponse(WiFiClient & client, StrView resourceRequested, StrView query, bool chunked, bool keepalive);
+void sendTextResponse(WiFiClient & client, const char * type, void (*body)(Print & out), bool chunked, bool keepalive);
+void printMetrics(Print & out);
+void handleResponseLED(StrView action);
+void cancelFades(FadeEngine & fader, const uint32_t * channels);
+void handleResponseDMX(StrView action);
+bool handlePostDMX(StrView action, StrView body);
+int hexValue(char c);
+void sendDMXState(WiFiClient & client, HttpRequestParser & request, bool keepalive);
+bool etagMatches(StrView header, const char * etag);
+void sendStatusResponse(WiFiClient & client, const char * status, bool keepalive);
+void handleResponseScene(StrView action);
+void handleResponseInput(StrView action);
+void handleResponseJitter(StrView action);
+void handleResponseADC(StrView action);
+void handleLowVoltage(VoltageMonitor::channel_t channel, int millivolts);
+void printJitter(Print & out);
+void printStatus(Print & out);
+void handleResponseCurve(StrView action);
+void handleResponsePatch(StrView action);
+bool recallScene(StrView name, unsigned long time, FadeEngine::curve_t curve);
+bool saveScene(StrView name);
+StrView readHTTPResponse(HttpRequestParser & request);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,30 @@
+#ifndef _METRICS_H_
+#define _METRICS_H_
+#include <Arduino.h>
+#include <atomic>
+
+#define METRIC_MAX_BUCKETS 10 // Histogram buckets, not counting +Inf
+
+class MetricTiming {
+    public:
+        MetricTiming();
+        MetricTiming(const uint32_t * bounds, int buckets);
+        void record(uint32_t value);
+        uint32_t last();
+        uint32_t peak();
+        void print(Print & out, const char * name, const char * help);
+        static void printValue(Print & out, const char * name, const char * type, const char * help, int64_t value);
+
+    protected:
+        std::atomic<uint32_t> seq; // Odd while the writer is updating, readers retry until they get an even, unchanged value
+        std::atomic<uint32_t> count;
+        std::atomic<uint32_t> sum_low; // 64 bit sum, so microseconds don't wrap after an hour
+        std::atomic<uint32_t> sum_high;
+        std::atomic<uint32_t> maximum;
+        std::atomic<uint32_t> latest;
+        const uint32_t * bounds; // Upper bounds of the histogram buckets, ascending. NULL for a plain summary
+        int bucket_count;
+        std::atomic<uint32_t> buckets[METRIC_MAX_BUCKETS];
+        static void printHeader(Print & out, const char * name, const char * type, const char * help);
+};
+#endif
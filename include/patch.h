@@ -0,0 +1,70 @@
+#ifndef _PATCH_H_
+#define _PATCH_H_
+#include <Arduino.h>
+#include <Preferences.h>
+#include <atomic>
+#include <esp_dmx.h>
+#include "dmxframe.h"
+
+#define PATCH_CHANNELS 64 // Logical channels, each one attribute of a fixture (dimmer, pan, tilt...)
+#define PATCH_MAX 128 // Patch entries. A channel driving several identical fixtures needs one per fixture
+#define PATCH_QUEUE_SIZE 64 // Level commands waiting for the DMX task
+
+class PatchTable {
+    public:
+        struct entry_t { // Stored as is in flash
+            uint8_t channel; // Logical channel, 0 based
+            uint8_t width; // 1 for 8 bit, 2 for 16 bit (coarse at address, fine at address + 1)
+            uint16_t address; // First slot, 0 based
+        };
+        PatchTable();
+        PatchTable(const char * name);
+        void begin();
+        bool add(int channel, int address, int width);
+        bool remove(int channel);
+        int entries();
+        const entry_t & entry(int i);
+        bool set(int channel, uint16_t value, unsigned long duration);
+        uint16_t level(int channel);
+        int slots();
+        void apply(uint8_t * output, unsigned long now);
+
+    protected:
+        struct map_t { // One resolved entry, what apply() runs through
+            uint16_t slot; // Packet slot (address + 1)
+            uint8_t channel;
+            uint8_t width;
+        };
+        struct resolved_t {
+            map_t map[PATCH_MAX]; // Sorted by slot, so the output is written front to back
+            int count;
+            int slots; // Highest slot used + 1, for the frame length
+        };
+        struct command_t {
+            uint8_t channel;
+            uint16_t target;
+            uint32_t duration; // ms, 0 snaps
+        };
+        struct fade_t { // 16 bit fade of one channel. DMX task only
+            uint16_t start;
+            uint16_t target;
+            uint32_t start_time;
+            uint32_t duration; // 0 when not fading
+            uint32_t rate; // 2^32 / duration, like FadeEngine
+        };
+        Preferences prefs;
+        const char * prefs_name; // NVS namespace, one per universe
+        entry_t table[PATCH_MAX]; // As configured. HTTP task only
+        int count;
+        resolved_t resolved[2]; // The DMX task reads one, the other is built when the patch changes
+        std::atomic<int8_t> active; // Resolved table the DMX task uses
+        std::atomic<int8_t> pending; // Newly built table waiting for the DMX task to switch, -1 if none
+        std::atomic<int> slot_count; // slots of the newest table, for other tasks
+        QueueHandle_t queue;
+        uint16_t levels[PATCH_CHANNELS]; // Current values, fades included. DMX task only
+        fade_t fades[PATCH_CHANNELS];
+        volatile uint16_t targets[PATCH_CHANNELS]; // Last value asked for, for the page
+        bool resolve();
+        void store();
+};
+#endif
@@ -0,0 +1,35 @@
+#ifndef _SCENES_H_
+#define _SCENES_H_
+#include <Arduino.h>
+#include <Preferences.h>
+#include "dmxframe.h"
+
+#define SCENE_MAX 32 // Scenes that can be stored
+#define SCENE_NAME_SIZE 16 // Including the terminating null
+#define SCENE_BLOB_SIZE (DMXArraySize + 4) // Worst case size of an encoded scene: each run header is paid for by the zeros after it, except for the last one
+
+class SceneStore {
+    public:
+        SceneStore();
+        void begin();
+        bool save(const char * name, size_t length, const uint8_t * frame);
+        int load(const char * name, size_t length, uint8_t * frame, bool remember = true);
+        bool remove(const char * name, size_t length);
+        int count();
+        const char * name(int i);
+        const char * last();
+        int size(int i);
+        static bool validName(const char * name, size_t length);
+
+    protected:
+        Preferences prefs;
+        char names[SCENE_MAX][SCENE_NAME_SIZE]; // The index, kept in RAM so a lookup never touches flash. Position i is stored under key "s<i>", an empty name is a free spot
+        uint16_t sizes[SCENE_MAX]; // Encoded size of each scene
+        char last_name[SCENE_NAME_SIZE]; // Last scene saved or recalled, which is brought back at boot
+        uint8_t blob[SCENE_BLOB_SIZE];
+        int find(const char * name, size_t length);
+        void setLast(const char * name);
+        static size_t encode(const uint8_t * frame, uint8_t * out);
+        static int decode(const uint8_t * in, size_t size, uint8_t * frame);
+};
+#endif
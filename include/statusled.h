@@ -1,32 +1,52 @@
 #ifndef _STATUSLED_H_
 #define _STATUSLED_H_
 #include <Arduino.h>
+#include <esp_timer.h>
+
+#define LED_MAX 8 // LEDs one StatusLed can drive
+#define LED_PATTERN_STEPS 8 // Most on/off steps in a pattern
+
 class StatusLed {
     public:
         enum class status_t{off, on, flash};
-        void tick();
+        struct pattern_t { // Times in ms, alternating on and off starting with on. Repeats for as long as it's set
+            uint8_t steps;
+            uint16_t times[LED_PATTERN_STEPS];
+        };
+        static const pattern_t double_blink;
+        static const pattern_t triple_blink;
+        static const pattern_t heartbeat;
+        StatusLed();
+        StatusLed(const uint8_t pins[], int count);
+        StatusLed(uint8_t p0, uint8_t p1, uint8_t p2);
+        void begin();
+        bool add(uint8_t pin);
         void on(uint8_t pin);
         void off(uint8_t pin);
         void off();
         void flash(uint8_t pin, int time_on, int time_off);
+        void pattern(uint8_t pin, const pattern_t & p);
         void set(uint8_t pin, status_t s);
         void set(uint8_t pin, status_t s, int time_on, int time_off);
-        StatusLed();
-        StatusLed(uint8_t p[]);
-        StatusLed(uint8_t p0, uint8_t p1, uint8_t p2);
         void output();
 
     protected:
-        status_t LED_Status[3];
-        bool outputs[3];
-        uint8_t pins[3];
-        int on_times[3];
-        int off_times[3];
-        unsigned long next_times[3];
-        unsigned long min_time;
+        struct led_t {
+            uint8_t pin;
+            status_t status;
+            bool output; // Current state of the pin
+            uint8_t step; // Step of the pattern we're in
+            uint32_t next_time; // millis() of the next step, only for flashing LEDs
+            pattern_t pattern;
+        };
+        led_t leds[LED_MAX];
+        int count;
+        esp_timer_handle_t timer; // One shot, armed for the next step due of any LED
+        SemaphoreHandle_t lock; // Setters and the timer may run in different tasks
         int lookup(uint8_t pin);
-        void set_internal(uint8_t pin, status_t s, int time_on, int time_off);
-        
-
+        void update(uint32_t now);
+        void take();
+        void give();
+        static void timerCallback(void * arg);
 };
 #endif
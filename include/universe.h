@@ -0,0 +1,57 @@
+#ifndef _UNIVERSE_H_
+#define _UNIVERSE_H_
+#include <Arduino.h>
+#include <esp_dmx.h>
+#include "dmxframe.h"
+#include "fader.h"
+#include "curves.h"
+#include "patch.h"
+#include "dmxinput.h"
+#include "metrics.h"
+
+#define DMX_MIN_SLOTS 24 // Shortest frame sent, however few channels are in use. 24 slots keep the break-to-break time above the 1204 us the standard asks for
+#define DMX_BREAK_DEFAULT 176 // us, esp_dmx's own default
+#define DMX_BREAK_MIN 92 // The standard's minimum for a transmitter
+#define DMX_BREAK_MAX 1000 // Anything longer only slows the frame rate down
+#define DMX_MAB_DEFAULT 12 // us, mark after break
+#define DMX_MAB_MIN 12
+#define DMX_MAB_MAX 1000
+#define DMX_SLOT_TIME 44 // us per slot on the wire, start code included: 11 bits at 250 kbit/s
+
+class DMXUniverse { // Everything one DMX output needs. The parts are public, they each do their own locking
+    public:
+        DMXUniverse(dmx_port_t port, int tx_pin, int enable_pin, const char * curves_name, const char * patch_name);
+        void begin();
+        void prepare(DMXInput * input, MetricTiming & transform);
+        void send();
+        void wait();
+        bool setTiming(int break_us, int mab_us);
+        int breakLength();
+        int mabLength();
+        dmx_port_t port();
+        int frameSlots();
+        uint32_t frameTime();
+        int framesPerSecond();
+        unsigned long handoffTime();
+        int minSlots;
+        DMXFrameBuffer buffer; // Hands frames from the producers (HTTP, Art-Net, sACN) to the DMX task without either side waiting on the other
+        FadeEngine fader; // Timed fades, run by the DMX task on top of the frames
+        ResponseCurves curves; // Gamma and dimmer curves applied on the way to the driver
+        PatchTable patch; // Logical channels with 16 bit values, patched onto slots
+
+    protected:
+        dmx_port_t dmx_port;
+        int tx_pin;
+        int enable_pin;
+        volatile int break_len; // us
+        volatile int mab_len;
+        uint8_t output[DMX_PACKET_SIZE]; // What goes out, fades included but before the response curves. DMX task only
+        uint8_t merge_frame[DMX_PACKET_SIZE]; // Network frame merged with the input. DMX task only
+        int input_slots; // Slots merged from the input last frame, 0 when there is no input
+        volatile int frame_slots;
+        volatile int frames_per_second;
+        int frames;
+        unsigned long fps_start;
+        volatile unsigned long handoff_time; // micros() when the DMX task last picked up changed slots, for the hand-off benchmark
+};
+#endif
@@ -0,0 +1,60 @@
+#ifndef _VOLTAGE_H_
+#define _VOLTAGE_H_
+#include <Arduino.h>
+
+#define VOLTAGE_CHANNELS 2 // VBAT and VEXT
+#define VOLTAGE_SAMPLE_RATE 20000 // Hz, both channels together. The lowest the ESP32's continuous mode does
+#define VOLTAGE_OVERSAMPLE 250 // Conversions averaged by the driver into each reading, so 40 readings per channel per second
+#define VOLTAGE_INTERVAL 1000 // ms of readings averaged into each history entry. Thresholds are checked this often too
+#define VOLTAGE_HISTORY 60 // History entries kept per channel
+#define VOLTAGE_EWMA_SHIFT 3 // Each new entry counts for 1/8 of the moving average
+#define VOLTAGE_HYSTERESIS 100 // mV a channel has to come back above its threshold before it can trigger again
+
+class VoltageMonitor {
+    public:
+        enum class channel_t{vbat, vext};
+        VoltageMonitor(int vbat_pin, int vext_pin);
+        bool begin();
+        bool receive(TickType_t wait);
+        void setLow(channel_t channel, int millivolts);
+        int low(channel_t channel);
+        void onLow(void (*handler)(channel_t channel, int millivolts));
+        void resetRange();
+        int latest(channel_t channel);
+        int mean(channel_t channel);
+        int average(channel_t channel);
+        int minimum(channel_t channel);
+        int maximum(channel_t channel);
+        int history(channel_t channel, int age);
+        int historySize();
+        uint32_t lowEvents();
+        static const char * name(channel_t channel);
+
+    protected:
+        struct stats_t {
+            int history[VOLTAGE_HISTORY]; // mV, one entry per VOLTAGE_INTERVAL
+            int32_t history_sum; // Of the entries in use, kept up to date as they're replaced
+            volatile int latest;
+            volatile int ewma; // mV * 16
+            volatile int minimum;
+            volatile int maximum;
+            volatile int low; // Threshold in mV, 0 is off
+            bool below; // Triggered, waiting to come back above low + VOLTAGE_HYSTERESIS
+            int32_t interval_sum; // Readings so far this interval
+            int interval_count;
+        };
+        uint8_t pins[VOLTAGE_CHANNELS];
+        stats_t stats[VOLTAGE_CHANNELS];
+        volatile int next; // History entry written next
+        volatile int used; // History entries filled so far
+        unsigned long interval_start;
+        volatile uint32_t low_events;
+        volatile bool reset_range; // Asked for by resetRange(), done by the monitor's task
+        void (*low_handler)(channel_t channel, int millivolts);
+        TaskHandle_t task; // Woken by the driver when readings are ready
+        static VoltageMonitor * instance; // The driver's callback takes no argument
+        static void converted();
+        void commit();
+        static int scale(int channel, int millivolts);
+};
+#endif
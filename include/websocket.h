@@ -0,0 +1,49 @@
+#ifndef _WEBSOCKET_H_
+#define _WEBSOCKET_H_
+#include <Arduino.h>
+#include "httpparser.h"
+
+#define WS_MAX_MESSAGE 640 // Largest message accepted from a client: a full universe plus a few bytes of header
+#define WS_OUT_BUFFER 640 // Frames waiting for the client to take them. Room for a full universe update
+#define WS_ACCEPT_SIZE 29 // Sec-WebSocket-Accept value, including the terminating null
+
+class WebSocket {
+    public:
+        enum class opcode_t : uint8_t {continuation = 0x0, text = 0x1, binary = 0x2, close = 0x8, ping = 0x9, pong = 0xa};
+        static bool acceptKey(StrView key, char * accept);
+        WebSocket();
+        void reset();
+        size_t feed(const uint8_t * data, size_t length);
+        bool ready();
+        bool closed();
+        opcode_t opcode();
+        const uint8_t * message();
+        size_t messageLength();
+        void next();
+        bool send(opcode_t op, const uint8_t * data, size_t length);
+        bool flush(int fd);
+        bool writable();
+
+    protected:
+        enum class state_t{header, payload, ready, closed};
+        state_t state;
+        uint8_t header[14]; // Longest possible frame header: 2 bytes, 8 bytes extended length, 4 bytes mask
+        size_t header_used;
+        opcode_t frame_op; // Opcode of the frame being received
+        opcode_t message_op; // Opcode of the message being assembled (frames may be fragmented)
+        bool fin;
+        uint8_t mask_key[4];
+        size_t payload_length;
+        size_t payload_done;
+        uint8_t in[WS_MAX_MESSAGE]; // Message being assembled
+        size_t in_used;
+        uint8_t control[125]; // Control frames may arrive in the middle of a fragmented message, so they get their own space
+        uint8_t out[WS_OUT_BUFFER];
+        size_t out_used;
+        size_t out_sent;
+        size_t headerNeeded();
+        void startPayload();
+        void endFrame();
+        void fail(uint16_t code);
+};
+#endif
@@ -0,0 +1,31 @@
+#ifndef _WEBUI_H_
+#define _WEBUI_H_
+#include <Arduino.h>
+#include <WiFi.h>
+#include "httpparser.h"
+
+#define WEBUI_PATH "/ui" // The UI's files live under here, the classic pages keep the rest
+#define WEBUI_CACHE_INDEX "no-cache" // index.html is checked every time (a 304 while it's the same), so a new build shows up right away
+#define WEBUI_CACHE_VERSIONED "public, max-age=31536000, immutable" // The rest is only ever asked for with ?v=hash, a new build means a new URL
+
+class WebUI {
+    public:
+        struct asset_t {
+            const char * name; // Without WEBUI_PATH, e.g. "app.js"
+            const char * type; // Content-Type
+            const uint8_t * data; // Gzipped, in flash
+            size_t length;
+            const char * etag; // Quoted, from the content
+            bool versioned; // Referred to with ?v=hash, so it can be cached for good
+        };
+        static const asset_t * find(StrView name);
+        static bool serve(WiFiClient & client, HttpRequestParser & request, bool keepalive);
+        static bool acceptsGzip(StrView header);
+        static size_t count();
+        static size_t totalSize();
+
+    protected:
+        static void sendHeaders(WiFiClient & client, const char * status, const asset_t * asset, bool keepalive);
+        static bool refused(StrView params);
+};
+#endif
@@ -0,0 +1,31 @@
+#ifndef _WIFISTORE_H_
+#define _WIFISTORE_H_
+#include <Arduino.h>
+#include <Preferences.h>
+
+#define WIFI_SSID_SIZE 33 // 32 characters and the terminating null
+#define WIFI_PSK_SIZE 65 // 63 character passphrase, or 64 hex digits, and the null
+
+class WiFiStore {
+    public:
+        WiFiStore();
+        void begin();
+        bool valid();
+        bool save(const char * ssid, const char * psk, const uint8_t * bssid, int32_t channel);
+        void clear();
+        const char * ssid();
+        const char * psk();
+        const uint8_t * bssid();
+        int32_t channel();
+
+    protected:
+        struct credentials_t { // Stored as one blob, so it's always written (and read) as a whole
+            char ssid[WIFI_SSID_SIZE];
+            char psk[WIFI_PSK_SIZE];
+            uint8_t bssid[6];
+            uint8_t channel;
+        };
+        Preferences prefs;
+        credentials_t stored;
+};
+#endif
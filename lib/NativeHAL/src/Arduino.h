@@ -0,0 +1,163 @@
+#ifndef _NATIVE_ARDUINO_H_
+#define _NATIVE_ARDUINO_H_
+// Native stand-in for the ESP32 Arduino core, see the README of this library
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cctype>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <strings.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define DEC 10
+#define HEX 16
+#define NOP() asm volatile ("nop")
+#define ARDUINO_ISR_ATTR
+
+using std::min;
+using std::max;
+
+unsigned long millis();
+unsigned long micros();
+void nativeSetMillis(unsigned long ms); // Native only, for tests
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+uint16_t analogRead(uint8_t pin);
+uint32_t analogReadMilliVolts(uint8_t pin);
+uint32_t esp_random();
+
+typedef struct {
+    uint8_t pin;
+    uint8_t channel;
+    int avg_read_raw;
+    int avg_read_mv;
+} adc_continuous_data_t;
+bool analogContinuous(const uint8_t pins[], size_t pins_count, uint32_t conversions_per_pin, uint32_t sampling_freq_hz, void (*userFunc)(void)); // The callback runs in a thread of its own, as often as the real thing would call it
+bool analogContinuousStart();
+bool analogContinuousStop();
+bool analogContinuousRead(adc_continuous_data_t ** buffer, uint32_t timeout_ms);
+
+inline bool isDigit(char c) {
+    return isdigit((unsigned char) c);
+}
+
+inline bool isHexadecimalDigit(char c) {
+    return isxdigit((unsigned char) c);
+}
+
+class Print;
+
+class Printable {
+    public:
+        virtual ~Printable() {}
+        virtual size_t printTo(Print & p) const = 0;
+};
+
+class String {
+    public:
+        String(const char * s = "") : s(s ? s : "") {}
+        String(const std::string & s) : s(s) {}
+        explicit String(char c) : s(1, c) {}
+        explicit String(int v) : s(std::to_string(v)) {}
+        explicit String(unsigned int v) : s(std::to_string(v)) {}
+        explicit String(long v) : s(std::to_string(v)) {}
+        explicit String(unsigned long v) : s(std::to_string(v)) {}
+        const char * c_str() const { return s.c_str(); }
+        size_t length() const { return s.size(); }
+        bool equals(const String & o) const { return s == o.s; }
+        bool equalsIgnoreCase(const String & o) const { return strcasecmp(s.c_str(), o.s.c_str()) == 0; }
+        long toInt() const { return atol(s.c_str()); }
+        bool operator==(const String & o) const { return s == o.s; }
+        bool operator!=(const String & o) const { return s != o.s; }
+        String & operator+=(const String & o) { s += o.s; return *this; }
+        String & operator+=(const char * o) { s += o; return *this; }
+        String & operator+=(char o) { s += o; return *this; }
+        friend String operator+(String a, const String & b) { a += b; return a; }
+        friend String operator+(String a, const char * b) { a += b; return a; }
+        friend String operator+(const char * a, const String & b) { return String(a) + b; }
+    protected:
+        std::string s;
+};
+
+class Print {
+    public:
+        virtual ~Print() {}
+        virtual size_t write(uint8_t c) = 0;
+        virtual size_t write(const uint8_t * buffer, size_t size);
+        size_t write(const char * s) { return s ? write((const uint8_t *) s, strlen(s)) : 0; }
+        size_t write(const char * buffer, size_t size) { return write((const uint8_t *) buffer, size); }
+        virtual int availableForWrite() { return 0; }
+        virtual void flush() {}
+        size_t printf(const char * format, ...) __attribute__ ((format (printf, 2, 3)));
+
+        size_t print(const char * s) { return write(s); }
+        size_t print(const String & s) { return write(s.c_str(), s.length()); }
+        size_t print(char c) { return write((uint8_t) c); }
+        size_t print(unsigned char v, int base = DEC) { return print((unsigned long long) v, base); }
+        size_t print(int v, int base = DEC) { return print((long long) v, base); }
+        size_t print(unsigned int v, int base = DEC) { return print((unsigned long long) v, base); }
+        size_t print(long v, int base = DEC) { return print((long long) v, base); }
+        size_t print(unsigned long v, int base = DEC) { return print((unsigned long long) v, base); }
+        size_t print(long long v, int base = DEC);
+        size_t print(unsigned long long v, int base = DEC);
+        size_t print(double v, int digits = 2);
+        size_t print(const Printable & p) { return p.printTo(*this); }
+
+        size_t println() { return write("\r\n"); }
+        template <typename T> size_t println(const T & v) { size_t n = print(v); return n + println(); }
+        template <typename T> size_t println(const T & v, int format) { size_t n = print(v, format); return n + println(); }
+};
+
+class Stream : public Print {
+    public:
+        virtual int available() = 0;
+        virtual int read() = 0;
+        virtual int peek() = 0;
+        void setTimeout(unsigned long timeout) { (void) timeout; }
+};
+
+class HardwareSerial : public Stream { // Serial goes to stdout, nothing ever comes in
+    public:
+        void begin(unsigned long baud) { (void) baud; }
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t * buffer, size_t size) override;
+        using Print::write;
+        int available() override { return 0; }
+        int read() override { return -1; }
+        int peek() override { return -1; }
+        operator bool() { return true; }
+};
+extern HardwareSerial Serial;
+
+class EspClass { // Heap figures of the host make no sense next to the ESP32's, these are all 0
+    public:
+        uint32_t getHeapSize() { return 0; }
+        uint32_t getFreeHeap() { return 0; }
+        uint32_t getMinFreeHeap() { return 0; }
+        uint32_t getMaxAllocHeap() { return 0; }
+        void restart() { exit(0); }
+};
+extern EspClass ESP;
+
+void setup();
+void loop();
+#endif
@@ -0,0 +1,18 @@
+#ifndef _NATIVE_IPADDRESS_H_
+#define _NATIVE_IPADDRESS_H_
+#include "Arduino.h"
+
+class IPAddress : public Printable {
+    public:
+        IPAddress() : IPAddress(0, 0, 0, 0) {}
+        IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) { bytes[0] = a; bytes[1] = b; bytes[2] = c; bytes[3] = d; }
+        explicit IPAddress(uint32_t address) { memcpy(bytes, &address, 4); } // Network byte order, as in sockaddr_in
+        operator uint32_t() const { uint32_t a; memcpy(&a, bytes, 4); return a; }
+        uint8_t operator[](int i) const { return bytes[i]; }
+        uint8_t & operator[](int i) { return bytes[i]; }
+        bool operator==(const IPAddress & o) const { return memcmp(bytes, o.bytes, 4) == 0; }
+        size_t printTo(Print & p) const override;
+    protected:
+        uint8_t bytes[4];
+};
+#endif
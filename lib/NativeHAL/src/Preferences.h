@@ -0,0 +1,30 @@
+#ifndef _NATIVE_PREFERENCES_H_
+#define _NATIVE_PREFERENCES_H_
+#include "Arduino.h"
+
+class Preferences { // NVS in memory, shared by all Preferences objects of the program
+    public:
+        bool begin(const char * name, bool readonly = false, const char * partition = NULL);
+        void end();
+        bool clear();
+        bool remove(const char * key);
+        bool isKey(const char * key);
+        size_t putBytes(const char * key, const void * value, size_t length);
+        size_t getBytes(const char * key, void * buffer, size_t length);
+        size_t getBytesLength(const char * key);
+        size_t putString(const char * key, const char * value);
+        size_t getString(const char * key, char * value, size_t length);
+        size_t putUChar(const char * key, uint8_t value);
+        uint8_t getUChar(const char * key, uint8_t default_value = 0);
+        size_t putShort(const char * key, int16_t value);
+        int16_t getShort(const char * key, int16_t default_value = 0);
+        size_t putUShort(const char * key, uint16_t value);
+        uint16_t getUShort(const char * key, uint16_t default_value = 0);
+        size_t putUInt(const char * key, uint32_t value);
+        uint32_t getUInt(const char * key, uint32_t default_value = 0);
+    protected:
+        std::string ns;
+        bool readonly;
+        bool started = false;
+};
+#endif
@@ -0,0 +1,65 @@
+#ifndef _NATIVE_WIFI_H_
+#define _NATIVE_WIFI_H_
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "WiFiClient.h"
+#include "WiFiServer.h"
+#include "WiFiUdp.h"
+
+typedef enum {
+    WL_IDLE_STATUS = 0,
+    WL_NO_SSID_AVAIL = 1,
+    WL_CONNECTED = 3,
+    WL_CONNECT_FAILED = 4,
+    WL_CONNECTION_LOST = 5,
+    WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+    WIFI_MODE_NULL = 0,
+    WIFI_MODE_STA,
+    WIFI_MODE_AP,
+    WIFI_MODE_APSTA
+} wifi_mode_t;
+
+typedef enum {
+    ARDUINO_EVENT_WIFI_READY = 0,
+    ARDUINO_EVENT_WIFI_STA_START,
+    ARDUINO_EVENT_WIFI_STA_STOP,
+    ARDUINO_EVENT_WIFI_STA_CONNECTED,
+    ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+    ARDUINO_EVENT_WIFI_STA_GOT_IP,
+    ARDUINO_EVENT_WPS_ER_SUCCESS,
+    ARDUINO_EVENT_WPS_ER_FAILED,
+    ARDUINO_EVENT_WPS_ER_TIMEOUT,
+    ARDUINO_EVENT_WPS_ER_PIN
+} arduino_event_id_t;
+typedef arduino_event_id_t WiFiEvent_t;
+
+typedef struct {
+    struct {
+        uint8_t pin_code[8];
+    } wps_er_pin;
+} arduino_event_info_t;
+
+typedef void (*WiFiEventFuncCb)(WiFiEvent_t event, arduino_event_info_t info);
+
+class WiFiClass { // Always connected to "native" as 127.0.0.1
+    public:
+        wl_status_t status();
+        bool mode(wifi_mode_t mode);
+        wl_status_t begin();
+        wl_status_t begin(const char * ssid, const char * password = NULL, int32_t channel = 0, const uint8_t * bssid = NULL, bool connect = true);
+        bool reconnect();
+        bool disconnect(bool wifioff = false, bool eraseap = false);
+        void onEvent(WiFiEventFuncCb callback);
+        String SSID();
+        String psk();
+        uint8_t * BSSID();
+        int32_t channel();
+        IPAddress localIP();
+        uint8_t * macAddress(uint8_t * mac);
+        int8_t RSSI();
+};
+extern WiFiClass WiFi;
+#endif
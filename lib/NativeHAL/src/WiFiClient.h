@@ -0,0 +1,32 @@
+#ifndef _NATIVE_WIFICLIENT_H_
+#define _NATIVE_WIFICLIENT_H_
+#include <memory>
+#include "Arduino.h"
+#include "IPAddress.h"
+
+class WiFiClient : public Stream { // A TCP socket. Copies share it, like on the ESP32, and the last one closes it
+    public:
+        WiFiClient();
+        explicit WiFiClient(int fd);
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t * buffer, size_t size) override;
+        using Print::write;
+        int available() override;
+        int read() override;
+        int read(uint8_t * buffer, size_t size);
+        int peek() override;
+        uint8_t connected();
+        void stop();
+        int fd() const;
+        int setNoDelay(bool nodelay);
+        void setTimeout(unsigned long timeout);
+        IPAddress remoteIP();
+        operator bool();
+    protected:
+        struct socket_t {
+            int fd;
+            ~socket_t();
+        };
+        std::shared_ptr<socket_t> sock;
+};
+#endif
@@ -0,0 +1,20 @@
+#ifndef _NATIVE_WIFISERVER_H_
+#define _NATIVE_WIFISERVER_H_
+#include "WiFiClient.h"
+
+class WiFiServer { // Listening TCP socket on all interfaces of the host. Ports below 1024 need root
+    public:
+        WiFiServer(uint16_t port);
+        void begin();
+        bool hasClient();
+        WiFiClient available();
+        WiFiClient accept();
+        void setNoDelay(bool nodelay);
+        void end();
+    protected:
+        uint16_t port;
+        int fd;
+        int pending; // Accepted by hasClient(), waiting for available()
+        bool nodelay;
+};
+#endif
@@ -0,0 +1,41 @@
+#ifndef _NATIVE_WIFIUDP_H_
+#define _NATIVE_WIFIUDP_H_
+#include "Arduino.h"
+#include "IPAddress.h"
+
+#define NATIVE_UDP_PACKET_SIZE 1500
+
+class WiFiUDP : public Stream { // A UDP socket. Like on the ESP32, parsePacket() takes a whole datagram and read() works through it
+    public:
+        WiFiUDP();
+        ~WiFiUDP();
+        uint8_t begin(uint16_t port);
+        uint8_t beginMulticast(IPAddress group, uint16_t port);
+        void stop();
+        int beginPacket(IPAddress ip, uint16_t port);
+        int endPacket();
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t * buffer, size_t size) override;
+        using Print::write;
+        int parsePacket();
+        int available() override;
+        int read() override;
+        int read(unsigned char * buffer, size_t size);
+        int read(char * buffer, size_t size);
+        int peek() override;
+        void flush() override;
+        IPAddress remoteIP();
+        uint16_t remotePort();
+    protected:
+        int fd;
+        uint8_t rx[NATIVE_UDP_PACKET_SIZE];
+        size_t rx_size;
+        size_t rx_pos;
+        uint8_t tx[NATIVE_UDP_PACKET_SIZE];
+        size_t tx_size;
+        IPAddress tx_ip;
+        uint16_t tx_port;
+        IPAddress remote_ip;
+        uint16_t remote_port;
+};
+#endif
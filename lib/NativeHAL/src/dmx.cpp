@@ -0,0 +1,132 @@
+//dmx.cpp
+// Native esp_dmx: each port is a packet buffer in memory. Sending takes as long as the frame would on the wire, so the DMX task runs at a realistic rate.
+
+#include <esp_dmx.h>
+#include <chrono>
+#include <thread>
+
+#define NATIVE_DMX_BREAK 176 // us, esp_dmx's default break
+#define NATIVE_DMX_MAB 12 // us, and mark after break, until set otherwise
+#define NATIVE_DMX_SLOT 44 // us per slot at 250 kbit/s
+
+struct native_dmx_t {
+    bool installed;
+    uint8_t data[DMX_PACKET_SIZE];
+    uint32_t break_len; // us
+    uint32_t mab_len;
+    std::chrono::steady_clock::time_point done; // When the frame being sent is out
+};
+static native_dmx_t ports[DMX_NUM_MAX];
+
+static bool valid(dmx_port_t port) {
+    return port >= 0 && port < DMX_NUM_MAX && ports[port].installed;
+}
+
+bool dmx_driver_install(dmx_port_t port, dmx_config_t * config, dmx_personality_t * personalities, int personality_count) {
+    (void) config;
+    (void) personalities;
+    (void) personality_count;
+    if (port < 0 || port >= DMX_NUM_MAX) {
+        return false;
+    }
+    memset(ports[port].data, 0, DMX_PACKET_SIZE);
+    ports[port].break_len = NATIVE_DMX_BREAK;
+    ports[port].mab_len = NATIVE_DMX_MAB;
+    ports[port].installed = true;
+    return true;
+}
+
+bool dmx_set_pin(dmx_port_t port, int tx_pin, int rx_pin, int rts_pin) {
+    (void) tx_pin;
+    (void) rx_pin;
+    (void) rts_pin;
+    return valid(port);
+}
+
+uint32_t dmx_set_break_len(dmx_port_t port, uint32_t break_len) {
+    if (!valid(port)) {
+        return 0;
+    }
+    ports[port].break_len = break_len;
+    return break_len;
+}
+
+uint32_t dmx_set_mab_len(dmx_port_t port, uint32_t mab_len) {
+    if (!valid(port)) {
+        return 0;
+    }
+    ports[port].mab_len = mab_len;
+    return mab_len;
+}
+
+size_t dmx_write_offset(dmx_port_t port, size_t offset, const void * source, size_t size) {
+    if (!valid(port) || offset >= DMX_PACKET_SIZE) {
+        return 0;
+    }
+    size = min(size, DMX_PACKET_SIZE - offset);
+    memcpy(&ports[port].data[offset], source, size);
+    return size;
+}
+
+size_t dmx_write(dmx_port_t port, const void * source, size_t size) {
+    return dmx_write_offset(port, 0, source, size);
+}
+
+int dmx_write_slot(dmx_port_t port, size_t slot, uint8_t value) {
+    if (!valid(port) || slot >= DMX_PACKET_SIZE) {
+        return -1;
+    }
+    ports[port].data[slot] = value;
+    return value;
+}
+
+size_t dmx_read_offset(dmx_port_t port, size_t offset, void * destination, size_t size) {
+    if (!valid(port) || offset >= DMX_PACKET_SIZE) {
+        return 0;
+    }
+    size = min(size, DMX_PACKET_SIZE - offset);
+    memcpy(destination, &ports[port].data[offset], size);
+    return size;
+}
+
+size_t dmx_read(dmx_port_t port, void * destination, size_t size) {
+    return dmx_read_offset(port, 0, destination, size);
+}
+
+int dmx_read_slot(dmx_port_t port, size_t slot) {
+    if (!valid(port) || slot >= DMX_PACKET_SIZE) {
+        return -1;
+    }
+    return ports[port].data[slot];
+}
+
+size_t dmx_send_num(dmx_port_t port, size_t size) {
+    if (!valid(port)) {
+        return 0;
+    }
+    size = min(size, (size_t) DMX_PACKET_SIZE);
+    ports[port].done = std::chrono::steady_clock::now() + std::chrono::microseconds(ports[port].break_len + ports[port].mab_len + NATIVE_DMX_SLOT * size);
+    return size;
+}
+
+bool dmx_wait_sent(dmx_port_t port, TickType_t wait_ticks) {
+    if (!valid(port)) {
+        return false;
+    }
+    auto limit = std::chrono::steady_clock::now() + std::chrono::milliseconds(wait_ticks);
+    std::this_thread::sleep_until(min(ports[port].done, limit));
+    return std::chrono::steady_clock::now() >= ports[port].done;
+}
+
+size_t dmx_receive(dmx_port_t port, dmx_packet_t * packet, TickType_t wait_ticks) { // There's no DMX line on the host, so this always times out
+    if (packet != NULL) {
+        packet->err = DMX_ERR_TIMEOUT;
+        packet->sc = -1;
+        packet->size = 0;
+        packet->is_rdm = false;
+    }
+    if (valid(port)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(wait_ticks));
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+#ifndef _NATIVE_ESP_DMX_H_
+#define _NATIVE_ESP_DMX_H_
+// Native stand-in for esp_dmx 4.x, see the README of this library
+#include "Arduino.h"
+
+#define DMX_NUM_0 0
+#define DMX_NUM_1 1
+#define DMX_NUM_2 2
+#define DMX_NUM_MAX 3
+#define DMX_PACKET_SIZE 513
+#define DMX_SC 0x00
+#define DMX_PIN_NO_CHANGE (-1)
+#define DMX_TIMEOUT_TICK ((TickType_t) 1250) // Enough for a whole frame at the slowest timing the standard allows
+
+typedef int dmx_port_t;
+
+typedef enum {
+    DMX_OK = 0,
+    DMX_ERR_TIMEOUT,
+    DMX_ERR_UART_OVERFLOW,
+    DMX_ERR_IMPROPER_SLOT,
+    DMX_ERR_NOT_ENOUGH_SLOTS,
+    DMX_ERR_DATA_COLLISION
+} dmx_err_t;
+
+typedef struct {
+    uint32_t interrupt_flags;
+    uint16_t root_device_parameter_count;
+    uint16_t sub_device_parameter_count;
+    uint16_t model_id;
+    uint16_t product_category;
+    uint32_t software_version_id;
+    const char * software_version_label;
+    int queue_size_max;
+} dmx_config_t;
+#define DMX_CONFIG_DEFAULT {0, 32, 0, 0, 0x0100, 0, "", 32}
+
+typedef struct {
+    uint16_t footprint;
+    const char * description;
+} dmx_personality_t;
+
+typedef struct {
+    dmx_err_t err;
+    int sc;
+    size_t size;
+    bool is_rdm;
+} dmx_packet_t;
+
+bool dmx_driver_install(dmx_port_t port, dmx_config_t * config, dmx_personality_t * personalities, int personality_count);
+bool dmx_set_pin(dmx_port_t port, int tx_pin, int rx_pin, int rts_pin);
+uint32_t dmx_set_break_len(dmx_port_t port, uint32_t break_len);
+uint32_t dmx_set_mab_len(dmx_port_t port, uint32_t mab_len);
+size_t dmx_write(dmx_port_t port, const void * source, size_t size);
+size_t dmx_write_offset(dmx_port_t port, size_t offset, const void * source, size_t size);
+int dmx_write_slot(dmx_port_t port, size_t slot, uint8_t value);
+size_t dmx_read(dmx_port_t port, void * destination, size_t size);
+size_t dmx_read_offset(dmx_port_t port, size_t offset, void * destination, size_t size);
+int dmx_read_slot(dmx_port_t port, size_t slot);
+size_t dmx_send_num(dmx_port_t port, size_t size);
+bool dmx_wait_sent(dmx_port_t port, TickType_t wait_ticks);
+size_t dmx_receive(dmx_port_t port, dmx_packet_t * packet, TickType_t wait_ticks);
+#endif
@@ -0,0 +1,28 @@
+#ifndef _NATIVE_ESP_WPS_H_
+#define _NATIVE_ESP_WPS_H_
+#include <cstdint>
+
+typedef int esp_err_t;
+
+typedef enum {
+    WPS_TYPE_DISABLE = 0,
+    WPS_TYPE_PBC,
+    WPS_TYPE_PIN
+} wps_type_t;
+
+typedef struct {
+    char manufacturer[65];
+    char model_number[33];
+    char model_name[33];
+    char device_name[33];
+} wps_factory_information_t;
+
+typedef struct {
+    wps_type_t wps_type;
+    wps_factory_information_t factory_info;
+} esp_wps_config_t;
+
+esp_err_t esp_wifi_wps_enable(const esp_wps_config_t * config);
+esp_err_t esp_wifi_wps_disable();
+esp_err_t esp_wifi_wps_start(int timeout_ms);
+#endif
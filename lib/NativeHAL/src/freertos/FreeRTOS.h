@@ -0,0 +1,21 @@
+#ifndef _NATIVE_FREERTOS_H_
+#define _NATIVE_FREERTOS_H_
+// Native stand-in for FreeRTOS, see the README of this library. One tick is one ms, like the ESP32 Arduino core's default
+#include <cstdint>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void * TaskHandle_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY ((TickType_t) 0xffffffff)
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) ((TickType_t) (ms))
+#define configTICK_RATE_HZ 1000
+#define configMAX_PRIORITIES 25
+#define portYIELD_FROM_ISR(woken) ((void) (woken))
+#endif
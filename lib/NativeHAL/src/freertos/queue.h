@@ -0,0 +1,11 @@
+#ifndef _NATIVE_QUEUE_H_
+#define _NATIVE_QUEUE_H_
+#include "FreeRTOS.h"
+
+typedef void * QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+BaseType_t xQueueSend(QueueHandle_t queue, const void * item, TickType_t timeout);
+BaseType_t xQueueReceive(QueueHandle_t queue, void * item, TickType_t timeout);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+#endif
@@ -0,0 +1,10 @@
+#ifndef _NATIVE_SEMPHR_H_
+#define _NATIVE_SEMPHR_H_
+#include "queue.h"
+
+typedef void * SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t timeout);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore);
+#endif
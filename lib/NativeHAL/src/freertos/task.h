@@ -0,0 +1,18 @@
+#ifndef _NATIVE_TASK_H_
+#define _NATIVE_TASK_H_
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void * parameters);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char * name, uint32_t stack_depth, void * parameters, UBaseType_t priority, TaskHandle_t * handle, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t function, const char * name, uint32_t stack_depth, void * parameters, UBaseType_t priority, TaskHandle_t * handle);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+BaseType_t xPortGetCoreID();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t * woken);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+#endif
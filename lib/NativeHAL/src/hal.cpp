@@ -0,0 +1,436 @@
+//hal.cpp
+// Native Arduino core and FreeRTOS: time, GPIO, Serial and tasks on top of the C++ standard library.
+
+#include <Arduino.h>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <random>
+#include <cstdarg>
+#include <pthread.h>
+
+HardwareSerial Serial;
+EspClass ESP;
+
+static const auto start_time = std::chrono::steady_clock::now();
+static uint8_t pin_state[64];
+
+static std::atomic<int64_t> clock_shift(0); // us added to millis() and micros(), see nativeSetMillis()
+
+unsigned long millis() {
+    return (std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count() + clock_shift) / 1000;
+}
+
+unsigned long micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count() + clock_shift;
+}
+
+void nativeSetMillis(unsigned long ms) { // Tests only: millis() reads ms from now on and carries on counting from there, e.g. to test the 49 day wrap. Timers and delays aren't affected
+    clock_shift = (int64_t) ms * 1000 - std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+int64_t esp_timer_get_time() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+// esp_timer: a thread per timer, sleeping until it's due. The callback runs without the lock held, so it may start or stop the timer itself
+struct native_esp_timer {
+    std::mutex lock;
+    std::condition_variable changed;
+    esp_timer_create_args_t args;
+    bool armed;
+    bool deleted;
+    uint64_t period; // us, 0 for one shot
+    std::chrono::steady_clock::time_point due;
+};
+
+static void timerThread(native_esp_timer * t) {
+    std::unique_lock<std::mutex> l(t->lock);
+    while (!t->deleted) {
+        if (!t->armed) {
+            t->changed.wait(l);
+            continue;
+        }
+        if (t->changed.wait_until(l, t->due) != std::cv_status::timeout || !t->armed || std::chrono::steady_clock::now() < t->due) {
+            continue; // Restarted, stopped or woken early, look again
+        }
+        if (t->period > 0) {
+            t->due += std::chrono::microseconds(t->period);
+        } else {
+            t->armed = false;
+        }
+        l.unlock();
+        t->args.callback(t->args.arg);
+        l.lock();
+    }
+    l.unlock();
+    delete t;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t * args, esp_timer_handle_t * handle) {
+    native_esp_timer * t = new native_esp_timer;
+    t->args = *args;
+    t->armed = false;
+    t->deleted = false;
+    t->period = 0;
+    *handle = t;
+    std::thread(timerThread, t).detach();
+    return ESP_OK;
+}
+
+static esp_err_t timerStart(esp_timer_handle_t t, uint64_t timeout_us, uint64_t period_us) {
+    std::lock_guard<std::mutex> l(t->lock);
+    if (t->armed) { // Same as ESP-IDF, stop it first
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->armed = true;
+    t->period = period_us;
+    t->due = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_us);
+    t->changed.notify_all();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    return timerStart(timer, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t period_us) {
+    return timerStart(timer, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t) {
+    std::lock_guard<std::mutex> l(t->lock);
+    if (!t->armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    t->armed = false;
+    t->changed.notify_all();
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t t) { // The thread frees it once it notices
+    std::lock_guard<std::mutex> l(t->lock);
+    t->deleted = true;
+    t->changed.notify_all();
+    return ESP_OK;
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void pinMode(uint8_t pin, uint8_t mode) { // Pulled up inputs read high, like an unpressed button
+    if (mode == INPUT_PULLUP && pin < sizeof(pin_state)) {
+        pin_state[pin] = HIGH;
+    }
+}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin < sizeof(pin_state)) {
+        pin_state[pin] = value ? HIGH : LOW;
+    }
+}
+
+int digitalRead(uint8_t pin) { // Whatever was last written to the pin
+    return pin < sizeof(pin_state) ? pin_state[pin] : LOW;
+}
+
+uint16_t analogRead(uint8_t pin) {
+    (void) pin;
+    return 0;
+}
+
+uint32_t analogReadMilliVolts(uint8_t pin) {
+    (void) pin;
+    return 0;
+}
+
+uint32_t esp_random() {
+    static std::random_device device;
+    return device();
+}
+
+// Continuous ADC: a thread calls back once per set of conversions, the readings are whatever analogReadMilliVolts() says
+#define NATIVE_ADC_MAX_PINS 8
+static adc_continuous_data_t adc_results[NATIVE_ADC_MAX_PINS];
+static size_t adc_pins = 0;
+static std::chrono::microseconds adc_period;
+static void (*adc_callback)(void) = NULL;
+static std::atomic<bool> adc_running(false);
+
+bool analogContinuous(const uint8_t pins[], size_t pins_count, uint32_t conversions_per_pin, uint32_t sampling_freq_hz, void (*userFunc)(void)) {
+    if (pins_count == 0 || pins_count > NATIVE_ADC_MAX_PINS || sampling_freq_hz == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < pins_count; i++) {
+        adc_results[i] = {pins[i], (uint8_t) i, 0, 0};
+    }
+    adc_pins = pins_count;
+    adc_period = std::chrono::microseconds((uint64_t) conversions_per_pin * pins_count * 1000000 / sampling_freq_hz);
+    adc_callback = userFunc;
+    return true;
+}
+
+bool analogContinuousStart() {
+    if (adc_pins == 0 || adc_running.exchange(true)) {
+        return false;
+    }
+    std::thread([] {
+        auto next = std::chrono::steady_clock::now();
+        while (adc_running) {
+            next += adc_period;
+            std::this_thread::sleep_until(next);
+            if (adc_callback != NULL) {
+                adc_callback();
+            }
+        }
+    }).detach();
+    return true;
+}
+
+bool analogContinuousStop() {
+    return adc_running.exchange(false);
+}
+
+bool analogContinuousRead(adc_continuous_data_t ** buffer, uint32_t timeout_ms) {
+    (void) timeout_ms;
+    if (adc_pins == 0) {
+        return false;
+    }
+    for (size_t i = 0; i < adc_pins; i++) {
+        adc_results[i].avg_read_mv = analogReadMilliVolts(adc_results[i].pin);
+        adc_results[i].avg_read_raw = analogRead(adc_results[i].pin);
+    }
+    *buffer = adc_results;
+    return true;
+}
+
+size_t Print::write(const uint8_t * buffer, size_t size) {
+    size_t n = 0;
+    while (size--) {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+size_t Print::printf(const char * format, ...) {
+    char buf[256];
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    if (n < 0) {
+        return 0;
+    }
+    if ((size_t) n >= sizeof(buf)) { // Too long for the stack buffer
+        std::vector<char> big(n + 1);
+        va_start(args, format);
+        vsnprintf(big.data(), big.size(), format, args);
+        va_end(args);
+        return write(big.data(), n);
+    }
+    return write(buf, n);
+}
+
+size_t Print::print(long long v, int base) {
+    if (v < 0 && base == DEC) {
+        return print('-') + print((unsigned long long) -(v + 1) + 1, base);
+    }
+    return print((unsigned long long) v, base);
+}
+
+size_t Print::print(unsigned long long v, int base) {
+    char buf[65];
+    int i = sizeof(buf);
+    if (base < 2) base = DEC;
+    do {
+        int d = v % base;
+        buf[--i] = d < 10 ? '0' + d : 'A' + d - 10;
+        v /= base;
+    } while (v > 0);
+    return write(&buf[i], sizeof(buf) - i);
+}
+
+size_t Print::print(double v, int digits) {
+    char buf[64];
+    int n = snprintf(buf, sizeof(buf), "%.*f", digits, v);
+    return write(buf, n);
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return fwrite(&c, 1, 1, stdout);
+}
+
+size_t HardwareSerial::write(const uint8_t * buffer, size_t size) {
+    return fwrite(buffer, 1, size, stdout);
+}
+
+static std::chrono::steady_clock::time_point deadline(TickType_t timeout) {
+    if (timeout == portMAX_DELAY) {
+        return std::chrono::steady_clock::time_point::max();
+    }
+    return std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout);
+}
+
+// Tasks are detached threads. The handle remembers what the task was created with, and holds its notification count
+struct native_task_t {
+    const char * name;
+    uint32_t stack_depth;
+    std::mutex lock;
+    std::condition_variable notified;
+    uint32_t notifications;
+};
+static thread_local native_task_t * current_task = NULL;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char * name, uint32_t stack_depth, void * parameters, UBaseType_t priority, TaskHandle_t * handle, BaseType_t core) {
+    (void) priority;
+    (void) core;
+    native_task_t * task = new native_task_t;
+    task->name = name;
+    task->stack_depth = stack_depth;
+    task->notifications = 0;
+    if (handle != NULL) {
+        *handle = task;
+    }
+    std::thread([task, function, parameters] {
+        current_task = task;
+        function(parameters);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char * name, uint32_t stack_depth, void * parameters, UBaseType_t priority, TaskHandle_t * handle) {
+    return xTaskCreatePinnedToCore(function, name, stack_depth, parameters, priority, handle, 0);
+}
+
+void vTaskDelete(TaskHandle_t task) { // Only deleting yourself is supported. The main thread leaves the others running
+    if (task == NULL) {
+        pthread_exit(NULL);
+    }
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+TickType_t xTaskGetTickCount() {
+    return millis();
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) { // Host threads have megabytes of stack, so there's nothing to measure. Report the stack asked for
+    return task != NULL ? ((native_task_t *) task)->stack_depth : 0;
+}
+
+BaseType_t xPortGetCoreID() {
+    return 0;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return current_task;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t * woken) { // No interrupts here, the "ISR" is a thread like any other
+    xTaskNotifyGive(task);
+    if (woken != NULL) {
+        *woken = pdFALSE;
+    }
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task) {
+    native_task_t * t = (native_task_t *) task;
+    std::lock_guard<std::mutex> l(t->lock);
+    t->notifications++;
+    t->notified.notify_all();
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks) { // Only from a task made by xTaskCreate(), the main thread has no notifications
+    native_task_t * t = current_task;
+    std::unique_lock<std::mutex> l(t->lock);
+    if (!t->notified.wait_until(l, deadline(ticks), [t] { return t->notifications > 0; })) {
+        return 0;
+    }
+    uint32_t n = t->notifications;
+    t->notifications = clear ? 0 : n - 1;
+    return n;
+}
+
+struct native_queue_t {
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+    size_t length;
+    size_t item_size;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    native_queue_t * q = new native_queue_t;
+    q->length = length;
+    q->item_size = item_size;
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void * item, TickType_t timeout) {
+    native_queue_t * q = (native_queue_t *) queue;
+    std::unique_lock<std::mutex> l(q->lock);
+    if (!q->changed.wait_until(l, deadline(timeout), [q] { return q->items.size() < q->length; })) {
+        return pdFALSE;
+    }
+    q->items.emplace_back((const uint8_t *) item, (const uint8_t *) item + q->item_size);
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void * item, TickType_t timeout) {
+    native_queue_t * q = (native_queue_t *) queue;
+    std::unique_lock<std::mutex> l(q->lock);
+    if (!q->changed.wait_until(l, deadline(timeout), [q] { return !q->items.empty(); })) {
+        return pdFALSE;
+    }
+    memcpy(item, q->items.front().data(), q->item_size);
+    q->items.pop_front();
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    native_queue_t * q = (native_queue_t *) queue;
+    std::lock_guard<std::mutex> l(q->lock);
+    return q->items.size();
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return new std::timed_mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t timeout) {
+    std::timed_mutex * m = (std::timed_mutex *) semaphore;
+    if (timeout == portMAX_DELAY) {
+        m->lock();
+        return pdTRUE;
+    }
+    return m->try_lock_for(std::chrono::milliseconds(timeout)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t semaphore) {
+    ((std::timed_mutex *) semaphore)->unlock();
+    return pdTRUE;
+}
+
+#ifndef PIO_UNIT_TESTING
+int main() { // What the Arduino core's main task does. Unit tests bring their own main()
+    setvbuf(stdout, NULL, _IONBF, 0); // Serial output shows up right away, like on the real thing
+    setup();
+    while (true) {
+        loop();
+    }
+}
+#endif
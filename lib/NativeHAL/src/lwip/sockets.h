@@ -0,0 +1,10 @@
+#ifndef _NATIVE_LWIP_SOCKETS_H_
+#define _NATIVE_LWIP_SOCKETS_H_
+// lwIP has the BSD socket API, the host's is the real thing
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <errno.h>
+#include <unistd.h>
+#endif
@@ -0,0 +1,140 @@
+//mbedtls.cpp
+// Native mbedtls: SHA-1 (FIPS 180-4) and base64 (RFC 4648), all the WebSocket handshake needs.
+
+#include <mbedtls/sha1.h>
+#include <mbedtls/base64.h>
+#include <cstdint>
+#include <cstring>
+
+static uint32_t rol(uint32_t x, int n) {
+    return (x << n) | (x >> (32 - n));
+}
+
+static void sha1_block(uint32_t h[5], const unsigned char * p) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t) p[i * 4] << 24) | (p[i * 4 + 1] << 16) | (p[i * 4 + 2] << 8) | p[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = rol(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+        uint32_t t = rol(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+int mbedtls_sha1(const unsigned char * input, size_t length, unsigned char output[20]) {
+    uint32_t h[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64) {
+        sha1_block(h, &input[i]);
+    }
+    unsigned char last[128] = {0}; // Rest of the input, the 1 bit, padding and the length in bits
+    size_t rest = length - i;
+    memcpy(last, &input[i], rest);
+    last[rest] = 0x80;
+    size_t blocks = rest + 9 > 64 ? 2 : 1;
+    uint64_t bits = (uint64_t) length * 8;
+    for (int b = 0; b < 8; b++) {
+        last[blocks * 64 - 1 - b] = bits >> (b * 8);
+    }
+    for (size_t b = 0; b < blocks; b++) {
+        sha1_block(h, &last[b * 64]);
+    }
+    for (int b = 0; b < 20; b++) {
+        output[b] = h[b / 4] >> (24 - (b % 4) * 8);
+    }
+    return 0;
+}
+
+int mbedtls_base64_encode(unsigned char * destination, size_t length, size_t * written, const unsigned char * source, size_t source_length) {
+    static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t needed = (source_length + 2) / 3 * 4 + 1; // Including the terminating null
+    *written = needed;
+    if (length < needed) {
+        return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < source_length; i += 3) {
+        uint32_t v = source[i] << 16;
+        if (i + 1 < source_length) v |= source[i + 1] << 8;
+        if (i + 2 < source_length) v |= source[i + 2];
+        destination[n++] = alphabet[(v >> 18) & 0x3f];
+        destination[n++] = alphabet[(v >> 12) & 0x3f];
+        destination[n++] = i + 1 < source_length ? alphabet[(v >> 6) & 0x3f] : '=';
+        destination[n++] = i + 2 < source_length ? alphabet[v & 0x3f] : '=';
+    }
+    destination[n] = '\0';
+    *written = n;
+    return 0;
+}
+
+static int base64_value(unsigned char c) {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+}
+
+int mbedtls_base64_decode(unsigned char * destination, size_t length, size_t * written, const unsigned char * source, size_t source_length) { // Whitespace is skipped, = only at the end
+    size_t n = 0;
+    uint32_t v = 0;
+    int bits = 0;
+    int padding = 0;
+    for (size_t i = 0; i < source_length; i++) {
+        unsigned char c = source[i];
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            continue;
+        }
+        if (c == '=') {
+            padding++;
+            continue;
+        }
+        int d = base64_value(c);
+        if (d < 0 || padding > 0) {
+            return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+        }
+        v = (v << 6) | d;
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            if (n >= length) {
+                *written = n + 1;
+                return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+            }
+            destination[n++] = v >> bits;
+        }
+    }
+    if (padding > 2) {
+        return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+    }
+    *written = n;
+    return 0;
+}
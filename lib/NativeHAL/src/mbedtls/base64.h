@@ -0,0 +1,10 @@
+#ifndef _NATIVE_MBEDTLS_BASE64_H_
+#define _NATIVE_MBEDTLS_BASE64_H_
+#include <cstddef>
+
+#define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL -0x002A
+#define MBEDTLS_ERR_BASE64_INVALID_CHARACTER -0x002C
+
+int mbedtls_base64_encode(unsigned char * destination, size_t length, size_t * written, const unsigned char * source, size_t source_length);
+int mbedtls_base64_decode(unsigned char * destination, size_t length, size_t * written, const unsigned char * source, size_t source_length);
+#endif
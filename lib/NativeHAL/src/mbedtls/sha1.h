@@ -0,0 +1,6 @@
+#ifndef _NATIVE_MBEDTLS_SHA1_H_
+#define _NATIVE_MBEDTLS_SHA1_H_
+#include <cstddef>
+
+int mbedtls_sha1(const unsigned char * input, size_t length, unsigned char output[20]);
+#endif
@@ -0,0 +1,4 @@
+#ifndef _NATIVE_MBEDTLS_VERSION_H_
+#define _NATIVE_MBEDTLS_VERSION_H_
+#define MBEDTLS_VERSION_NUMBER 0x03000000 // The 3.x names, without the _ret suffix
+#endif
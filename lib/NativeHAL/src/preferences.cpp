@@ -0,0 +1,119 @@
+//preferences.cpp
+// Native Preferences: NVS as a map in memory, keyed by namespace and key.
+
+#include <Preferences.h>
+#include <map>
+#include <mutex>
+#include <vector>
+
+static std::map<std::string, std::vector<uint8_t>> store;
+static std::mutex store_lock;
+
+bool Preferences::begin(const char * name, bool readonly, const char * partition) {
+    (void) partition;
+    ns = std::string(name) + "/";
+    this->readonly = readonly;
+    started = true;
+    return true;
+}
+
+void Preferences::end() {
+    started = false;
+}
+
+bool Preferences::clear() {
+    if (!started || readonly) {
+        return false;
+    }
+    std::lock_guard<std::mutex> l(store_lock);
+    for (auto i = store.begin(); i != store.end();) {
+        i = i->first.compare(0, ns.size(), ns) == 0 ? store.erase(i) : std::next(i);
+    }
+    return true;
+}
+
+bool Preferences::remove(const char * key) {
+    if (!started || readonly) {
+        return false;
+    }
+    std::lock_guard<std::mutex> l(store_lock);
+    return store.erase(ns + key) > 0;
+}
+
+bool Preferences::isKey(const char * key) {
+    std::lock_guard<std::mutex> l(store_lock);
+    return started && store.count(ns + key) > 0;
+}
+
+size_t Preferences::putBytes(const char * key, const void * value, size_t length) {
+    if (!started || readonly || key == NULL || strlen(key) > 15) { // NVS keys are 15 characters at most
+        return 0;
+    }
+    std::lock_guard<std::mutex> l(store_lock);
+    store[ns + key].assign((const uint8_t *) value, (const uint8_t *) value + length);
+    return length;
+}
+
+size_t Preferences::getBytesLength(const char * key) {
+    std::lock_guard<std::mutex> l(store_lock);
+    auto i = store.find(ns + key);
+    return started && i != store.end() ? i->second.size() : 0;
+}
+
+size_t Preferences::getBytes(const char * key, void * buffer, size_t length) { // Like NVS, fails if the buffer is too small
+    std::lock_guard<std::mutex> l(store_lock);
+    auto i = store.find(ns + key);
+    if (!started || i == store.end() || i->second.size() > length) {
+        return 0;
+    }
+    memcpy(buffer, i->second.data(), i->second.size());
+    return i->second.size();
+}
+
+size_t Preferences::putString(const char * key, const char * value) {
+    return putBytes(key, value, strlen(value) + 1) > 0 ? strlen(value) : 0;
+}
+
+size_t Preferences::getString(const char * key, char * value, size_t length) {
+    size_t n = getBytes(key, value, length);
+    if (n == 0 && length > 0) {
+        value[0] = '\0';
+    }
+    return n;
+}
+
+size_t Preferences::putUChar(const char * key, uint8_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+uint8_t Preferences::getUChar(const char * key, uint8_t default_value) {
+    uint8_t v;
+    return getBytesLength(key) == sizeof(v) && getBytes(key, &v, sizeof(v)) ? v : default_value;
+}
+
+size_t Preferences::putShort(const char * key, int16_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+int16_t Preferences::getShort(const char * key, int16_t default_value) {
+    int16_t v;
+    return getBytesLength(key) == sizeof(v) && getBytes(key, &v, sizeof(v)) ? v : default_value;
+}
+
+size_t Preferences::putUShort(const char * key, uint16_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+uint16_t Preferences::getUShort(const char * key, uint16_t default_value) {
+    uint16_t v;
+    return getBytesLength(key) == sizeof(v) && getBytes(key, &v, sizeof(v)) ? v : default_value;
+}
+
+size_t Preferences::putUInt(const char * key, uint32_t value) {
+    return putBytes(key, &value, sizeof(value));
+}
+
+uint32_t Preferences::getUInt(const char * key, uint32_t default_value) {
+    uint32_t v;
+    return getBytesLength(key) == sizeof(v) && getBytes(key, &v, sizeof(v)) ? v : default_value;
+}
@@ -0,0 +1,376 @@
+//wifi.cpp
+// Native WiFi: always connected, with BSD sockets underneath WiFiServer, WiFiClient and WiFiUDP.
+
+#include <WiFi.h>
+#include <esp_wps.h>
+#include <lwip/sockets.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+
+WiFiClass WiFi;
+
+wl_status_t WiFiClass::status() {
+    return WL_CONNECTED;
+}
+
+bool WiFiClass::mode(wifi_mode_t mode) {
+    (void) mode;
+    return true;
+}
+
+wl_status_t WiFiClass::begin() {
+    return WL_CONNECTED;
+}
+
+wl_status_t WiFiClass::begin(const char * ssid, const char * password, int32_t channel, const uint8_t * bssid, bool connect) {
+    (void) ssid;
+    (void) password;
+    (void) channel;
+    (void) bssid;
+    (void) connect;
+    return WL_CONNECTED;
+}
+
+bool WiFiClass::reconnect() {
+    return true;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+    (void) wifioff;
+    (void) eraseap;
+    return true;
+}
+
+void WiFiClass::onEvent(WiFiEventFuncCb callback) { // Nothing ever happens to the host's WiFi
+    (void) callback;
+}
+
+String WiFiClass::SSID() {
+    return String("native");
+}
+
+String WiFiClass::psk() {
+    return String("");
+}
+
+uint8_t * WiFiClass::BSSID() {
+    static uint8_t native_bssid[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0xfe};
+    return native_bssid;
+}
+
+int32_t WiFiClass::channel() {
+    return 1;
+}
+
+IPAddress WiFiClass::localIP() {
+    return IPAddress(127, 0, 0, 1);
+}
+
+uint8_t * WiFiClass::macAddress(uint8_t * mac) {
+    static const uint8_t native_mac[6] = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01}; // Locally administered
+    memcpy(mac, native_mac, 6);
+    return mac;
+}
+
+int8_t WiFiClass::RSSI() {
+    return -50;
+}
+
+esp_err_t esp_wifi_wps_enable(const esp_wps_config_t * config) {
+    (void) config;
+    return 0;
+}
+
+esp_err_t esp_wifi_wps_disable() {
+    return 0;
+}
+
+esp_err_t esp_wifi_wps_start(int timeout_ms) {
+    (void) timeout_ms;
+    return 0;
+}
+
+size_t IPAddress::printTo(Print & p) const {
+    size_t n = 0;
+    for (int i = 0; i < 4; i++) {
+        if (i > 0) n += p.print('.');
+        n += p.print(bytes[i], DEC);
+    }
+    return n;
+}
+
+WiFiClient::socket_t::~socket_t() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+WiFiClient::WiFiClient() {}
+
+WiFiClient::WiFiClient(int fd) : sock(new socket_t{fd}) {}
+
+int WiFiClient::fd() const {
+    return sock ? sock->fd : -1;
+}
+
+uint8_t WiFiClient::connected() { // Open, and the other side hasn't closed it (data still waiting counts as connected)
+    if (fd() < 0) {
+        return 0;
+    }
+    uint8_t c;
+    int n = recv(fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))) {
+        return 1;
+    }
+    stop();
+    return 0;
+}
+
+WiFiClient::operator bool() {
+    return connected();
+}
+
+void WiFiClient::stop() {
+    sock.reset();
+}
+
+int WiFiClient::setNoDelay(bool nodelay) {
+    int flag = nodelay;
+    return setsockopt(fd(), IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+void WiFiClient::setTimeout(unsigned long timeout) { // ms, like the ESP32 core: how long one write may wait for the other side to take data
+    timeval tv = {(time_t) (timeout / 1000), (suseconds_t) (timeout % 1000 * 1000)};
+    setsockopt(fd(), SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+IPAddress WiFiClient::remoteIP() {
+    sockaddr_in a;
+    socklen_t len = sizeof(a);
+    if (getpeername(fd(), (sockaddr *) &a, &len) != 0) {
+        return IPAddress();
+    }
+    return IPAddress((uint32_t) a.sin_addr.s_addr);
+}
+
+int WiFiClient::available() {
+    int n = 0;
+    if (fd() < 0 || ioctl(fd(), FIONREAD, &n) != 0) {
+        return 0;
+    }
+    return n;
+}
+
+int WiFiClient::read() {
+    uint8_t c;
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int WiFiClient::read(uint8_t * buffer, size_t size) { // Whatever is there, without waiting
+    if (fd() < 0) {
+        return -1;
+    }
+    int n = recv(fd(), buffer, size, MSG_DONTWAIT);
+    return n < 0 ? -1 : n;
+}
+
+int WiFiClient::peek() {
+    uint8_t c;
+    if (fd() < 0 || recv(fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT) != 1) {
+        return -1;
+    }
+    return c;
+}
+
+size_t WiFiClient::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t WiFiClient::write(const uint8_t * buffer, size_t size) { // Blocks until it's all out or setTimeout() runs out, like the ESP32 version
+    size_t sent = 0;
+    while (fd() >= 0 && sent < size) {
+        int n = send(fd(), &buffer[sent], size - sent, MSG_NOSIGNAL);
+        if (n <= 0) {
+            break;
+        }
+        sent += n;
+    }
+    return sent;
+}
+
+WiFiServer::WiFiServer(uint16_t port) : port(port), fd(-1), pending(-1), nodelay(false) {}
+
+void WiFiServer::begin() {
+    fd = socket(AF_INET, SOCK_STREAM, 0);
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    a.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (sockaddr *) &a, sizeof(a)) != 0 || listen(fd, 8) != 0) {
+        perror("WiFiServer");
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+}
+
+void WiFiServer::end() {
+    if (pending >= 0) ::close(pending);
+    if (fd >= 0) ::close(fd);
+    fd = pending = -1;
+}
+
+void WiFiServer::setNoDelay(bool nodelay) {
+    this->nodelay = nodelay;
+}
+
+bool WiFiServer::hasClient() {
+    if (pending < 0 && fd >= 0) {
+        pending = ::accept(fd, NULL, NULL);
+    }
+    return pending >= 0;
+}
+
+WiFiClient WiFiServer::available() {
+    if (!hasClient()) {
+        return WiFiClient();
+    }
+    WiFiClient client(pending);
+    pending = -1;
+    if (nodelay) {
+        client.setNoDelay(true);
+    }
+    return client;
+}
+
+WiFiClient WiFiServer::accept() {
+    return available();
+}
+
+WiFiUDP::WiFiUDP() : fd(-1), rx_size(0), rx_pos(0), tx_size(0), tx_port(0), remote_port(0) {}
+
+WiFiUDP::~WiFiUDP() {
+    stop();
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+    stop();
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    setsockopt(fd, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+    sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(port);
+    a.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(fd, (sockaddr *) &a, sizeof(a)) != 0) {
+        perror("WiFiUDP");
+        stop();
+        return 0;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return 1;
+}
+
+uint8_t WiFiUDP::beginMulticast(IPAddress group, uint16_t port) {
+    if (!begin(port)) {
+        return 0;
+    }
+    ip_mreq m = {};
+    m.imr_multiaddr.s_addr = (uint32_t) group;
+    m.imr_interface.s_addr = htonl(INADDR_ANY);
+    setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &m, sizeof(m)); // May fail without a multicast route, unicast still works then
+    return 1;
+}
+
+void WiFiUDP::stop() {
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    rx_size = rx_pos = 0;
+}
+
+int WiFiUDP::parsePacket() { // Take the next datagram, if any. Returns its size
+    rx_size = rx_pos = 0;
+    if (fd < 0) {
+        return 0;
+    }
+    sockaddr_in a;
+    socklen_t len = sizeof(a);
+    int n = recvfrom(fd, rx, sizeof(rx), 0, (sockaddr *) &a, &len);
+    if (n <= 0) {
+        return 0;
+    }
+    rx_size = n;
+    remote_ip = IPAddress((uint32_t) a.sin_addr.s_addr);
+    remote_port = ntohs(a.sin_port);
+    return n;
+}
+
+int WiFiUDP::available() {
+    return rx_size - rx_pos;
+}
+
+int WiFiUDP::read() {
+    return rx_pos < rx_size ? rx[rx_pos++] : -1;
+}
+
+int WiFiUDP::read(unsigned char * buffer, size_t size) {
+    size_t n = min(size, rx_size - rx_pos);
+    memcpy(buffer, &rx[rx_pos], n);
+    rx_pos += n;
+    return n;
+}
+
+int WiFiUDP::read(char * buffer, size_t size) {
+    return read((unsigned char *) buffer, size);
+}
+
+int WiFiUDP::peek() {
+    return rx_pos < rx_size ? rx[rx_pos] : -1;
+}
+
+void WiFiUDP::flush() {
+    rx_pos = rx_size;
+}
+
+IPAddress WiFiUDP::remoteIP() {
+    return remote_ip;
+}
+
+uint16_t WiFiUDP::remotePort() {
+    return remote_port;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+    tx_ip = ip;
+    tx_port = port;
+    tx_size = 0;
+    return 1;
+}
+
+size_t WiFiUDP::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t WiFiUDP::write(const uint8_t * buffer, size_t size) {
+    size_t n = min(size, sizeof(tx) - tx_size);
+    memcpy(&tx[tx_size], buffer, n);
+    tx_size += n;
+    return n;
+}
+
+int WiFiUDP::endPacket() {
+    sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_port = htons(tx_port);
+    a.sin_addr.s_addr = (uint32_t) tx_ip;
+    int n = sendto(fd, tx, tx_size, 0, (sockaddr *) &a, sizeof(a));
+    tx_size = 0;
+    return n >= 0;
+}
@@ -0,0 +1,161 @@
+//artnet.cpp
+// Usage:
+//      - Create object with the net, subnet and universe (together the 15 bit Port-Address) the node should listen to
+//      - For more than one output, setPorts() before begin(). The outputs listen to consecutive universes from there on
+//      - Call begin() once WiFi is up, this opens the UDP port and prepares the ArtPollReply
+//      - Call receive() regularly. ArtPoll is answered internally, for an ArtDmx to our Port-Address it returns the number of DMX slots waiting, and port() which output they're for
+//      - Read the slots with readDMX() directly into the destination frame - no intermediate copy of the data
+// Only the output side of a node is implemented (ArtDmx to DMX), we never send ArtDmx ourselves.
+
+#include "artnet.h"
+
+static const uint8_t artnet_id[8] = {'A', 'r', 't', '-', 'N', 'e', 't', '\0'};
+
+ArtNetNode::ArtNetNode() : ArtNetNode(0, 0, 0) {} // Default to Port-Address 0:0:0, which is what most desks start at
+
+ArtNetNode::ArtNetNode(uint8_t net, uint8_t subnet, uint8_t universe) {
+    memset(reply, 0, ARTNET_POLLREPLY_SIZE);
+    ports = 1;
+    current_port = 0;
+    setPortAddress(net, subnet, universe); // Also stores the switches in the ArtPollReply
+    pending = 0;
+    memset(last_sequence, 0, sizeof(last_sequence));
+    dmx_packets = 0;
+}
+
+void ArtNetNode::begin(const char * shortname, const char * longname) {
+    buildPollReply(shortname, longname);
+    udp.begin(ARTNET_PORT);
+}
+
+void ArtNetNode::setPortAddress(uint8_t net, uint8_t subnet, uint8_t universe) {
+    port_address = ((net & 0x7f) << 8) | ((subnet & 0x0f) << 4) | (universe & 0x0f);
+    reply[18] = net & 0x7f; // NetSwitch
+    reply[19] = subnet & 0x0f; // SubSwitch
+    for (int i = 0; i < ports; i++) {
+        reply[190 + i] = (universe + i) & 0x0f; // SwOut[i]
+    }
+}
+
+bool ArtNetNode::setPorts(int count) { // Number of outputs. They all have to fit in the subnet of the Port-Address, returns false if they don't
+    if (count < 1 || count > ARTNET_MAX_PORTS || (port_address & 0x0f) + count > 16) {
+        return false;
+    }
+    ports = count;
+    setPortAddress(port_address >> 8, (port_address >> 4) & 0x0f, port_address & 0x0f);
+    return true;
+}
+
+int ArtNetNode::port() { // Output (0 based) of the packet found by receive()
+    return current_port;
+}
+
+uint16_t ArtNetNode::portAddress() {
+    return port_address;
+}
+
+unsigned long ArtNetNode::dmxPackets() {
+    return dmx_packets;
+}
+
+bool ArtNetNode::decodeHeader(const uint8_t * packet, size_t size, header_t & header) { // Check an incoming packet and pick out the interesting header fields. Returns false for anything that isn't Art-Net
+    header.opcode = opcode_t::none;
+    header.sequence = 0;
+    header.portaddress = 0;
+    header.length = 0;
+    if (size < 10 || memcmp(packet, artnet_id, sizeof(artnet_id)) != 0) {
+        return false;
+    }
+    uint16_t opcode = packet[8] | (packet[9] << 8); // OpCode is the only little endian field in the protocol
+    if (opcode == (uint16_t) opcode_t::poll) {
+        header.opcode = opcode_t::poll;
+        return true;
+    }
+    if (opcode != (uint16_t) opcode_t::dmx || size < ARTNET_HEADER_SIZE) {
+        return false; // Some other opcode we don't handle, or a truncated ArtDmx
+    }
+    if (((packet[10] << 8) | packet[11]) < ARTNET_PROTOCOL_VERSION) {
+        return false;
+    }
+    header.opcode = opcode_t::dmx;
+    header.sequence = packet[12];
+    header.portaddress = ((packet[15] & 0x7f) << 8) | packet[14]; // Net, then SubUni
+    header.length = (packet[16] << 8) | packet[17];
+    if (header.length > 512) { // Silently clamp silly lengths, a universe never holds more than 512 slots
+        header.length = 512;
+    }
+    return true;
+}
+
+uint16_t ArtNetNode::receive() { // Check for a new packet. Handles ArtPoll internally, returns the number of DMX slots available for readDMX() if an ArtDmx for our Port-Address arrived
+    pending = 0;
+    int size = udp.parsePacket();
+    if (size <= 0) {
+        return 0;
+    }
+    uint8_t packet[ARTNET_HEADER_SIZE];
+    int n = udp.read(packet, ARTNET_HEADER_SIZE); // Only the header, the data stays in the UDP buffer until someone wants it
+    header_t header;
+    if (n <= 0 || !decodeHeader(packet, n, header)) {
+        return 0;
+    }
+    if (header.opcode == opcode_t::poll) {
+        sendPollReply(udp.remoteIP());
+        return 0;
+    }
+    uint16_t p = header.portaddress - port_address; // Wraps to something huge below our first universe
+    if (p >= ports) {
+        return 0;
+    }
+    // Sequence 0 means the sender doesn't do sequencing. Otherwise throw away packets that arrive late (behind the last one we used)
+    int8_t diff = (int8_t) (header.sequence - last_sequence[p]);
+    if (header.sequence != 0 && last_sequence[p] != 0 && diff <= 0 && diff > -20) {
+        return 0;
+    }
+    last_sequence[p] = header.sequence;
+    current_port = p;
+    dmx_packets++;
+    pending = min((int) header.length, size - ARTNET_HEADER_SIZE);
+    return pending;
+}
+
+size_t ArtNetNode::readDMX(uint8_t * dest, size_t size) { // Read the DMX slots of the packet found by receive() straight into dest
+    size_t n = min((size_t) pending, size);
+    pending = 0;
+    if (n == 0) {
+        return 0;
+    }
+    int r = udp.read(dest, n);
+    return r > 0 ? r : 0;
+}
+
+void ArtNetNode::buildPollReply(const char * shortname, const char * longname) { // Fill in the static parts of the ArtPollReply, see the Art-Net 4 spec for the layout
+    memcpy(reply, artnet_id, sizeof(artnet_id));
+    reply[8] = (uint16_t) opcode_t::pollreply & 0xff;
+    reply[9] = (uint16_t) opcode_t::pollreply >> 8;
+    reply[14] = ARTNET_PORT & 0xff; // Port is little endian as well
+    reply[15] = ARTNET_PORT >> 8;
+    reply[23] = 0xd0; // Status1: indicators normal, Port-Address set from network
+    strncpy((char *) &reply[26], shortname, 17); // ShortName, 18 bytes null terminated
+    strncpy((char *) &reply[44], longname, 63); // LongName, 64 bytes null terminated
+    reply[173] = ports; // NumPorts (low byte)
+    for (int i = 0; i < ports; i++) {
+        reply[174 + i] = 0x80; // PortTypes[i]: can output DMX512 from Art-Net
+        reply[182 + i] = 0x80; // GoodOutput[i]: data is being transmitted
+    }
+    reply[200] = 0x00; // Style: StNode
+    WiFi.macAddress(&reply[201]);
+    reply[212] = 0x08; // Status2: supports 15 bit Port-Address
+}
+
+void ArtNetNode::sendPollReply(IPAddress destination) {
+    IPAddress ip = WiFi.localIP();
+    for (int i = 0; i < 4; i++) {
+        reply[10 + i] = ip[i]; // IP address
+        reply[207 + i] = ip[i]; // BindIp
+    }
+    snprintf((char *) &reply[108], 64, "#0001 [%04lu] DMX packets: %lu", (dmx_packets % 10000), dmx_packets); // NodeReport
+    udp.beginPacket(destination, ARTNET_PORT);
+    udp.write(reply, ARTNET_POLLREPLY_SIZE);
+    udp.endPacket();
+}
@@ -0,0 +1,78 @@
+//chunkedprint.cpp
+// Usage:
+//      - Send the HTTP status line and headers (including "Transfer-Encoding: chunked" when chunked) to the client as usual
+//      - Create a ChunkedPrint on top of the client and print() the body into it - it's a Print, so all the usual print() flavours work
+//      - Data is collected in a small fixed buffer and sent as one chunk whenever it fills up, so memory use doesn't grow with the page size
+//      - Call end() when done, which sends what's left and the terminating zero-length chunk
+// Once a write comes up short (the client timed out) the rest is dropped, so a stalled client costs one write timeout rather than one per chunk.
+
+#include "chunkedprint.h"
+
+ChunkedPrint::ChunkedPrint(Print & target, bool chunked) : out(target), chunked(chunked) {
+    used = 0;
+    sent = 0;
+    stalled = false;
+    start_time = micros();
+    first_byte_time = 0;
+}
+
+size_t ChunkedPrint::write(uint8_t c) {
+    if (used == HTTP_CHUNK_SIZE) {
+        flush();
+    }
+    buffer[used++] = c;
+    return 1;
+}
+
+size_t ChunkedPrint::write(const uint8_t * data, size_t size) { // Copy as much as fits in one go, flushing whenever the buffer fills up
+    size_t left = size;
+    while (left > 0) {
+        if (used == HTTP_CHUNK_SIZE) {
+            flush();
+        }
+        size_t n = min(left, HTTP_CHUNK_SIZE - used);
+        memcpy(&buffer[used], data, n);
+        used += n;
+        data += n;
+        left -= n;
+    }
+    return size;
+}
+
+void ChunkedPrint::flush() { // Send the buffer as one chunk: size in hex, CRLF, data, CRLF
+    if (used == 0) { // A zero size chunk would end the body
+        return;
+    }
+    if (stalled) {
+        used = 0;
+        return;
+    }
+    if (chunked) {
+        out.print(used, HEX);
+        out.print("\r\n");
+    }
+    stalled = out.write(buffer, used) != used;
+    if (chunked && !stalled) {
+        out.print("\r\n");
+    }
+    if (sent == 0) {
+        first_byte_time = micros() - start_time;
+    }
+    sent += used;
+    used = 0;
+}
+
+void ChunkedPrint::end() { // Send the rest, and the last (empty) chunk to tell the client the body is complete
+    flush();
+    if (chunked && !stalled) {
+        out.print("0\r\n\r\n");
+    }
+}
+
+size_t ChunkedPrint::bytesSent() { // Body bytes sent so far, not counting chunk framing
+    return sent;
+}
+
+unsigned long ChunkedPrint::firstByteTime() { // Microseconds from creation until the first chunk went out
+    return first_byte_time;
+}
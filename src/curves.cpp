@@ -0,0 +1,158 @@
+//curves.cpp
+// Response curves: gamma correction, custom curves and min/max limits, applied to each slot on its way to the DMX driver.
+// Usage:
+//      - Create with the NVS namespace to use (one per universe), call begin() once in setup(), it reads curves and assignments from NVS (flash) and builds the lookup tables
+//      - define() sets curve 1 to CURVE_MAX - 1 (curve 0 is always the straight line), assign() gives a range of addresses a curve. Both are stored right away
+//      - DMX task, every frame: apply() returns the frame to send - the transformed copy, or the frame itself if no address has a curve
+// Every curve is compiled into a 256 entry table when it's defined, so the per-frame work is one table lookup per slot and no maths.
+// A definition changing while a frame is transformed may leave that one frame with a mix of the old and new table, nothing worse.
+
+#include "curves.h"
+
+ResponseCurves::ResponseCurves() : ResponseCurves("curves") {}
+
+ResponseCurves::ResponseCurves(const char * name) {
+    prefs_name = name;
+    for (auto& c : curves) {
+        c = {100, 0, 255, 0, {0}, {0}};
+    }
+    memset(map, 0, sizeof(map));
+    memset(out, 0, sizeof(out));
+    used.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < CURVE_MAX; i++) {
+        build(i);
+    }
+}
+
+void ResponseCurves::begin() {
+    prefs.begin(prefs_name, false);
+    if (prefs.getBytesLength("defs") == sizeof(curves)) {
+        prefs.getBytes("defs", curves, sizeof(curves));
+    }
+    if (prefs.getBytesLength("map") == sizeof(map)) {
+        prefs.getBytes("map", map, sizeof(map));
+    }
+    curves[0] = {100, 0, 255, 0, {0}, {0}};
+    for (int i = 0; i < CURVE_MAX; i++) {
+        if (curves[i].points > CURVE_POINTS) { // Don't trust flash blindly
+            curves[i].points = 0;
+        }
+        build(i);
+    }
+    for (auto& m : map) {
+        if (m >= CURVE_MAX) m = 0;
+    }
+    count();
+}
+
+void ResponseCurves::build(int id) { // Compile a curve into its table. Floats are fine here, this only runs when a curve is defined
+    const curve_t& c = curves[id];
+    uint8_t lut[256]; // Built aside and copied in one go, keeps the window for a mixed frame short
+    for (int v = 0; v < 256; v++) {
+        float y; // Shape of the curve, 0-1
+        if (c.points == 0) {
+            y = powf(v / 255.0f, c.gamma / 100.0f);
+        } else if (v <= c.in[0]) {
+            y = c.out[0] / 255.0f;
+        } else if (v >= c.in[c.points - 1]) {
+            y = c.out[c.points - 1] / 255.0f;
+        } else { // Straight lines between the points
+            int p = 1;
+            while (c.in[p] < v) p++;
+            y = (c.out[p - 1] + (float) (c.out[p] - c.out[p - 1]) * (v - c.in[p - 1]) / (c.in[p] - c.in[p - 1])) / 255.0f;
+        }
+        lut[v] = (uint8_t) lroundf(c.min + y * (c.max - c.min)); // min > max turns the curve upside down, which is fine
+    }
+    memcpy(luts[id], lut, 256);
+}
+
+void ResponseCurves::count() {
+    int n = 0;
+    for (auto m : map) {
+        if (m != 0) n++;
+    }
+    used.store(n, std::memory_order_relaxed);
+}
+
+bool ResponseCurves::define(int id, const curve_t & c) { // Set curve id (1 to CURVE_MAX - 1). Returns false if it isn't valid
+    if (id < 1 || id >= CURVE_MAX || c.points > CURVE_POINTS || c.points == 1 || c.gamma == 0) {
+        return false;
+    }
+    for (int p = 1; p < c.points; p++) {
+        if (c.in[p] <= c.in[p - 1]) // Points must be in order
+            return false;
+    }
+    curves[id] = c;
+    build(id);
+    prefs.putBytes("defs", curves, sizeof(curves));
+    return true;
+}
+
+bool ResponseCurves::assign(int first, int last, int id) { // Give addresses first to last (0 based, inclusive) curve id. 0 takes their curve away
+    if (first < 0 || last >= DMXArraySize || first > last || id < 0 || id >= CURVE_MAX) {
+        return false;
+    }
+    memset(&map[first], id, last - first + 1);
+    count();
+    prefs.putBytes("map", map, sizeof(map));
+    return true;
+}
+
+const ResponseCurves::curve_t & ResponseCurves::curve(int id) {
+    return curves[id];
+}
+
+int ResponseCurves::curveOf(int address) {
+    return map[address];
+}
+
+int ResponseCurves::channels(int id) { // Number of addresses using curve id
+    int n = 0;
+    for (auto m : map) {
+        if (m == id) n++;
+    }
+    return n;
+}
+
+int ResponseCurves::assigned() { // Number of addresses with a curve
+    return used.load(std::memory_order_relaxed);
+}
+
+const uint8_t * ResponseCurves::apply(const uint8_t * frame, int slots) { // DMX task: transform slots 1 to slots of frame (start code at 0). Returns what to send
+    if (used.load(std::memory_order_relaxed) == 0) { // Nothing to do, send the frame as it is
+        return frame;
+    }
+    out[0] = frame[0];
+    const uint8_t * m = map;
+    for (int s = 1; s <= slots; s++) {
+        out[s] = luts[m[s - 1]][frame[s]];
+    }
+    return out;
+}
+
+bool ResponseCurves::parseGamma(const char * s, size_t length, uint16_t & gamma) { // "2.2" -> 220. Up to two decimals, 0.01 to 9.99
+    uint32_t v = 0;
+    int decimals = -1; // -1 until the point is seen
+    for (size_t i = 0; i < length; i++) {
+        if (s[i] == '.' && decimals < 0) {
+            decimals = 0;
+        } else if (isDigit(s[i]) && decimals < 2) {
+            v = v * 10 + (s[i] - '0');
+            if (decimals >= 0) decimals++;
+            if (v > 999) return false;
+        } else {
+            return false;
+        }
+    }
+    if (length == 0 || decimals == 0) {
+        return false;
+    }
+    for (int d = max(decimals, 0); d < 2; d++) {
+        v *= 10;
+    }
+    if (v == 0 || v > 999) {
+        return false;
+    }
+    gamma = v;
+    return true;
+}
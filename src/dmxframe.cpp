@@ -0,0 +1,119 @@
+//dmxframe.cpp
+// Triple buffer handing DMX frames from the producers (HTTP, Art-Net, sACN...) to the DMX task.
+// Usage:
+//      - Call begin() once in setup(), before any task uses it
+//      - Producers: beginWrite() returns the working copy of the universe (512 slots, slot 0 is DMX address 1). Change what you like, tell markDirty() which slots you touched, then endWrite() to publish.
+//        Only slots whose value really changed count, a sender refreshing the same look 40 times a second publishes nothing
+//      - The DMX task calls acquire() every frame. It returns the newest complete packet (start code included) and the range of slots changed since the last call - only those need to go to the driver
+//      - slotsUsed() is the highest slot ever marked dirty, so the DMX task can send frames only as long as they need to be
+//      - version() counts the frames published (with at least one slot changed), so anyone can tell cheaply whether something changed. slotVersion() is the frame that last changed a slot, for sending only the changes since a given version
+// The DMX task never waits for anyone and never sees a half written frame: publishing and acquiring are each a single atomic exchange of a buffer index.
+// Producers only wait for each other (they share the working copy, so partial updates like a single set= keep everything else), never for the DMX task.
+// Each frame remembers which slots it is missing, so publishing only copies those rather than the whole universe.
+
+#include "dmxframe.h"
+
+DMXFrameBuffer::DMXFrameBuffer() {
+    memset(working, 0, DMXArraySize);
+    memset(published, 0, DMXArraySize);
+    memset(frames, 0, sizeof(frames)); // Start code 0 in all of them, and a blacked out universe
+    for (auto& r : stale) {
+        r = {0xffff, 0};
+    }
+    changed = {0xffff, 0};
+    back = 0;
+    middle = 1;
+    front = 2;
+    dirty = no_range;
+    used = 0;
+    frame_version = 0;
+    memset(slot_versions, 0, sizeof(slot_versions));
+    lock = NULL;
+}
+
+void DMXFrameBuffer::begin() {
+    lock = xSemaphoreCreateMutex();
+}
+
+void DMXFrameBuffer::extend(range_t & r, range_t with) { // Grow r to also cover with
+    if (with.first < r.first) r.first = with.first;
+    if (with.last > r.last) r.last = with.last;
+}
+
+uint8_t * DMXFrameBuffer::beginWrite(TickType_t timeout) { // Claim the working copy. Returns NULL if another producer held on to it for longer than timeout (ticks)
+    if (xSemaphoreTake(lock, timeout) != pdTRUE) {
+        return NULL;
+    }
+    return working;
+}
+
+void DMXFrameBuffer::markDirty(int first, int count) { // Producer, between beginWrite() and endWrite(): slots first to first + count - 1 were written. The ones that hold a new value get published
+    if (count <= 0) {
+        return;
+    }
+    int last = min(first + count, DMXArraySize);
+    if (last > used.load(std::memory_order_relaxed)) { // Whoever sends these slots wants them in the frame, changed or not
+        used.store(last, std::memory_order_relaxed);
+    }
+    uint32_t v = frame_version.load(std::memory_order_relaxed) + 1; // The frame endWrite() is about to publish
+    range_t r = {0xffff, 0};
+    for (int i = first; i < last; i++) {
+        if (working[i] != published[i]) {
+            published[i] = working[i];
+            slot_versions[i] = v;
+            if (r.first == 0xffff) r.first = i;
+            r.last = i + 1;
+        }
+    }
+    if (r.last > r.first) {
+        extend(changed, r);
+    }
+}
+
+void DMXFrameBuffer::endWrite() { // Publish the working copy if any slot marked dirty changed, and let the next producer in
+    if (changed.last > changed.first) {
+        for (auto& r : stale) { // None of the frames have these changes yet
+            extend(r, changed);
+        }
+        range_t& r = stale[back];
+        memcpy(&frames[back][r.first + 1], &working[r.first], r.last - r.first); // frames[][0] is the start code
+        r = {0xffff, 0};
+        back = middle.exchange(back | fresh, std::memory_order_acq_rel) & 0x03; // Our frame goes in the middle, marked fresh. Whatever was there is ours to write next time
+        // Only now tell the reader about the changed slots. If it picks them up, the frame it swaps in afterwards is at least as new as ours
+        uint32_t d = dirty.load(std::memory_order_relaxed);
+        range_t pending;
+        do {
+            pending = {(uint16_t) (d & 0xffff), (uint16_t) (d >> 16)};
+            extend(pending, changed);
+        } while (!dirty.compare_exchange_weak(d, ((uint32_t) pending.last << 16) | pending.first, std::memory_order_release, std::memory_order_relaxed));
+        changed = {0xffff, 0};
+        frame_version.store(frame_version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+    xSemaphoreGive(lock);
+}
+
+const uint8_t * DMXFrameBuffer::acquire(int & first, int & last) { // Reader only. Swap in the newest published frame if there is one, and return the frame to send along with the slots (first to last - 1) changed since last time
+    uint32_t d = dirty.exchange(no_range, std::memory_order_acquire); // Take the changes before the frame, see endWrite()
+    first = d & 0xffff;
+    last = d >> 16;
+    if (middle.load(std::memory_order_relaxed) & fresh) {
+        front = middle.exchange(front, std::memory_order_acq_rel) & 0x03; // Hand back the frame we were using, unmarked
+    }
+    return frames[front];
+}
+
+const uint8_t * DMXFrameBuffer::current() { // The working copy, for displaying. Not locked, so it may be halfway through an update
+    return working;
+}
+
+int DMXFrameBuffer::slotsUsed() { // Highest slot any producer ever marked dirty, counting from 1. Frames need to be at least this long
+    return used.load(std::memory_order_relaxed);
+}
+
+uint32_t DMXFrameBuffer::version() { // Frames published since boot, any task. Only goes up when a slot changed value
+    return frame_version.load(std::memory_order_acquire);
+}
+
+uint32_t DMXFrameBuffer::slotVersion(int slot) { // Version of the frame that last changed slot, 0 if none did. Producers, between beginWrite() and endWrite()
+    return slot_versions[slot];
+}
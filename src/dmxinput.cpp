@@ -0,0 +1,167 @@
+//dmxinput.cpp
+// DMX input on a second UART, merged with the network frame before it goes out - so the bridge can sit inline behind a console.
+// Usage:
+//      - Create object with the DMX port to receive on (not the output port), call begin() with the RX pin once in setup()
+//      - Input task: call receive() in a loop. It waits up to timeout for a frame, and keeps the frame rate and error counts
+//      - live() says whether good frames are coming in. After DMX_INPUT_TIMEOUT ms without one the input counts as lost, and the network frame goes out on its own again
+//      - DMX task, every frame while live(): merge() the network frame with the latest input into the frame to send. Each channel is HTP (highest wins) or LTP (whichever side changed it last), set with setMerge()
+// The merge is a single pass over the slots in use, no branches beyond the LTP ownership checks. Its time is measured every frame, mergeTimeMax() is the worst case seen.
+
+#include "dmxinput.h"
+
+DMXInput::DMXInput(dmx_port_t port) {
+    this->port = port;
+    slot_count = 0;
+    last_frame = 0;
+    received = false;
+    fps = 0;
+    frame_total = 0;
+    error_total = 0;
+    fps_count = 0;
+    fps_start = 0;
+    for (auto& b : ltp_bits) {
+        b = 0; // All HTP, which is what a merge of two desks usually wants
+    }
+    memset(last_network, 0, sizeof(last_network));
+    memset(last_input, 0, sizeof(last_input));
+    memset(owner, 0, sizeof(owner));
+    merge_time = 0;
+    merge_time_max = 0;
+}
+
+void DMXInput::begin(int rx_pin) {
+    buffer.begin();
+    dmx_config_t config = DMX_CONFIG_DEFAULT;
+    dmx_driver_install(port, &config, NULL, 0);
+    dmx_set_pin(port, DMX_PIN_NO_CHANGE, rx_pin, DMX_PIN_NO_CHANGE); // Receive only, the transceiver on this pin is wired to always listen
+    fps_start = millis();
+}
+
+bool DMXInput::parseMerge(const char * name, size_t length, merge_t & mode) { // Merge mode from its name, returns false if unknown
+    if (length == 3 && strncasecmp(name, "htp", 3) == 0) {
+        mode = merge_t::htp;
+        return true;
+    }
+    if (length == 3 && strncasecmp(name, "ltp", 3) == 0) {
+        mode = merge_t::ltp;
+        return true;
+    }
+    return false;
+}
+
+bool DMXInput::receive(TickType_t timeout) { // Input task: wait for the next frame and hand it on. Returns true if a good DMX frame came in
+    unsigned long now = millis();
+    if (now - fps_start >= 1000) { // Frame rate, counted even when nothing comes in so it drops to 0
+        fps = fps_count;
+        fps_count = 0;
+        fps_start = now;
+    }
+    dmx_packet_t packet;
+    size_t size = dmx_receive(port, &packet, timeout);
+    if (size == 0) { // Nothing, the line is idle
+        return false;
+    }
+    if (packet.err != DMX_OK) { // Framing errors, short breaks and the like
+        error_total++;
+        return false;
+    }
+    if (packet.sc != DMX_SC || packet.is_rdm || packet.size < 2) { // Not dimmer data, not our business
+        return false;
+    }
+    uint8_t * frame = buffer.beginWrite(10); // Only the DMX task reads this buffer, we never have to wait long
+    if (frame == NULL) {
+        return false;
+    }
+    int n = min((int) packet.size - 1, DMXArraySize);
+    dmx_read_offset(port, 1, frame, n); // Skip the start code, frame slot 0 is DMX address 1
+    int old = slot_count;
+    if (old > n) { // Shorter frame than before, the slots it stopped sending are 0
+        memset(&frame[n], 0, old - n);
+    }
+    buffer.markDirty(0, max(n, old));
+    buffer.endWrite();
+    slot_count = n;
+    last_frame = millis();
+    received = true;
+    frame_total++;
+    fps_count++;
+    return true;
+}
+
+bool DMXInput::live() { // Safe from any task
+    return received && millis() - last_frame < DMX_INPUT_TIMEOUT;
+}
+
+int DMXInput::slots() {
+    return slot_count;
+}
+
+int DMXInput::framesPerSecond() {
+    return fps;
+}
+
+unsigned long DMXInput::frames() {
+    return frame_total;
+}
+
+unsigned long DMXInput::errors() {
+    return error_total;
+}
+
+const uint8_t * DMXInput::current() { // Last frame received, for displaying. Not locked, so it may be halfway through an update
+    return buffer.current();
+}
+
+void DMXInput::setMerge(int address, merge_t mode) { // Merge mode of address (0-511), safe from any task
+    if (address < 0 || address >= DMXArraySize) {
+        return;
+    }
+    if (mode == merge_t::ltp) {
+        ltp_bits[address >> 5].fetch_or(1UL << (address & 31), std::memory_order_relaxed);
+    } else {
+        ltp_bits[address >> 5].fetch_and(~(1UL << (address & 31)), std::memory_order_relaxed);
+    }
+}
+
+DMXInput::merge_t DMXInput::getMerge(int address) {
+    return (ltp_bits[address >> 5].load(std::memory_order_relaxed) & (1UL << (address & 31))) ? merge_t::ltp : merge_t::htp;
+}
+
+int DMXInput::merge(const uint8_t * network, int network_slots, uint8_t * out) { // DMX task: merge network (packet, start code at 0) with the latest input into out (same layout). Returns the number of slots in out
+    unsigned long start = micros();
+    int first, last;
+    const uint8_t * input = buffer.acquire(first, last); // Only ever the newest input frame, the changed range doesn't matter here
+    int n = max(network_slots, (int) slot_count);
+    out[0] = network[0];
+    for (int w = 0; w * 32 < n; w++) { // 32 slots per word of merge modes
+        uint32_t ltp = ltp_bits[w].load(std::memory_order_relaxed);
+        int end = min(w * 32 + 32, n);
+        for (int s = w * 32 + 1; s <= end; s++, ltp >>= 1) {
+            uint8_t a = network[s];
+            uint8_t b = input[s];
+            if (a != last_network[s]) owner[s] = 0; // Whoever moved the channel last owns it. If both did, the input wins
+            if (b != last_input[s]) owner[s] = 1;
+            last_network[s] = a;
+            last_input[s] = b;
+            out[s] = (ltp & 1) ? (owner[s] ? b : a) : (a > b ? a : b);
+        }
+    }
+    unsigned long t = micros() - start;
+    merge_time = t;
+    if (t > merge_time_max) {
+        merge_time_max = t;
+    }
+    return n;
+}
+
+unsigned long DMXInput::mergeTime() { // us the last merge took
+    return merge_time;
+}
+
+unsigned long DMXInput::mergeTimeMax() { // Worst case us a merge took
+    return merge_time_max;
+}
+
+void DMXInput::resetMergeTime() {
+    merge_time_max = 0;
+}
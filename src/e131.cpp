@@ -0,0 +1,180 @@
+//e131.cpp
+// Usage:
+//      - Create object with the sACN universe to listen to (1-63999), call begin() once WiFi is up to join its multicast group. Unicast to the same port works as well
+//      - Call receive() regularly, it handles one packet per call and returns true if the merged output may have changed
+//      - Call expire() now and then to drop sources that have gone quiet (also returns true if that changed anything)
+//      - When either said so, run merge() into the destination frame. Highest priority wins, equal priorities are merged HTP
+//      - merge() returns how many slots the longest merged source sends. When the last source is gone it returns 0 and leaves the destination alone, so the last look holds (and HTTP set values aren't blacked out)
+// Each source keeps its own copy of the universe, so merge() always runs over E131_MAX_SOURCES * 512 slots at most, no matter how much traffic arrives.
+// Per-address priority (start code 0xDD) and universe synchronization are not supported, such packets are ignored.
+
+#include "e131.h"
+
+static const uint8_t acn_id[12] = {'A', 'S', 'C', '-', 'E', '1', '.', '1', '7', '\0', '\0', '\0'};
+
+E131Receiver::E131Receiver() : E131Receiver(1) {} // Universe 1 is the first valid sACN universe
+
+E131Receiver::E131Receiver(uint16_t universe) {
+    universe_number = universe;
+    running = false;
+    for (auto& s : source_list) {
+        s.active = false;
+    }
+}
+
+void E131Receiver::begin() {
+    udp.beginMulticast(IPAddress(239, 255, universe_number >> 8, universe_number & 0xff), E131_PORT); // Binds the port for unicast as well
+    running = true;
+}
+
+void E131Receiver::setUniverse(uint16_t universe) { // Switch universe, forgetting all sources of the old one
+    universe_number = universe;
+    for (auto& s : source_list) {
+        s.active = false;
+    }
+    if (running) { // Leave the old multicast group and join the new one
+        udp.stop();
+        begin();
+    }
+}
+
+uint16_t E131Receiver::universe() {
+    return universe_number;
+}
+
+int E131Receiver::sources() { // Number of sources currently being merged
+    int n = 0;
+    for (auto& s : source_list) {
+        if (s.active) n++;
+    }
+    return n;
+}
+
+bool E131Receiver::decodeHeader(const uint8_t * packet, size_t size, header_t & header) { // Check the layers of an incoming packet and pick out the interesting fields. Returns false for anything that isn't E1.31 DMX data
+    if (size < E131_HEADER_SIZE) {
+        return false;
+    }
+    if (packet[0] != 0x00 || packet[1] != 0x10 || memcmp(&packet[4], acn_id, sizeof(acn_id)) != 0) { // Preamble size and ACN packet identifier
+        return false;
+    }
+    if (packet[18] != 0 || packet[19] != 0 || packet[20] != 0 || packet[21] != 0x04) { // Root vector: VECTOR_ROOT_E131_DATA
+        return false;
+    }
+    if (packet[40] != 0 || packet[41] != 0 || packet[42] != 0 || packet[43] != 0x02) { // Framing vector: VECTOR_E131_DATA_PACKET
+        return false;
+    }
+    if (packet[117] != 0x02 || packet[118] != 0xa1) { // DMP vector: VECTOR_DMP_SET_PROPERTY, address and data type
+        return false;
+    }
+    header.cid = &packet[22];
+    header.priority = packet[108];
+    header.sequence = packet[111];
+    header.options = packet[112];
+    header.universe = (packet[113] << 8) | packet[114];
+    uint16_t count = (packet[123] << 8) | packet[124]; // Property value count includes the start code
+    header.startcode = packet[125];
+    header.length = count > 0 ? min(count - 1, 512) : 0;
+    if (header.priority > 200) { // Out of range priorities are clamped to the maximum
+        header.priority = 200;
+    }
+    return true;
+}
+
+int E131Receiver::findSource(const uint8_t * cid) { // Index of the source with this CID, or -1
+    for (int i = 0; i < E131_MAX_SOURCES; i++) {
+        if (source_list[i].active && memcmp(source_list[i].cid, cid, 16) == 0)
+            return i;
+    }
+    return -1;
+}
+
+bool E131Receiver::receive() { // Handle one packet, if any. Returns true if the merged output may have changed
+    int size = udp.parsePacket();
+    if (size <= 0) {
+        return false;
+    }
+    uint8_t packet[E131_HEADER_SIZE];
+    int n = udp.read(packet, E131_HEADER_SIZE); // Only the header, the data is read straight into the source below
+    header_t header;
+    if (n <= 0 || !decodeHeader(packet, n, header)) {
+        return false;
+    }
+    if (header.universe != universe_number || (header.options & 0x80)) { // Someone else's universe, or preview data meant for visualisers
+        return false;
+    }
+    int i = findSource(header.cid);
+    if (header.options & 0x40) { // Stream terminated, the source is gone right away
+        if (i >= 0) {
+            source_list[i].active = false;
+            return true;
+        }
+        return false;
+    }
+    if (header.startcode != 0x00) { // Not plain DMX data
+        return false;
+    }
+    if (i >= 0) {
+        // Known source, drop packets arriving out of order (E1.31 section 6.7.2)
+        int8_t diff = (int8_t) (header.sequence - source_list[i].sequence);
+        if (diff <= 0 && diff > -20) {
+            return false;
+        }
+    } else {
+        for (i = 0; i < E131_MAX_SOURCES; i++) { // New source, find it a free spot
+            if (!source_list[i].active)
+                break;
+        }
+        if (i == E131_MAX_SOURCES) { // Full, this one is ignored until someone else times out
+            return false;
+        }
+        memcpy(source_list[i].cid, header.cid, 16);
+        source_list[i].active = true;
+    }
+    source_t& s = source_list[i];
+    s.priority = header.priority;
+    s.sequence = header.sequence;
+    s.last_seen = millis();
+    int length = min((int) header.length, size - E131_HEADER_SIZE);
+    int r = length > 0 ? udp.read(s.data, length) : 0;
+    if (r < 0) r = 0;
+    memset(&s.data[r], 0, 512 - r); // Slots not sent are zero
+    s.length = r;
+    return true;
+}
+
+bool E131Receiver::expire() { // Drop sources we haven't heard from in a while. Returns true if any were dropped
+    bool changed = false;
+    unsigned long now = millis();
+    for (auto& s : source_list) {
+        if (s.active && now - s.last_seen > E131_SOURCE_TIMEOUT) {
+            s.active = false;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+int E131Receiver::merge(uint8_t * dest) { // Merge all active sources of the highest priority into dest (512 slots), highest value takes precedence. Returns the number of slots of the longest source merged, 0 (dest untouched) if there are no sources
+    int top = -1;
+    for (auto& s : source_list) {
+        if (s.active && s.priority > top)
+            top = s.priority;
+    }
+    bool first = true;
+    int length = 0;
+    for (auto& s : source_list) {
+        if (!s.active || s.priority != top)
+            continue;
+        length = max(length, (int) s.length);
+        if (first) { // The first one is simply copied, saves a pass over the output
+            memcpy(dest, s.data, 512);
+            first = false;
+        } else {
+            for (int i = 0; i < 512; i++) {
+                if (s.data[i] > dest[i])
+                    dest[i] = s.data[i];
+            }
+        }
+    }
+    return length;
+}
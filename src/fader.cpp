@@ -0,0 +1,169 @@
+//fader.cpp
+// Timed per-channel fades, computed in the DMX task right before each frame goes out.
+// Usage:
+//      - Call begin() once in setup()
+//      - Any task: fade() queues a fade of one channel to a target value over a number of ms. Write the target into the frame buffer as well (and publish it after queueing the fade), so the channel stays there once the fade is over
+//      - Any task: cancel() stops a fade, e.g. when the channel is set directly. fading() tells cheaply whether that is needed.
+//        Cancel after publishing the new value, the channel goes back to whatever frame the DMX task holds when it gets the cancel
+//      - Any task: crossfade() fades the whole universe from what is going out now to the next frame published (queue it first, like fade()), e.g. for a scene recall.
+//        It replaces all running fades. A crossfade of 0 ms just stops every fade, for a snap to a new frame
+//      - DMX task, every frame: update() after acquiring the new frame but before writing it to the output frame - new fades start from what is going out now.
+//        Then apply() after the frame is written, which overwrites each fading channel with its current value
+// Only active fades are looked at, so channels that aren't fading cost nothing. A crossfade costs one pass over the universe per frame while it runs. All maths is 16 bit fixed point, no floats or divisions per frame.
+
+#include "fader.h"
+
+FadeEngine::FadeEngine() {
+    queue = NULL;
+    count = 0;
+    xfading = false;
+    for (auto& i : index) {
+        i = -1;
+    }
+    for (auto& b : fading_bits) {
+        b = 0;
+    }
+}
+
+void FadeEngine::begin() {
+    queue = xQueueCreate(FADE_QUEUE_SIZE, sizeof(command_t));
+}
+
+bool FadeEngine::parseCurve(const char * name, size_t length, curve_t & curve) { // Curve from its name, returns false if unknown
+    static const char * const names[] = {"linear", "in", "out", "smooth"};
+    for (int i = 0; i < 4; i++) {
+        if (strlen(names[i]) == length && strncasecmp(name, names[i], length) == 0) {
+            curve = (curve_t) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FadeEngine::fade(int address, uint8_t target, unsigned long duration, curve_t curve) { // Queue a fade of address (0-511) to target over duration ms. Waits a few ticks at most if the DMX task is behind, returns false if it couldn't be queued
+    if (address < 0 || address >= DMXArraySize || duration == 0) {
+        return false;
+    }
+    command_t c = {(uint16_t) address, target, curve, (uint32_t) duration};
+    fading_bits[address >> 5].fetch_or(1UL << (address & 31), std::memory_order_relaxed); // Right away rather than when the DMX task starts it, so a set right behind the fade knows to cancel it
+    return xQueueSend(queue, &c, 10) == pdTRUE; // If it wasn't queued the bit stays on, the cancel that snaps the channel instead clears it
+}
+
+void FadeEngine::cancel(int address) { // Stop fading address, it goes straight to whatever the frame holds
+    command_t c = {(uint16_t) address, 0, curve_t::linear, 0};
+    xQueueSend(queue, &c, 10);
+}
+
+bool FadeEngine::fading(int address) { // Is address fading (or about to start or stop)? Safe from any task
+    return fading_bits[address >> 5].load(std::memory_order_relaxed) & (1UL << (address & 31));
+}
+
+bool FadeEngine::crossfade(unsigned long duration, curve_t curve) { // Queue a crossfade of everything to the next frame over duration ms, 0 to stop all fades. Returns false if it couldn't be queued
+    command_t c = {FADE_ALL, 0, curve, (uint32_t) duration};
+    return xQueueSend(queue, &c, 10) == pdTRUE;
+}
+
+bool FadeEngine::crossfading() {
+    return xfading;
+}
+
+int FadeEngine::active() { // Number of channels fading
+    return count;
+}
+
+void FadeEngine::remove(int i) { // Drop fades[i], moving the last one into its place to keep the list packed
+    uint16_t address = fades[i].address;
+    index[address] = -1;
+    fading_bits[address >> 5].fetch_and(~(1UL << (address & 31)), std::memory_order_relaxed);
+    count--;
+    if (i != count) {
+        fades[i] = fades[count];
+        index[fades[i].address] = i;
+    }
+}
+
+void FadeEngine::update(const uint8_t * output) { // DMX task: start and cancel whatever was queued. output is the frame going out now (start code at 0), before any response curves
+    command_t c;
+    while (xQueueReceive(queue, &c, 0) == pdTRUE) {
+        if (c.address == FADE_ALL) { // Everything goes from what is going out now (fades included) to the new frame
+            memcpy(xfade_from, output, DMX_PACKET_SIZE);
+            while (count > 0) {
+                remove(count - 1);
+            }
+            xfade.curve = c.curve;
+            xfade.start_time = millis();
+            xfade.duration = c.duration;
+            xfade.rate = c.duration > 1 ? 0xffffffffUL / c.duration : 0xffffffffUL;
+            xfading = true; // Even for 0 ms: apply() then hands the whole frame back at once, faded channels included
+            continue;
+        }
+        int i = index[c.address];
+        if (c.duration == 0) {
+            if (i >= 0) {
+                fades[i].duration = 0; // apply() hands the channel back to the frame and drops it. The frame may not change, if it was set to what it already held
+            } else { // Never started, e.g. the fade couldn't be queued
+                fading_bits[c.address >> 5].fetch_and(~(1UL << (c.address & 31)), std::memory_order_relaxed);
+            }
+            continue;
+        }
+        if (i < 0) { // New fade, take the next free spot
+            i = count++;
+            index[c.address] = i;
+            fading_bits[c.address >> 5].fetch_or(1UL << (c.address & 31), std::memory_order_relaxed); // Set by fade() already, unless a cancel of an earlier fade cleared it meanwhile
+        }
+        fade_t& f = fades[i];
+        f.address = c.address;
+        f.start = output[c.address + 1]; // Whatever is going out now, so a fade interrupting another carries on smoothly from where it was
+        f.target = c.target;
+        f.curve = c.curve;
+        f.start_time = millis();
+        f.duration = c.duration;
+        f.rate = c.duration > 1 ? 0xffffffffUL / c.duration : 0xffffffffUL;
+    }
+}
+
+uint32_t FadeEngine::shape(curve_t curve, uint32_t p) { // Apply the curve to progress p (0-65535 = 0-1)
+    switch (curve) {
+        case curve_t::in: // Slow start
+            return (p * p) >> 16;
+        case curve_t::out: { // Slow end
+            uint32_t q = 65536 - p;
+            return 65536 - (((uint64_t) q * q) >> 16);
+        }
+        case curve_t::smooth: { // Slow start and end (smoothstep, 3p^2 - 2p^3)
+            uint32_t q = (p * p) >> 16;
+            return ((uint64_t) q * (3 * 65536 - 2 * p)) >> 16;
+        }
+        default:
+            return p;
+    }
+}
+
+void FadeEngine::apply(uint8_t * output, const uint8_t * frame, unsigned long now) { // DMX task: write the current value of every fading channel into output. frame is the packet just written there (both start code at 0)
+    if (xfading) {
+        uint32_t elapsed = now - xfade.start_time;
+        if (elapsed >= xfade.duration) { // Done, the frame has it all back
+            memcpy(&output[1], &frame[1], DMXArraySize);
+            xfading = false;
+        } else {
+            int32_t c = shape(xfade.curve, ((uint64_t) elapsed * xfade.rate) >> 16);
+            for (int s = 1; s <= DMXArraySize; s++) {
+                output[s] = xfade_from[s] + ((((int) frame[s] - xfade_from[s]) * c) >> 16);
+            }
+        }
+    }
+    int i = 0;
+    while (i < count) {
+        fade_t& f = fades[i];
+        uint32_t elapsed = now - f.start_time;
+        if (elapsed >= f.duration) { // Done. Let the frame have the channel back - it holds the target, unless someone changed it since
+            output[f.address + 1] = frame[f.address + 1];
+            remove(i); // Moves another fade into i, so don't step forward
+            continue;
+        }
+        uint32_t p = ((uint64_t) elapsed * f.rate) >> 16; // 0-65535
+        int diff = (int) f.target - f.start;
+        output[f.address + 1] = f.start + ((diff * (int32_t) shape(f.curve, p)) >> 16);
+        i++;
+    }
+}
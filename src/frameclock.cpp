@@ -0,0 +1,182 @@
+//frameclock.cpp
+// Frame timing for the DMX task: a periodic esp_timer wakes it once per frame, so the frame rate is steady and doesn't drift with WiFi load or the tick.
+// Usage:
+//      - Call begin() once with the DMX task's handle and the frame rate to use until setRate() stores another, before the task starts waiting on it
+//      - DMX task, every frame: fit() with how long the frame takes on the wire, then wait() blocks until it is due and returns the time since the last one.
+//        jitter() is how far that was off the frame period
+//      - Any task: setRate() changes the frame rate and keeps it in NVS (flash) for the next boot. 1 to FRAME_RATE_MAX is a fixed rate.
+//        FRAME_RATE_AUTO (the default) sets the period from the frame length, so frames only as long as the slots in use refresh as fast as they can.
+//        FRAME_RATE_FREE drops the timer: a frame as soon as the last one is out, paced by the tick like the DMX task did before
+//      - measure() collects the intervals of the next frames, printMeasurement() reports their jitter percentiles as JSON once they're in. Put the bridge under load meanwhile to see what that does to the output
+// A tick that comes while the last frame is still being sent is counted in overruns() and dropped - the frame goes out at the next tick instead of late.
+
+#include "frameclock.h"
+#include <algorithm>
+
+FrameClock::FrameClock() {
+    timer = NULL;
+    task = NULL;
+    frame_rate = FRAME_RATE_AUTO;
+    frame_period = 0;
+    frame_time = 0;
+    last_start = 0;
+    last_interval = 0;
+    last_jitter = 0;
+    missed = 0;
+    sample_count = 0;
+    sample_target = 0;
+    sample_request = 0;
+    measure_rate = 0;
+    measure_missed = 0;
+}
+
+void FrameClock::begin(TaskHandle_t task, int fps) {
+    this->task = task;
+    esp_timer_create_args_t args = {};
+    args.callback = tick;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "DMX frame";
+    args.skip_unhandled_events = true; // If the timer task was held up, one tick is enough to catch up
+    esp_timer_create(&args, &timer);
+    last_start = esp_timer_get_time();
+    prefs.begin("clock", false);
+    int stored = prefs.getShort("rate", fps);
+    frame_rate = stored >= FRAME_RATE_FREE && stored <= FRAME_RATE_MAX ? stored : fps; // Whatever is stored could be out of range for this firmware
+}
+
+void FrameClock::tick(void * arg) { // esp_timer task: the next frame is due
+    FrameClock * clock = (FrameClock *) arg;
+    xTaskNotifyGive(clock->task);
+}
+
+bool FrameClock::setRate(int fps) { // Change the frame rate, for good: frames/s, FRAME_RATE_AUTO or FRAME_RATE_FREE. The DMX task picks it up at its next frame. Returns false if it's out of range
+    if (fps < FRAME_RATE_FREE || fps > FRAME_RATE_MAX) {
+        return false;
+    }
+    frame_rate = fps;
+    if (prefs.getShort("rate", FRAME_RATE_FREE - 1) != fps) { // Only when it changed, every write wears the flash
+        prefs.putShort("rate", fps);
+    }
+    return true;
+}
+
+int FrameClock::rate() { // The setting, see setRate()
+    return frame_rate;
+}
+
+uint32_t FrameClock::period() { // us between frames the timer keeps to right now, 0 when running free
+    return frame_period;
+}
+
+int FrameClock::pacedRate() { // Frames/s the timer keeps to right now, 0 when running free
+    uint32_t p = frame_period;
+    return p > 0 ? 1000000 / p : 0;
+}
+
+void FrameClock::fit(uint32_t frame_us) { // DMX task, before wait(): how long the frame about to go out takes. In auto mode the period follows it, so short frames go out more often
+    frame_time = frame_us;
+}
+
+uint32_t FrameClock::periodFor(int fps) {
+    if (fps > 0) {
+        return 1000000 / fps;
+    }
+    if (fps == FRAME_RATE_AUTO) {
+        return max(frame_time + FRAME_CLOCK_MARGIN, (uint32_t) (1000000 / FRAME_RATE_MAX));
+    }
+    return 0;
+}
+
+uint32_t FrameClock::wait() { // DMX task only
+    uint32_t period = periodFor(frame_rate);
+    if (period != frame_period) { // New setting, or the frames changed length. Only ever done here, so nobody else fights over the timer
+        esp_timer_stop(timer); // Not running is fine
+        frame_period = period;
+        if (period > 0) {
+            esp_timer_start_periodic(timer, period);
+        }
+        ulTaskNotifyTake(pdTRUE, 0); // A tick of the old period mustn't count as the first of the new one
+    }
+    if (period > 0) {
+        uint32_t ticks = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(1000)); // Never forever, whatever happens to the timer
+        if (ticks > 1) {
+            missed += ticks - 1;
+        }
+    } else {
+        vTaskDelay(1); // Running free, give the rest of the core a go
+    }
+    int64_t now = esp_timer_get_time();
+    uint32_t interval = now - last_start;
+    uint32_t expected = period > 0 ? period : last_interval; // Running free there's no period to keep, so measure against the interval before
+    uint32_t deviation = expected > 0 ? (interval > expected ? interval - expected : expected - interval) : 0;
+    last_jitter = deviation;
+    last_start = now;
+    last_interval = interval;
+
+    int request = sample_request.exchange(0);
+    if (request > 0) { // Start a measurement. Only this task touches the samples while it's running
+        measure_rate = period > 0 ? 1000000 / period : 0;
+        measure_missed = missed;
+        sample_count.store(0, std::memory_order_relaxed);
+        sample_target.store(request, std::memory_order_relaxed);
+    }
+    int n = sample_count.load(std::memory_order_relaxed);
+    if (n < sample_target.load(std::memory_order_relaxed)) {
+        samples[n] = min(deviation, (uint32_t) 0xffff);
+        sample_count.store(n + 1, std::memory_order_release);
+    }
+    return interval;
+}
+
+uint32_t FrameClock::jitter() { // Of the last frame, in us
+    return last_jitter;
+}
+
+uint32_t FrameClock::overruns() { // Ticks dropped since boot, because the frame before was still going
+    return missed;
+}
+
+void FrameClock::measure(int frames) { // The DMX task starts collecting at its next frame
+    sample_request = max(1, min(frames, FRAME_CLOCK_SAMPLES));
+}
+
+bool FrameClock::measuring() {
+    return sample_request > 0 || sample_count.load(std::memory_order_acquire) < sample_target.load(std::memory_order_relaxed);
+}
+
+void FrameClock::printMeasurement(Print & out) { // {"rate":...,"frames":...,"target":...,"done":...} and, once done, "overruns", "mean_us", "p50_us", "p90_us", "p99_us", "p999_us", "max_us"
+    int request = sample_request; // Asked for, but not started yet
+    bool done = !measuring();
+    int n = request > 0 ? 0 : sample_count.load(std::memory_order_acquire);
+    out.print("{\"rate\":");
+    out.print(done ? measure_rate : (uint32_t) pacedRate());
+    out.print(",\"frames\":");
+    out.print(n);
+    out.print(",\"target\":");
+    out.print(request > 0 ? request : sample_target.load(std::memory_order_relaxed));
+    out.print(",\"done\":");
+    out.print(done && n > 0 ? "true" : "false");
+    if (done && n > 0) { // The DMX task leaves the samples alone until the next measure(), so they can be sorted in place
+        std::sort(samples, samples + n);
+        uint64_t sum = 0;
+        for (int i = 0; i < n; i++) {
+            sum += samples[i];
+        }
+        out.print(",\"overruns\":");
+        out.print(missed - measure_missed);
+        out.print(",\"mean_us\":");
+        out.print((double) sum / n, 2);
+        const struct {
+            const char * name;
+            int permille;
+        } percentiles[] = {{"p50_us", 500}, {"p90_us", 900}, {"p99_us", 990}, {"p999_us", 999}, {"max_us", 1000}};
+        for (auto& p : percentiles) {
+            out.print(",\"");
+            out.print(p.name);
+            out.print("\":");
+            out.print(samples[max((n * p.permille + 999) / 1000 - 1, 0)]); // Nearest rank
+        }
+    }
+    out.print("}\n");
+}
@@ -0,0 +1,228 @@
+//httpparser.cpp
+// Usage:
+//      - Create one parser per connection (it holds a fixed buffer, so don't put it on a small task stack), reset() before each request
+//      - Read from the client in chunks and feed() them in. feed() returns how many bytes it used, it stops right at the end of the request (the blank line ending the headers, or the end of the body)
+//      - Once done() the request line and headers are available as StrViews pointing into the parser's buffer. failed() means the request was garbage or its request line too long
+//      - A body (Content-Length, up to HTTP_MAX_BODY bytes) is collected before the request is done(), body() returns it. Bigger ones fail with tooLarge(), chunked request bodies aren't supported
+// Nothing here allocates. Headers that don't fit (too many, or too long for what's left of the buffer) are dropped rather than failing the whole request.
+
+#include "httpparser.h"
+
+bool StrView::empty() const {
+    return length == 0;
+}
+
+bool StrView::equals(const char * s) const {
+    return strlen(s) == length && memcmp(data, s, length) == 0;
+}
+
+bool StrView::equalsIgnoreCase(const char * s) const {
+    return strlen(s) == length && strncasecmp(data, s, length) == 0;
+}
+
+const char * StrView::find(const char * s) const { // Where s first shows up in the view, NULL if it doesn't (case sensitive)
+    size_t n = strlen(s);
+    for (size_t i = 0; i + n <= length; i++) {
+        if (memcmp(&data[i], s, n) == 0)
+            return &data[i];
+    }
+    return NULL;
+}
+
+bool StrView::toInt(int & value) const { // Strict conversion: only plain digits, nothing else, at least one of them. Returns false if it isn't a clean integer
+    if (length == 0 || length > 9) { // 9 digits always fits in an int
+        return false;
+    }
+    int v = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (!isDigit(data[i]))
+            return false;
+        v = v * 10 + (data[i] - '0');
+    }
+    value = v;
+    return true;
+}
+
+StrView StrView::token(char delimiter) { // Split off everything up to the delimiter and return it. This view moves past the delimiter, or becomes empty if there was none
+    const char * d = (const char *) memchr(data, delimiter, length);
+    StrView t = {data, d ? (size_t) (d - data) : length};
+    if (d) {
+        length -= t.length + 1;
+        data = d + 1;
+    } else {
+        data += length;
+        length = 0;
+    }
+    return t;
+}
+
+bool StrView::nextPair(StrView & name, StrView & value) { // Pop the next name=value pair off a query string. Returns false when there are no more
+    if (length == 0) {
+        return false;
+    }
+    value = token('&');
+    name = value.token('=');
+    return true;
+}
+
+HttpRequestParser::HttpRequestParser() {
+    reset();
+}
+
+void HttpRequestParser::reset() { // Forget everything, ready for a new request
+    used = 0;
+    line_start = 0;
+    state = state_t::requestline;
+    method_view = path_view = query_view = version_view = {buffer, 0};
+    header_count = 0;
+    body_length = 0;
+    body_expected = 0;
+}
+
+bool HttpRequestParser::done() {
+    return state == state_t::done;
+}
+
+bool HttpRequestParser::failed() {
+    return state == state_t::error || state == state_t::toolarge;
+}
+
+bool HttpRequestParser::tooLarge() { // Failed because the body doesn't fit
+    return state == state_t::toolarge;
+}
+
+bool HttpRequestParser::idle() { // Nothing of a request received yet
+    return state == state_t::requestline && used == 0;
+}
+
+StrView HttpRequestParser::method() {
+    return method_view;
+}
+
+StrView HttpRequestParser::path() {
+    return path_view;
+}
+
+StrView HttpRequestParser::query() {
+    return query_view;
+}
+
+StrView HttpRequestParser::version() {
+    return version_view;
+}
+
+StrView HttpRequestParser::requestLine() { // The request line is always the first thing in the buffer
+    return {buffer, state == state_t::requestline ? 0 : (size_t) (version_view.data + version_view.length - buffer)};
+}
+
+StrView HttpRequestParser::header(const char * name) { // Value of the named header (case insensitive), empty if it wasn't sent or was dropped
+    for (int i = 0; i < header_count; i++) {
+        if (headers[i].name.equalsIgnoreCase(name))
+            return headers[i].value;
+    }
+    return {buffer, 0};
+}
+
+StrView HttpRequestParser::body() { // Request body, empty if there was none
+    return {body_buffer, body_length};
+}
+
+HttpRequestParser::state_t HttpRequestParser::startBody() { // Headers are complete, see whether a body follows
+    if (!header("Transfer-Encoding").empty()) {
+        return state_t::error;
+    }
+    StrView length = header("Content-Length");
+    int n;
+    if (length.empty()) {
+        return state_t::done;
+    }
+    if (!length.toInt(n)) {
+        return state_t::error;
+    }
+    if (n > HTTP_MAX_BODY) {
+        return state_t::toolarge;
+    }
+    body_expected = n;
+    return n > 0 ? state_t::body : state_t::done;
+}
+
+size_t HttpRequestParser::feed(const char * data, size_t length) { // Run received bytes through the state machine. Returns the number of bytes used, anything after the end of the request is left for the caller
+    size_t i = 0;
+    while (i < length && state != state_t::done && state != state_t::error) {
+        if (state == state_t::body) { // Straight copy, no lines in here
+            size_t n = min(length - i, body_expected - body_length);
+            memcpy(&body_buffer[body_length], &data[i], n);
+            body_length += n;
+            i += n;
+            if (body_length == body_expected) {
+                state = state_t::done;
+            }
+            continue;
+        }
+        char c = data[i++];
+        if (c == '\r') { // Lines end in \r\n, but be nice to clients only sending \n
+            continue;
+        }
+        if (c == '\n') { // A full line, see what it was
+            StrView line = {&buffer[line_start], used - line_start};
+            if (state == state_t::requestline) {
+                if (line.empty()) { // Stray empty lines before the request line are allowed
+                    continue;
+                }
+                state = parseRequestLine(line) ? state_t::headers : state_t::error;
+            } else if (state == state_t::skipline) { // End of a header we had to drop
+                state = state_t::headers;
+            } else if (line.empty()) { // Blank line, end of the headers. A body may follow
+                state = startBody();
+            } else {
+                parseHeaderLine(line);
+            }
+            line_start = used;
+            continue;
+        }
+        if (state == state_t::skipline) {
+            continue;
+        }
+        if (used == HTTP_REQUEST_BUFFER_SIZE) { // Out of space
+            if (state == state_t::requestline) { // Can't do anything without the request line
+                state = state_t::error;
+            } else { // Drop this header, throw away what we have of it
+                state = state_t::skipline;
+                used = line_start;
+            }
+            continue;
+        }
+        buffer[used++] = c;
+    }
+    return i;
+}
+
+bool HttpRequestParser::parseRequestLine(StrView line) { // METHOD SP target SP version, target being path?query
+    method_view = line.token(' ');
+    StrView target = line.token(' ');
+    version_view = line;
+    if (method_view.empty() || target.empty() || version_view.empty()) {
+        return false;
+    }
+    path_view = target.token('?');
+    query_view = target;
+    return true;
+}
+
+void HttpRequestParser::parseHeaderLine(StrView line) { // name: value. Keep it if there's room, otherwise give its space back
+    StrView name = line.token(':');
+    while (line.length > 0 && (line.data[0] == ' ' || line.data[0] == '\t')) { // Leading whitespace isn't part of the value
+        line.data++;
+        line.length--;
+    }
+    while (line.length > 0 && (line.data[line.length - 1] == ' ' || line.data[line.length - 1] == '\t')) { // Trailing isn't either
+        line.length--;
+    }
+    if (header_count < HTTP_MAX_HEADERS && !name.empty()) {
+        headers[header_count].name = name;
+        headers[header_count].value = line;
+        header_count++;
+    } else {
+        used = line_start;
+    }
+}
@@ -0,0 +1,229 @@
+//httpserver.cpp
+// Usage:
+//      - Create object with the port and a handler function that sends the response for a parsed request, call begin() once WiFi is up
+//      - Call poll() regularly from one task. Each call accepts new clients and reads whatever each connection has waiting, it never waits for a client
+//      - HTTP/1.1 connections stay open for the next request (unless the client asks otherwise) until they have been idle for HTTP_IDLE_TIMEOUT
+// Up to HTTP_MAX_CONNECTIONS clients are served side by side, so one slow browser no longer holds up everyone else.
+// When all slots are taken the one idle the longest between requests is dropped for the newcomer, and if none are idle the newcomer gets a 503.
+//      - onWebSocket() lets GET requests for one path upgrade to a WebSocket. Such a connection keeps its slot until it closes, binary messages go to the handler
+//      - parseTime() and responseTime() measure every request, for the metrics page
+//      - webSocketSend() queues a binary message for a WebSocket slot without waiting. Check webSocketWritable() first to skip clients that haven't taken the last one yet
+// Responses are written from this task too, so every write is bounded by HTTP_WRITE_TIMEOUT. A phone that stops taking data costs the others that long once, then it is closed.
+
+#include "httpserver.h"
+
+HttpServer::HttpServer(uint16_t port, handler_t handler) : server(port), handler(handler) {
+    for (auto& c : slots) {
+        c.active = false;
+        c.websocket = false;
+    }
+    ws_path = NULL;
+    ws_handler = NULL;
+    request_count = 0;
+}
+
+void HttpServer::onWebSocket(const char * path, ws_handler_t handler) {
+    ws_path = path;
+    ws_handler = handler;
+}
+
+bool HttpServer::webSocketWritable(int slot) { // Slot is an open WebSocket that has sent everything queued so far
+    connection_t& c = slots[slot];
+    return c.active && c.websocket && c.ws.writable();
+}
+
+bool HttpServer::webSocketSend(int slot, const uint8_t * data, size_t length) { // Queue a binary message. Returns false if it isn't a WebSocket or there's no room
+    connection_t& c = slots[slot];
+    if (!c.active || !c.websocket) {
+        return false;
+    }
+    return c.ws.send(WebSocket::opcode_t::binary, data, length);
+}
+
+void HttpServer::begin() {
+    server.begin();
+    server.setNoDelay(true); // Responses are sent in chunks already, no point in Nagle holding them back
+}
+
+int HttpServer::connections() { // Connections currently open
+    int n = 0;
+    for (auto& c : slots) {
+        if (c.active) n++;
+    }
+    return n;
+}
+
+unsigned long HttpServer::requests() { // Requests handled since boot
+    return request_count;
+}
+
+MetricTiming & HttpServer::parseTime() {
+    return parse_metric;
+}
+
+MetricTiming & HttpServer::responseTime() {
+    return response_metric;
+}
+
+void HttpServer::poll() { // One pass over the listening socket and all connections
+    accept();
+    for (auto& c : slots) {
+        if (c.active) {
+            service(c);
+        }
+    }
+}
+
+void HttpServer::accept() { // Give a waiting client a slot
+    if (!server.hasClient()) {
+        return;
+    }
+    connection_t * slot = NULL;
+    for (auto& c : slots) {
+        if (!c.active) {
+            slot = &c;
+            break;
+        }
+    }
+    if (slot == NULL) { // All taken. Kick out whoever has been waiting the longest for their next request
+        for (auto& c : slots) {
+            if (!c.websocket && c.request.idle() && (slot == NULL || c.last_active < slot->last_active))
+                slot = &c;
+        }
+        if (slot != NULL) {
+            close(*slot);
+        }
+    }
+    WiFiClient client = server.available();
+    client.setTimeout(HTTP_WRITE_TIMEOUT); // ms. Applies to every write to this client, the default would let one stalled client hold poll() up for seconds
+    if (slot == NULL) { // Everyone is busy with a request, come back later
+        client.println("HTTP/1.1 503 Service Unavailable");
+        client.println("Connection: close");
+        client.println();
+        client.stop();
+        return;
+    }
+    slot->client = client;
+    slot->client.setNoDelay(true);
+    slot->request.reset();
+    slot->websocket = false;
+    slot->last_active = millis();
+    slot->parse_time = 0;
+    slot->active = true;
+}
+
+void HttpServer::service(connection_t & c) { // Read what the client has sent so far, and answer if the request is complete
+    if (!c.client.connected()) {
+        close(c);
+        return;
+    }
+    if (c.websocket) {
+        serviceWebSocket(c);
+        return;
+    }
+    int n = c.client.available();
+    if (n <= 0) {
+        if (millis() - c.last_active > HTTP_IDLE_TIMEOUT) {
+            close(c);
+        }
+        return;
+    }
+    char buf[HTTP_READ_CHUNK];
+    n = c.client.read((uint8_t *) buf, min(n, HTTP_READ_CHUNK)); // Only what is already there, so this doesn't wait
+    if (n <= 0) {
+        return;
+    }
+    c.last_active = millis();
+    int offset = 0;
+    while (offset < n) { // There may be more than one request in the chunk if the client pipelines them
+        unsigned long start = micros();
+        offset += c.request.feed(&buf[offset], n - offset);
+        c.parse_time += micros() - start; // Only the time spent in the parser, not waiting for the rest of the request
+        if (c.request.failed()) {
+            c.client.println(c.request.tooLarge() ? "HTTP/1.1 413 Payload Too Large" : "HTTP/1.1 400 Bad Request");
+            c.client.println("Connection: close");
+            c.client.println();
+            close(c);
+            return;
+        }
+        if (!c.request.done()) { // Need more from the client
+            return;
+        }
+        parse_metric.record(c.parse_time);
+        c.parse_time = 0;
+        if (ws_handler != NULL && c.request.method().equals("GET") && c.request.path().equals(ws_path) && c.request.header("Upgrade").equalsIgnoreCase("websocket")) {
+            upgrade(c);
+            if (c.websocket) { // The client may have sent its first message right behind the request
+                receiveWebSocket(c, (const uint8_t *) &buf[offset], n - offset);
+            }
+            return;
+        }
+        // Keep the connection for HTTP/1.1, unless the client asked us not to. HTTP/1.0 would need Content-Length on everything, so just close those
+        bool keepalive = c.request.version().equals("HTTP/1.1") && !c.request.header("Connection").equalsIgnoreCase("close");
+        start = micros();
+        handler(c.client, c.request, keepalive);
+        unsigned long response_time = micros() - start;
+        response_metric.record(response_time);
+        request_count++;
+        if (!keepalive || response_time >= HTTP_WRITE_TIMEOUT * 1000UL) { // As long as a write may wait, so one timed out and the response was cut short. The client would misread the next one
+            close(c);
+            return;
+        }
+        c.request.reset();
+    }
+}
+
+void HttpServer::upgrade(connection_t & c) { // Answer the WebSocket handshake, and switch the connection over
+    char accept[WS_ACCEPT_SIZE];
+    if (!WebSocket::acceptKey(c.request.header("Sec-WebSocket-Key"), accept)) {
+        c.client.println("HTTP/1.1 400 Bad Request");
+        c.client.println("Connection: close");
+        c.client.println();
+        close(c);
+        return;
+    }
+    c.client.println("HTTP/1.1 101 Switching Protocols");
+    c.client.println("Upgrade: websocket");
+    c.client.println("Connection: Upgrade");
+    c.client.print("Sec-WebSocket-Accept: ");
+    c.client.println(accept);
+    c.client.println();
+    request_count++;
+    c.websocket = true;
+    c.ws.reset();
+    ws_handler(&c - slots, NULL, 0);
+}
+
+void HttpServer::receiveWebSocket(connection_t & c, const uint8_t * data, size_t length) { // Decode received bytes, handing each complete message to the handler
+    size_t offset = 0;
+    while (offset < length && !c.ws.closed()) {
+        offset += c.ws.feed(&data[offset], length - offset);
+        if (c.ws.ready()) {
+            if (c.ws.opcode() == WebSocket::opcode_t::binary) { // Text messages aren't part of our protocol
+                ws_handler(&c - slots, c.ws.message(), c.ws.messageLength());
+            }
+            c.ws.next();
+        }
+    }
+}
+
+void HttpServer::serviceWebSocket(connection_t & c) { // Read what the client sent, and send whatever is queued for it
+    int n = c.client.available();
+    if (n > 0) {
+        uint8_t buf[HTTP_READ_CHUNK];
+        n = c.client.read(buf, min(n, HTTP_READ_CHUNK)); // Only what is already there, so this doesn't wait
+        if (n > 0) {
+            receiveWebSocket(c, buf, n);
+        }
+    }
+    if (!c.ws.flush(c.client.fd()) || c.ws.closed()) {
+        c.ws.flush(c.client.fd()); // Last try to get a close frame out
+        close(c);
+    }
+}
+
+void HttpServer::close(connection_t & c) {
+    c.client.stop();
+    c.active = false;
+    c.websocket = false;
+}
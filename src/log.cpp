@@ -0,0 +1,102 @@
+//log.cpp
+// Usage:
+//      - Log with the macros LOG_ERROR(), LOG_WARN(), LOG_INFO() and LOG_DEBUG(), printf style. Each call is one line, no newline needed
+//      - Levels above LOG_LEVEL compile to nothing, arguments and all
+//      - Call Log.begin(Serial) once in setup() (after Serial.begin()) to start the task that prints. Lines logged before that wait in the buffer
+// Writers only format into a free slot and never wait for the UART, so logging from the request path or the DMX task costs a vsnprintf() and nothing more.
+// The slots form a bounded lock-free queue (sequence number per slot): any task can write, only the log task reads.
+// When all slots are full the line is dropped and counted, the task reports how many were lost once it catches up.
+
+#include "log.h"
+#include <stdarg.h>
+
+Logger Log;
+
+static const char level_names[] = {' ', 'E', 'W', 'I', 'D'};
+
+Logger::Logger() {
+    for (uint32_t i = 0; i < LOG_SLOTS; i++) {
+        slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+    head.store(0, std::memory_order_relaxed);
+    tail = 0;
+    drop_count.store(0, std::memory_order_relaxed);
+    drops_reported = 0;
+    output = NULL;
+    task = NULL;
+}
+
+void Logger::begin(Print & out) {
+    output = &out;
+    xTaskCreatePinnedToCore(taskFunc, "Log Task", 2048, this, 0, &task, 0); // Lowest priority, printing is what we do when there's nothing better to do
+}
+
+Logger::slot_t * Logger::reserve(uint32_t & pos) { // Claim the next free slot for writing. NULL if the buffer is full
+    pos = head.load(std::memory_order_relaxed);
+    while (true) {
+        slot_t * s = &slots[pos & (LOG_SLOTS - 1)];
+        int32_t diff = (int32_t) (s->seq.load(std::memory_order_acquire) - pos);
+        if (diff == 0) { // Free, try to take it
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                return s;
+            }
+        } else if (diff < 0) { // Still holds a line not printed yet, so we're full
+            drop_count.fetch_add(1, std::memory_order_relaxed);
+            return NULL;
+        } else { // Someone else got it first
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::write(int level, const char * format, ...) { // Format a line into the buffer, the macros call this
+    uint32_t pos;
+    slot_t * s = reserve(pos);
+    if (s == NULL) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    vsnprintf(s->text, LOG_LINE_SIZE, format, args);
+    va_end(args);
+    s->level = level;
+    s->seq.store(pos + 1, std::memory_order_release); // Ready for the task
+}
+
+bool Logger::drain() { // Print all lines that are ready. Returns true if anything was printed
+    bool printed = false;
+    while (true) {
+        slot_t * s = &slots[tail & (LOG_SLOTS - 1)];
+        if (s->seq.load(std::memory_order_acquire) != tail + 1) { // Empty, or still being written
+            break;
+        }
+        if (output != NULL) {
+            output->print(level_names[s->level < sizeof(level_names) ? s->level : 0]);
+            output->print(' ');
+            output->println(s->text);
+        }
+        s->seq.store(tail + LOG_SLOTS, std::memory_order_release); // Free for the writer one lap ahead
+        tail++;
+        printed = true;
+    }
+    uint32_t d = drop_count.load(std::memory_order_relaxed);
+    if (d != drops_reported && output != NULL) {
+        output->print("W ");
+        output->print(d - drops_reported);
+        output->println(" log lines dropped");
+        drops_reported = d;
+    }
+    return printed;
+}
+
+uint32_t Logger::dropped() { // Lines lost to a full buffer since boot
+    return drop_count.load(std::memory_order_relaxed);
+}
+
+void Logger::taskFunc(void * p) {
+    Logger * l = (Logger *) p;
+    while (true) {
+        l->drain();
+        vTaskDelay(LOG_DRAIN_INTERVAL);
+    }
+}
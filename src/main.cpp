@@ -10,14 +10,25 @@ ESP32 Wifi DMX Bridge - based on sample projects cobbled together and expanded..
 #define ESP_DEVICE_NAME   "DMX Remote"
 
 static esp_wps_config_t config;
+volatile bool WPSRunning = false; // Set while WPS is looking for an access point, so a disconnect doesn't make us reconnect to the old one
+volatile bool WPSButton = false; // WPS was asked for with the button. Otherwise it only runs because the stored network didn't show up, and takes turns with it
+
+// WiFi connection. The last network is remembered, so a reboot (or power blip) reconnects on its own. WPS is only needed for a new network
+#define WIFI_FAST_TIMEOUT 4000 // ms trying the stored access point directly (known BSSID and channel, no scan) before falling back to a normal scan for the SSID
+#define WIFI_CONNECT_TIMEOUT 20000 // ms trying the stored network at all before giving up on it and starting WPS
+#define WPS_BUTTON 0 // Boot button. Held during boot, or pressed while connecting, starts WPS right away
+WiFiStore wifistore;
+volatile unsigned long WiFiAttemptStart = 0; // When we last started trying the stored network, WPS takes over WIFI_CONNECT_TIMEOUT after that
+unsigned long WiFiConnectTime = 0; // ms from boot until WiFi was up
+unsigned long FirstRequestTime = 0; // ms from boot until the first HTTP request could be answered
 
 // Server stuff
-WiFiServer server(80);
+HttpServer server(80, handleHTTPRequest);
 const char* ssid     = "";
 const char* password = "";
 
 // OS stuff
-TaskHandle_t ADCTask, LEDTask, DMXTask;
+TaskHandle_t ADCTask, DMXTask, DMXInputTask, ArtNetTask, E131Task, HTTPTask;
 
 // Pin definitions
 #define LED 2
@@ -33,24 +44,69 @@ TaskHandle_t ADCTask, LEDTask, DMXTask;
 //LEDs
 StatusLed leds(LED_G, LED_B, LED_R);
 
-// ADC variables
-int ADCArray[60];
-int ADCArraySize = sizeof(ADCArray) / sizeof(ADCArray[0]);
-int ADCAverage = 0;
-int vbatval = 0;
-int vextval = 0;
-int temp = 0;
-
-// DMX stuff
-#define DMXArraySize 512
-byte DMXArray[DMXArraySize];
-volatile dmxsemaphore_t DMXupdate = dmxsemaphore_t::free; // Semaphore to allow usage of DMXArray
+// Voltage monitor stuff - battery and external supply, see handleResponseADC()
+VoltageMonitor voltages(VBAT, VEXT);
+#define LOW_VOLTAGE_FADE 2000 // ms to fade to the low voltage look once a threshold is crossed
+byte LowVoltageFrame[DMXArraySize]; // Scene to fade the first universe to on low voltage. Loaded when chosen, so nothing is read from flash with the supply going
+int LowVoltageSlots = 0; // Slots the scene uses
+volatile bool LowVoltageScene = false; // False blacks out every universe instead
 
-int transmitPin = DMX_TX;
+// DMX stuff - one DMXUniverse per output port, each with its own frame buffer, fades, curves and patch
+#ifndef DMX_UNIVERSES
+#define DMX_UNIVERSES 1 // Set to 2 in build_flags for a second output. That needs UART 2, so it replaces the DMX input
+#endif
+#define DMX2_TX 4 // Second output's transceiver
+#define DMX2_EN 5
+DMXUniverse universes[DMX_UNIVERSES] = {
+  {1, DMX_TX, DMX_EN, "curves", "patch"},
+#if DMX_UNIVERSES > 1
+  {2, DMX2_TX, DMX2_EN, "curves2", "patch2"},
+#endif
+};
 int receivePin = DMX_RX;
-int enablePin = DMX_EN;
-dmx_port_t dmxPort = 1;
-byte DMXdata[DMX_PACKET_SIZE];
+#define DMX_FRAME_RATE FRAME_RATE_AUTO // Until DMX?rate= stores another. The period follows the frame length: frames only as long as the highest slot in use, so short universes refresh fastest
+#define DMX_TASK_PRIORITY (configMAX_PRIORITIES - 5) // Above all of ours, below the system's own (WiFi, esp_timer) on the other core
+FrameClock DMXClock; // Paces the DMX task, see frameclock.cpp
+
+// DMX input stuff - a second UART listens on DMX_RX, so the bridge can sit behind a console. Needs its own receive-only transceiver, the output one can't listen while it sends
+// Only with a single universe, otherwise its UART is busy sending the second one
+#define DMX_INPUT_PORT 2
+DMXInput dmxinput(DMX_INPUT_PORT);
+
+// Metrics stuff - cheap enough to leave on, see metrics.cpp. Served at /metrics for Prometheus
+const uint32_t DMXIntervalBounds[] = {1000, 2000, 5000, 10000, 15000, 20000, 23000, 25000, 30000, 50000}; // us. A full 512 slot frame takes about 22.7 ms
+const uint32_t DMXJitterBounds[] = {10, 25, 50, 100, 250, 500, 1000, 2500, 5000, 10000}; // us
+MetricTiming DMXIntervalMetric(DMXIntervalBounds, sizeof(DMXIntervalBounds) / sizeof(DMXIntervalBounds[0])); // Start of one frame to the start of the next
+MetricTiming DMXJitterMetric(DMXJitterBounds, sizeof(DMXJitterBounds) / sizeof(DMXJitterBounds[0])); // How much each frame interval is off the frame period (off the one before when running free)
+MetricTiming DMXSendMetric; // Start of a frame until dmx_wait_sent() returns
+MetricTiming DMXTransformMetric; // Response curves, per frame
+MetricTiming HTTPBytesMetric; // Bytes sent per response
+
+// Scene stuff
+SceneStore scenes; // Named scenes in flash, see handleResponseScene()
+byte SceneFrame[DMXArraySize]; // A scene on its way in or out of flash, only used by the HTTP task (and setup)
+
+// State API stuff - see sendDMXState()
+uint32_t BootId = 0; // Random per boot, part of the ETag so a version from before a restart never matches
+byte APIFrame[DMXArraySize]; // Values being sent, copied out so the frame isn't held while the network is slow. Only used by the HTTP task
+uint16_t APIChanges[DMXArraySize]; // Their addresses, when only the changes are sent
+
+// WebSocket stuff - binary protocol, see handleWebSocketMessage()
+#define WS_PATH "/ws"
+#define WS_PUSH_INTERVAL 50 // ms between change notifications to each WebSocket client, so at most 20 per second
+byte WSSnapshot[HTTP_MAX_CONNECTIONS][DMXArraySize]; // What each WebSocket client has been told so far
+bool WSFullUpdate[HTTP_MAX_CONNECTIONS]; // Client is new and needs the whole universe
+byte WSMessage[3 + DMXArraySize]; // Outgoing change notification, only used by the HTTP task
+
+// Art-Net stuff - Port-Address the node listens to (net 0-127, subnet 0-15, universe 0-15)
+#define ARTNET_NET 0
+#define ARTNET_SUBNET 0
+#define ARTNET_UNIVERSE 0
+ArtNetNode artnet(ARTNET_NET, ARTNET_SUBNET, ARTNET_UNIVERSE);
+
+// sACN (E1.31) stuff - universe 1-63999
+#define E131_UNIVERSE 1
+E131Receiver e131(E131_UNIVERSE);
 
 
 void wpsInitConfig(){
@@ -62,16 +118,18 @@ void wpsInitConfig(){
 }
 
 void wpsStart(){
+    WPSRunning = true;
     if(esp_wifi_wps_enable(&config)){
-    	Serial.println("WPS Enable Failed");
+    	LOG_ERROR("WPS Enable Failed");
     } else if(esp_wifi_wps_start(0)){
-    	Serial.println("WPS Start Failed");
+    	LOG_ERROR("WPS Start Failed");
     }
 }
 
 void wpsStop(){
+    WPSRunning = false;
     if(esp_wifi_wps_disable()){
-    	Serial.println("WPS Disable Failed");
+    	LOG_ERROR("WPS Disable Failed");
     }
 }
 
@@ -89,43 +147,56 @@ void WiFiEvent(WiFiEvent_t event, arduino_event_info_t info){
     case ARDUINO_EVENT_WIFI_STA_START:
       //leds.off();
       //leds.flash(LED_G, 500, 500);
-      Serial.println("Station Mode Started");
+      LOG_INFO("Station Mode Started");
       break;
     case ARDUINO_EVENT_WIFI_STA_GOT_IP:
       leds.off();
       leds.on(LED_G);
-      Serial.println("Connected to :" + String(WiFi.SSID()));
-      Serial.print("Got IP: ");
-      Serial.println(WiFi.localIP());
+      if (!wifistore.save(WiFi.SSID().c_str(), WiFi.psk().c_str(), WiFi.BSSID(), WiFi.channel())) { // Keep BSSID and channel current for the next boot. Only writes if something changed
+        LOG_WARN("Could not store WiFi credentials");
+      }
+      LOG_INFO("Connected to: %s", WiFi.SSID().c_str());
+      LOG_INFO("Got IP: %u.%u.%u.%u", WiFi.localIP()[0], WiFi.localIP()[1], WiFi.localIP()[2], WiFi.localIP()[3]);
       break;
     case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
       leds.off();
       leds.flash(LED_R, 250, 250);
-      Serial.println("Disconnected from station, attempting reconnection");
+      if (WPSRunning) { // Expected while WPS is looking, it connects by itself once done
+        break;
+      }
+      LOG_WARN("Disconnected from station, attempting reconnection");
       WiFi.reconnect();
       break;
     case ARDUINO_EVENT_WPS_ER_SUCCESS:
       leds.off();
       leds.on(LED_B);
-      Serial.println("WPS Successfull, stopping WPS and connecting to: " + String(WiFi.SSID()));
+      LOG_INFO("WPS Successfull, stopping WPS and connecting to: %s", WiFi.SSID().c_str());
       wpsStop();
       delay(10);
       WiFi.begin();
       break;
     case ARDUINO_EVENT_WPS_ER_FAILED:
-      Serial.println("WPS Failed, retrying");
+      LOG_WARN("WPS Failed, retrying");
       wpsStop();
       wpsStart();
       break;
     case ARDUINO_EVENT_WPS_ER_TIMEOUT:
+      wpsStop();
+      if (!WPSButton && wifistore.valid()) { // Nobody asked for a new network, the stored one is most likely just not back yet (the access point rebooting after a power cut). Try it again, setup() goes back to WPS if it still isn't there
+        LOG_WARN("WPS Timedout, trying %s again", wifistore.ssid());
+        leds.off();
+        leds.pattern(LED_G, StatusLed::double_blink);
+        WiFiAttemptStart = millis();
+        WiFi.begin(wifistore.ssid(), wifistore.psk());
+        break;
+      }
       leds.off();
       leds.flash(LED_B, 250, 250);
-      Serial.println("WPS Timedout, retrying");
-      wpsStop();
+      LOG_WARN("WPS Timedout, retrying");
       wpsStart();
       break;
     case ARDUINO_EVENT_WPS_ER_PIN:
-      Serial.println("WPS_PIN = " + wpspin2string(info.wps_er_pin.pin_code));
+      LOG_INFO("WPS_PIN = %s", wpspin2string(info.wps_er_pin.pin_code).c_str());
       break;
     default:
       break;
@@ -135,31 +206,36 @@ void WiFiEvent(WiFiEvent_t event, arduino_event_info_t info){
 void setup()
 {
   Serial.begin(115200);
+  Log.begin(Serial); // Everything else logs through the buffer, so nobody waits for the UART
   pinMode(LED, OUTPUT);      // set the LED pin mode
   pinMode(LED_R, OUTPUT);
   pinMode(LED_G, OUTPUT);
   pinMode(LED_B, OUTPUT);
   pinMode(VBAT, INPUT);
   pinMode(VEXT, INPUT);
+  pinMode(WPS_BUTTON, INPUT_PULLUP);
+  leds.begin(); // Flashing runs off a timer from here on, no task needed
   
-  // DMX setup
-  memset(DMXArray, 0, DMXArraySize);
-  memset(DMXdata, 0, DMX_PACKET_SIZE);
-
-  dmx_config_t DMXconfig = DMX_CONFIG_DEFAULT;
-  dmx_personality_t personalities[] = {};
-  int personality_count = 0;
-  dmx_driver_install(dmxPort, &DMXconfig, personalities, personality_count);
-
-  // Set DMX hardware pins
-  dmx_set_pin(dmxPort, transmitPin, receivePin, enablePin);
+  // DMX setup. The output ports only transmit, DMX_RX belongs to the input port
+  for (auto& u : universes) {
+    u.begin();
+  }
+#if DMX_UNIVERSES == 1
+  dmxinput.begin(receivePin);
+#endif
 
-  // All done, wait a bit to let things settle for no particular reason.
-  delay(1000);
+  // Bring back the last scene, so the rig lights up as soon as the DMX task starts rather than once WiFi is there
+  scenes.begin();
+  if (scenes.last()[0] != '\0') {
+    recallScene({scenes.last(), strlen(scenes.last())}, 0, FadeEngine::curve_t::linear);
+  }
 
-  //xTaskCreatePinnedToCore(ADCTaskFunc, "ADC Task", 1000, NULL, 1, &ADCTask, 0);
-  xTaskCreatePinnedToCore(DMXTaskFunc, "DMX Task", 1000, NULL, 1, &DMXTask, 0);
-  xTaskCreatePinnedToCore(LEDTaskFunc, "LED Task", 1000, NULL, 2, &LEDTask, 0);
+  voltages.onLow(handleLowVoltage);
+  xTaskCreatePinnedToCore(ADCTaskFunc, "ADC Task", 2048, NULL, 1, &ADCTask, 0);
+  xTaskCreatePinnedToCore(DMXTaskFunc, "DMX Task", 2048, NULL, DMX_TASK_PRIORITY, &DMXTask, 1); // Core 1 to itself, the WiFi stack and everything else stays on core 0
+#if DMX_UNIVERSES == 1
+  xTaskCreatePinnedToCore(DMXInputTaskFunc, "DMX Input Task", 2048, NULL, 1, &DMXInputTask, 0);
+#endif
   delay(100);
 
   /*leds.flash(LED_B, 250, 250);
@@ -176,183 +252,354 @@ void setup()
 
   // We start by connecting to a WiFi network
 
-  Serial.println();
-  Serial.println();
-  Serial.print("Connecting to wifi...");
-  //Serial.println(ssid);
+  LOG_INFO("Connecting to wifi...");
 
   WiFi.onEvent(WiFiEvent);
   WiFi.mode(WIFI_MODE_STA);
-  Serial.println("Starting WPS");
-  leds.flash(LED_B, 500, 500);
   wpsInitConfig();
-  wpsStart();
+  wifistore.begin();
 
-  //WiFi.begin(ssid, password);
+  // Straight back onto the network we had, unless there is none or the button says otherwise. The DMX task is already running, so the rig holds its look meanwhile
+  WiFiAttemptStart = millis();
+  bool scanned = false;
+  if (wifistore.valid() && digitalRead(WPS_BUTTON) == HIGH) {
+    LOG_INFO("Reconnecting to %s", wifistore.ssid());
+    leds.pattern(LED_G, StatusLed::double_blink);
+    WiFi.begin(wifistore.ssid(), wifistore.psk(), wifistore.channel(), wifistore.bssid());
+  } else {
+    LOG_INFO("Starting WPS");
+    WPSButton = wifistore.valid(); // With a network stored, only the button gets us here
+    leds.flash(LED_B, 500, 500);
+    wpsStart();
+  }
 
-  Serial.println();
   while (WiFi.status() != WL_CONNECTED) {
-    Serial.print(".");
-    delay(500);
+    if (!WPSRunning) {
+      if (digitalRead(WPS_BUTTON) == LOW || millis() - WiFiAttemptStart > WIFI_CONNECT_TIMEOUT) { // Stored network is gone (or unwanted), find a new one
+        LOG_INFO("Starting WPS");
+        WPSButton = digitalRead(WPS_BUTTON) == LOW;
+        scanned = true; // If WPS times out, the stored network is tried with a scan straight away
+        WiFi.disconnect();
+        leds.off();
+        leds.flash(LED_B, 500, 500);
+        wpsStart();
+      } else if (!scanned && millis() - WiFiAttemptStart > WIFI_FAST_TIMEOUT) { // Access point may have moved channel, or been replaced. Scan for the SSID instead
+        LOG_INFO("Scanning for %s", wifistore.ssid());
+        scanned = true;
+        WiFi.begin(wifistore.ssid(), wifistore.psk());
+      }
+    } else if (digitalRead(WPS_BUTTON) == LOW) { // Pressed while WPS is already looking, so a new network is wanted after all
+      WPSButton = true;
+    }
+    delay(50);
   }
+  WiFiConnectTime = millis();
   
-  Serial.println("");
-  Serial.println("WiFi connected.");
-  Serial.println("IP address: ");
-  Serial.println(WiFi.localIP());
+  LOG_INFO("WiFi connected after %lu ms.", WiFiConnectTime);
+  LOG_INFO("IP address: %u.%u.%u.%u", WiFi.localIP()[0], WiFi.localIP()[1], WiFi.localIP()[2], WiFi.localIP()[3]);
   leds.off();
   leds.on(LED_G);
 //    digitalWrite(LED_G, HIGH);
   
+  BootId = esp_random(); // Only properly random with the radio on
+  server.onWebSocket(WS_PATH, handleWebSocketMessage);
   server.begin();
 
+  // Network protocol listeners need WiFi up, so start them last. Keep them on core 0 next to the WiFi stack, away from the DMX task
+  xTaskCreatePinnedToCore(HTTPTaskFunc, "HTTP Task", 4096, NULL, 1, &HTTPTask, 0);
+  xTaskCreatePinnedToCore(ArtNetTaskFunc, "Art-Net Task", 2048, NULL, 1, &ArtNetTask, 0);
+  xTaskCreatePinnedToCore(E131TaskFunc, "sACN Task", 2048, NULL, 1, &E131Task, 0);
+
 }
 
 int value = 0;
 
-String voltageMonitorToString() {
-  vbatval = analogReadMilliVolts(VBAT) << 1;
-
-  temp = analogReadMilliVolts(VEXT);
-  vextval = temp + (temp >> 1);
-
-  String s = String("VBat: ");
-  s += vbatval;
-  s += String(" mV   VExt: ");
-  s += vextval;
-  s += String(" mV.");
-
-  return s;
-}
-String voltageMonitorTableToString() {
-  String s = "<table>";
-  for (int i = 0; i < ADCArraySize; i++) {
-    s += "<tr><td>";
-    s += ADCArray[i];
-    s += "</td></tr>";
+void printVoltageMonitorTable(Print & out) { // Newest first, one row per VOLTAGE_INTERVAL
+  out.print("<table><tr><th>Seconds ago</th><th>VBat</th><th>VExt</th></tr>");
+  for (int i = 0; i < voltages.historySize(); i++) {
+    out.print("<tr><td>");
+    out.print(i * VOLTAGE_INTERVAL / 1000);
+    out.print("</td><td>");
+    out.print(voltages.history(VoltageMonitor::channel_t::vbat, i));
+    out.print("</td><td>");
+    out.print(voltages.history(VoltageMonitor::channel_t::vext, i));
+    out.print("</td></tr>");
   }
-  s += "</table>";
-  return s;
+  out.print("</table>");
 }
-String dmxDataToTableString() {
-  String s = "<table>";
+void printDMXDataTable(Print & out, int universe) { // Printed row by row straight into the (chunked) response, never held in memory as a whole
+  const byte * DMXArray = universes[universe].buffer.current();
+  char link[24]; // Links stay on the universe being shown
+  snprintf(link, sizeof(link), universe > 0 ? "DMX?universe=%d&set=" : "DMX?set=", universe + 1);
+  out.print("<table>");
   for (int i = 0; i < DMXArraySize; i++) {
-    s += "<tr><td>";
-    s += i;
-    s += "</td><td>";
-    s += String((DMXArray[i]), DEC);
-    s += "</td><td>";
-    s += "<a href=\"DMX?set=";
-    s += i;
-    s += ",0\">0</a>";
-    s += "</td><td>";
-    s += "<a href=\"DMX?set=";
-    s += i;
-    s += ",255\">255</a>";
-    s += "</td></tr>";
-  }
-  s += "</table>";
-  return s;
-}
-bool validateInputPureInt(String s) {
-  const char * a = s.c_str();
-  bool ok = true;
-  while (*a != '\0') {
-    if(!isDigit(*a)) {
-      ok = false;
-      //Serial.println("Address not an int");
-      break;
+    out.print("<tr><td>");
+    out.print(i);
+    out.print("</td><td>");
+    out.print(DMXArray[i]);
+    out.print("</td><td><a href=\"");
+    out.print(link);
+    out.print(i);
+    out.print(",0\">0</a></td><td><a href=\"");
+    out.print(link);
+    out.print(i);
+    out.print(",255\">255</a></td></tr>");
+  }
+  out.print("</table>");
+}
+void printUniverseLinks(Print & out, const char * resource, int universe) { // Switch between universes on a page, nothing with only one
+  if (DMX_UNIVERSES == 1) {
+    return;
+  }
+  out.print("Universe:");
+  for (int u = 0; u < DMX_UNIVERSES; u++) {
+    if (u == universe) {
+      out.print(" <b>");
+      out.print(u + 1);
+      out.print("</b>");
+    } else {
+      out.print(" <a href=\"");
+      out.print(resource);
+      out.print("?universe=");
+      out.print(u + 1);
+      out.print("\">");
+      out.print(u + 1);
+      out.print("</a>");
     }
-    a++;
   }
-  return ok;
+  out.print("<br>");
+}
+int selectUniverse(StrView action) { // universe=n anywhere in the query, 1 to DMX_UNIVERSES. Returns the index, the first universe if there's no (valid) selector
+  StrView idx, val;
+  while (action.nextPair(idx, val))
+  {
+    int u;
+    if (idx.equalsIgnoreCase("universe") && val.toInt(u) && u >= 1 && u <= DMX_UNIVERSES) {
+      return u - 1;
+    }
+  }
+  return 0;
 }
 
-void loop(){
-WiFiClient client = server.available();   // listen for incoming clients
-
-  if (client) {                             // if you get a client,
-    Serial.println("New Client.");          // print a message out the serial port
-    String currentLine = "";                // make a String to hold incoming data from the client
-    String resourceRequested = "";          // The Resource requested by the client (if any)
-    while (client.connected()) {            // loop while the client's connected
-      if (client.available()) {             // if there's bytes to read from the client,
-        char c = client.read();             // read a byte, then
-        Serial.write(c);                    // print it out the serial monitor
-        if (c == '\n') {                    // on newline, we have a full line of information to process from the client
-          // if the current line is also blank, you got two newline characters in a row.
-          // that's the end of the client HTTP request, so send a response:
-          if (currentLine.length() == 0) { // No other characters were added to currentLine, so client has gone \n\n - end of request
-            sendHTTPResponse(client, resourceRequested); // Send HTTP response to client
-
-            // The HTTP response ends with another blank line:
-            client.println();
-            // break out of the while loop:
-            break;
-          } else {    // if you got a newline, check if there's anything to handle and then then clear currentLine:
-            String s = readHTTPResponse(currentLine);
-            if (s != "") resourceRequested = s;
-            currentLine = "";
-          }
-        } else if (c != '\r') {  // if you got anything else but a carriage return character,
-          currentLine += c;      // add it to the end of the currentLine
-        }
+void printDMXInputTable(Print & out) {
+  const byte * input = dmxinput.current();
+  out.print("<table>");
+  for (int i = 0; i < dmxinput.slots(); i++) {
+    out.print("<tr><td>");
+    out.print(i);
+    out.print("</td><td>");
+    out.print(input[i]);
+    out.print("</td><td>");
+    out.print(dmxinput.getMerge(i) == DMXInput::merge_t::ltp ? "LTP" : "HTP");
+    out.print("</td></tr>");
+  }
+  out.print("</table>");
+}
+void printMetrics(Print & out) { // Everything in the Prometheus text format
+  DMXIntervalMetric.print(out, "dmx_frame_interval_us", "Time from the start of one DMX frame to the start of the next");
+  DMXJitterMetric.print(out, "dmx_frame_jitter_us", "Difference between a DMX frame interval and the frame period, or the interval before it when running free");
+  DMXSendMetric.print(out, "dmx_send_us", "Time from starting a DMX frame until it was sent");
+  DMXTransformMetric.print(out, "dmx_transform_us", "Time taken to apply the response curves to a frame, per universe");
+  MetricTiming::printValue(out, "dmx_frame_rate", "gauge", "Frames per second the DMX output is paced at, 0 when running free", DMXClock.pacedRate());
+  MetricTiming::printValue(out, "dmx_frame_overruns_total", "counter", "DMX frames that weren't ready in time and went out a period late", DMXClock.overruns());
+  out.println("# HELP dmx_frame_slots Slots in the DMX frames being sent");
+  out.println("# TYPE dmx_frame_slots gauge");
+  for (int u = 0; u < DMX_UNIVERSES; u++) {
+    out.print("dmx_frame_slots{universe=\"");
+    out.print(u + 1);
+    out.print("\"} ");
+    out.println(universes[u].frameSlots());
+  }
+  MetricTiming::printValue(out, "dmx_input_live", "gauge", "1 if a DMX input signal is present", dmxinput.live());
+  MetricTiming::printValue(out, "dmx_input_errors_total", "counter", "Bad frames received on the DMX input", dmxinput.errors());
+  MetricTiming::printValue(out, "dmx_input_merge_max_us", "gauge", "Worst case time to merge the input with the network frame", dmxinput.mergeTimeMax());
+  server.parseTime().print(out, "http_parse_us", "Time spent parsing each HTTP request");
+  server.responseTime().print(out, "http_response_us", "Time taken to send each HTTP response");
+  HTTPBytesMetric.print(out, "http_response_bytes", "Bytes sent per HTTP response");
+  MetricTiming::printValue(out, "http_requests_total", "counter", "HTTP requests handled", server.requests());
+  MetricTiming::printValue(out, "http_connections", "gauge", "HTTP connections open", server.connections());
+
+  struct {
+    const char * name;
+    TaskHandle_t task;
+  } tasks[] = {{"DMX", DMXTask}, {"DMX Input", DMXInputTask}, {"ADC", ADCTask}, {"HTTP", HTTPTask}, {"Art-Net", ArtNetTask}, {"sACN", E131Task}};
+  out.println("# HELP task_stack_free_bytes Least stack a task ever had left");
+  out.println("# TYPE task_stack_free_bytes gauge");
+  for (auto& t : tasks) {
+    if (t.task == NULL) { // Not started
+      continue;
+    }
+    out.print("task_stack_free_bytes{task=\"");
+    out.print(t.name);
+    out.print("\"} ");
+    out.println(uxTaskGetStackHighWaterMark(t.task));
+  }
 
+  MetricTiming::printValue(out, "heap_free_bytes", "gauge", "Free heap", ESP.getFreeHeap());
+  MetricTiming::printValue(out, "heap_min_free_bytes", "gauge", "Lowest free heap since boot", ESP.getMinFreeHeap());
+  MetricTiming::printValue(out, "heap_largest_block_bytes", "gauge", "Largest block that can be allocated", ESP.getMaxAllocHeap());
+  out.println("# HELP supply_voltage_mv Supply voltage, moving average");
+  out.println("# TYPE supply_voltage_mv gauge");
+  for (auto c : {VoltageMonitor::channel_t::vbat, VoltageMonitor::channel_t::vext}) {
+    out.print("supply_voltage_mv{supply=\"");
+    out.print(VoltageMonitor::name(c));
+    out.print("\"} ");
+    out.println(voltages.average(c));
+  }
+  MetricTiming::printValue(out, "supply_low_events_total", "counter", "Times a supply dropped below its threshold", voltages.lowEvents());
+  MetricTiming::printValue(out, "wifi_rssi_dbm", "gauge", "WiFi signal strength", WiFi.RSSI());
+  MetricTiming::printValue(out, "log_dropped_total", "counter", "Log lines lost to a full log buffer", Log.dropped());
+  MetricTiming::printValue(out, "boot_wifi_connected_ms", "gauge", "Time from boot until WiFi was connected", WiFiConnectTime);
+  MetricTiming::printValue(out, "boot_first_request_ms", "gauge", "Time from boot until the first HTTP request was answered", FirstRequestTime);
+  MetricTiming::printValue(out, "uptime_seconds", "counter", "Time since boot", millis() / 1000);
+}
+void printCurveTable(Print & out, ResponseCurves & curves) {
+  out.print("<table><tr><th>Curve</th><th>Shape</th><th>Min</th><th>Max</th><th>Channels</th></tr>");
+  for (int i = 0; i < CURVE_MAX; i++) {
+    const ResponseCurves::curve_t& c = curves.curve(i);
+    out.print("<tr><td>");
+    out.print(i);
+    out.print("</td><td>");
+    if (c.points == 0) {
+      out.print("gamma ");
+      out.print(c.gamma / 100);
+      out.print(c.gamma % 100 < 10 ? ".0" : ".");
+      out.print(c.gamma % 100);
+    } else {
+      for (int p = 0; p < c.points; p++) {
+        out.print(p > 0 ? ", " : "points ");
+        out.print(c.in[p]);
+        out.print(":");
+        out.print(c.out[p]);
       }
     }
-    // close the connection:
-    client.stop();
-    Serial.println("Client Disconnected.");
+    out.print("</td><td>");
+    out.print(c.min);
+    out.print("</td><td>");
+    out.print(c.max);
+    out.print("</td><td>");
+    out.print(curves.channels(i));
+    out.print("</td></tr>");
   }
+  out.print("</table>");
 }
-String readHTTPResponse(String line) {
-  String resource = "";
-  
-  //Serial.println("Checking line: " + line);
-  if (line.startsWith("GET ")) { // Lines starting with GET are requests from the client, we should do something
-    //Serial.println("Found GET ");
-    String s = line.substring(4); // Trim off the "GET " off the start - put this in a new String in case someone else wants to check the same line for something else... maybe?
-    //Serial.println("Trimmed string: " + s);
-    int firstspace = s.indexOf(" "); // Find the first space - that will be the delimeter to any other junk the client is sending (like HTTP version)
-    if (firstspace > 0) {
-      s = s.substring(0, firstspace); // s will now contain only the interesting request part
-      Serial.println("Chopped string: " + s);
-      int questionmark = s.indexOf("?"); // ? is used to separate resource from action - IP/resource?index=value&index2=value2
-      if (questionmark < 1) { // If there is no action, the whole string is interesting for resource check. Start looking at index 1, because index 0 will be the first / after the IP address
-        questionmark = s.length();
+void printPatchTable(Print & out, PatchTable & patch) {
+  out.print("<table><tr><th>Channel</th><th>Level</th><th>Addresses</th></tr>");
+  for (int c = 0; c < PATCH_CHANNELS; c++) {
+    bool patched = false;
+    for (int i = 0; i < patch.entries(); i++) {
+      const PatchTable::entry_t& e = patch.entry(i);
+      if (e.channel != c)
+        continue;
+      if (!patched) {
+        out.print("<tr><td>");
+        out.print(c);
+        out.print("</td><td>");
+        out.print(patch.level(c));
+        out.print("</td><td>");
+        patched = true;
+      } else {
+        out.print(", ");
       }
-      resource = s.substring(1, questionmark); // Get only the Resource part of the URL, offset to 1 because of the first mandatory / after the IP address
-      Serial.println("Resource: " + resource);
-      String action = s.substring(questionmark + 1, s.length());
-      if (resource.equalsIgnoreCase("LED")) { // Request for LED stuff
-        handleResponseLED(action);        
-      } else if (resource.equalsIgnoreCase("DMX")) { // Request for DMX stuff
-        handleResponseDMX(action);
-      } else { // Unknown request.. probably do nothing here? But will still tell request handler the resource requested
-        NOP();
+      out.print(e.address);
+      if (e.width == 2) {
+        out.print("/");
+        out.print(e.address + 1);
       }
+    }
+    if (patched) {
+      out.print("</td></tr>");
+    }
+  }
+  out.print("</table>");
+}
+void printSceneTable(Print & out) {
+  out.print("<table>");
+  for (int i = 0; i < SCENE_MAX; i++) {
+    const char * name = scenes.name(i);
+    if (name[0] == '\0') {
+      continue;
+    }
+    out.print("<tr><td>");
+    out.print(name); // Names are checked when saved, nothing in them needs escaping
+    out.print("</td><td>");
+    out.print(scenes.size(i));
+    out.print(" bytes</td><td><a href=\"SCENE?recall=");
+    out.print(name);
+    out.print("\">recall</a></td><td><a href=\"SCENE?recall=");
+    out.print(name);
+    out.print("&time=3000\">fade in</a></td><td><a href=\"SCENE?delete=");
+    out.print(name);
+    out.print("\">delete</a></td></tr>");
+  }
+  out.print("</table>");
+}
 
+void loop(){
+  vTaskDelete(NULL); // Nothing to do here, the HTTP server has its own task. Give the loop task's stack back
+}
+void handleHTTPRequest(WiFiClient & client, HttpRequestParser & request, bool keepalive) { // Called by the server for every complete request
+  if (FirstRequestTime == 0) { // Boot to controllable, the number fast reconnect is all about
+    FirstRequestTime = millis();
+    LOG_INFO("First request %lu ms after boot", FirstRequestTime);
+  }
+  LOG_DEBUG("Request: %.*s", (int) request.requestLine().length, request.requestLine().data);
+  if (request.method().equals("POST")) { // Only used by programs, so they get a bare status rather than a page
+    if (request.path().equalsIgnoreCase("/DMX")) {
+      sendStatusResponse(client, handlePostDMX(request.query(), request.body()) ? "204 No Content" : "400 Bad Request", keepalive);
+    } else {
+      sendStatusResponse(client, "404 Not Found", keepalive);
     }
+    return;
+  }
+  if (request.method().equals("GET") && request.path().equalsIgnoreCase("/api/dmx")) { // Also for programs, and it needs the request headers
+    sendDMXState(client, request, keepalive);
+    return;
+  }
+  if (request.method().equals("GET") && WebUI::serve(client, request, keepalive)) { // The browser UI under /ui, gzipped from flash
+    return;
+  }
+  StrView resourceRequested = readHTTPResponse(request);
+  sendHTTPResponse(client, resourceRequested, request.query(), request.version().equals("HTTP/1.1"), keepalive); // Send HTTP response to client, chunked if it understands that
+}
+StrView readHTTPResponse(HttpRequestParser & request) {
+  StrView resource = request.path();
+
+  if (request.method().equals("GET")) { // GET requests from the client, we should do something
+    if (resource.length > 0 && resource.data[0] == '/') { // Skip the first mandatory / after the IP address
+      resource.data++;
+      resource.length--;
+    }
+    StrView action = request.query(); // ? is used to separate resource from action - IP/resource?index=value&index2=value2
+    if (resource.equalsIgnoreCase("LED")) { // Request for LED stuff
+      handleResponseLED(action);
+    } else if (resource.equalsIgnoreCase("DMX")) { // Request for DMX stuff
+      handleResponseDMX(action);
+    } else if (resource.equalsIgnoreCase("SCENE")) { // Request for scene stuff
+      handleResponseScene(action);
+    } else if (resource.equalsIgnoreCase("INPUT")) { // Request for DMX input stuff
+      handleResponseInput(action);
+    } else if (resource.equalsIgnoreCase("CURVE")) { // Request for response curve stuff
+      handleResponseCurve(action);
+    } else if (resource.equalsIgnoreCase("PATCH")) { // Request for patch stuff
+      handleResponsePatch(action);
+    } else if (resource.equalsIgnoreCase("ADC")) { // Request for voltage monitor stuff
+      handleResponseADC(action);
+    } else if (resource.equalsIgnoreCase("jitter")) { // Request for a frame timing measurement
+      handleResponseJitter(action);
+    } else { // Unknown request.. probably do nothing here? But will still tell request handler the resource requested
+      NOP();
+    }
+  } else {
+    resource.length = 0; // Only GET is understood, anything else gets the default page
   }
   return (resource);
 }
 
-void handleResponseLED(String action) {
-  int equalsign = action.indexOf("=");
-  while (equalsign >= 0)
+void handleResponseLED(StrView action) {
+  StrView idx, val;
+  while (action.nextPair(idx, val)) // Work through each index=value pair
   {
-    int ampersand = action.indexOf("&"); // Ampersand will delimit the end of this index value pair
-    // If there is no ampersand, we want to consider the whole remaining string
-    int endpoint = action.length(); // Default to use the whole string
-    if (ampersand >= 0)
-    { // Ampersand found, stop at it instead
-      endpoint = ampersand;
-    }
-    String idx = action.substring(0, equalsign);
-    String val = action.substring(equalsign + 1, endpoint);
-    //Serial.println("Index: " + idx);
-    //Serial.println("Value: " + val);
-
     if (idx.equalsIgnoreCase("set"))
     {
       if (val.equalsIgnoreCase("on"))
@@ -364,196 +611,889 @@ void handleResponseLED(String action) {
         digitalWrite(LED, LOW);
       }
     }
-
-    // Step up to the next index=value pair
-    equalsign = -1; // Assume no equal sign found for it yet... (also breaks while loop if no ampersand found)
-    if (ampersand >= 0)
-    {
-      action = action.substring(ampersand + 1, action.length()); // Trim down action string by one pair
-      equalsign = action.indexOf("=");
-      //Serial.println("Next pair to be shaved!");
-    }
   }
 }
-void handleResponseDMX(String action) {
-  int timeout = 1000;
-  Serial.println("Checking DMXArray Semaphore");
-  while (DMXupdate != dmxsemaphore_t::free && timeout > 0) {
-    // Someone else is modifying the DMXArray, so we shouldn't interfere. Wait until it's free, or until we get a timeout
-    vTaskDelay(1);
-    timeout--;
-    Serial.print(".");
+// Sets stop fades, but only once the frame with the new value is published. A cancel the DMX task handles while it still has the old frame
+// would hand the channel back to that frame's (pre-set) value for a frame. So producers note the channels in a bitmap while writing, and cancel after endWrite()
+void cancelFades(FadeEngine & fader, const uint32_t * channels) {
+  for (int w = 0; w < DMXArraySize / 32; w++) {
+    for (uint32_t bits = channels[w]; bits != 0; bits &= bits - 1) {
+      fader.cancel(w * 32 + __builtin_ctz(bits));
+    }
   }
-  if (timeout <= 0) {
-    Serial.println("!");
-    Serial.println("DMX response handle timed out!");
-    Serial.println("!");
+}
+void handleResponseDMX(StrView action) {
+  DMXUniverse & universe = universes[selectUniverse(action)];
+  DMXFrameBuffer & DMXbuffer = universe.buffer;
+  FadeEngine & fader = universe.fader;
+  int break_us = universe.breakLength();
+  int mab_us = universe.mabLength();
+  byte * DMXArray = DMXbuffer.beginWrite(1000); // Other producers only hold this for a moment, the DMX task never does
+  if (DMXArray == NULL) {
+    LOG_WARN("DMX response handle timed out!");
     return;
   }
-  // Acquire semaphore - we're might be changing stuff, so don't let others in...
-  DMXupdate = dmxsemaphore_t::busy;
 
-  bool updated = false;
-  int equalsign = action.indexOf("=");
-  while (equalsign >= 0)
+  uint32_t cancels[DMXArraySize / 32] = {}; // Fades to stop once the frame is out, see cancelFades()
+  StrView idx, val;
+  while (action.nextPair(idx, val)) // Work through each index=value pair
   {
-    int ampersand = action.indexOf("&"); // Ampersand will delimit the end of this index value pair
-    // If there is no ampersand, we want to consider the whole remaining string
-    int endpoint = action.length(); // Default to use the whole string
-    if (ampersand >= 0)
-    { // Ampersand found, stop at it instead
-      endpoint = ampersand;
-    }
-    String idx = action.substring(0, equalsign);
-    String val = action.substring(equalsign + 1, endpoint);
-    //Serial.println("Index: " + idx);
-    //Serial.println("Value: " + val);
-
     if (idx.equalsIgnoreCase("set"))
     {
       // For DMX set, we expect an address value pair, each of which needs to be a byte (0-255), comma-separated
-      int comma = val.indexOf(",");
-      if (comma > 0) { // Must have at least one character as address anyway, so it's OK to check for strict greater than zero rather than inclusive
-        String address = val.substring(0, comma);
-        String data = val.substring(comma + 1, val.length());
-        if(validateInputPureInt(address) && validateInputPureInt(data)) { // Check that address and data are clean integers (that we can do toInt() on them without silly 0 side-effects)
-          //Serial.println("Address and data are both OK");
-          int address_int = address.toInt();
-          int data_int = data.toInt();
-          if (address_int >= 0 && address_int < 512 && data_int >= 0 && data_int < 256) { // Only act on byte values, silently discard any other silly attempts
-            //Serial.println("DMXArray Update:");
-            //Serial.print(" Address: ");
-            //Serial.print(address_int);
-            //Serial.print(" Data: ");
-            //Serial.print(data_int);
-            //Serial.print("\n");
-            DMXArray[address_int] = data_int;
-            updated = true; // We've updated at least one data point in the array, so this will allow us to let the semaphore know once we're done with all updates
+      StrView address = val.token(',');
+      int address_int, data_int;
+      if (address.toInt(address_int) && val.toInt(data_int)) { // Check that address and data are clean integers
+        if (address_int >= 0 && address_int < 512 && data_int >= 0 && data_int < 256) { // Only act on byte values, silently discard any other silly attempts
+          DMXArray[address_int] = data_int;
+          DMXbuffer.markDirty(address_int, 1); // The frame gets published once we're done with all updates, copying only what changed
+          if (fader.fading(address_int)) { // A set is a snap, so it stops any fade on the channel
+            cancels[address_int >> 5] |= 1UL << (address_int & 31);
           }
         }
       }
+    } else if (idx.equalsIgnoreCase("fade")) {
+      // For DMX fade, we expect address, target value and time in ms, optionally followed by the curve (linear, in, out or smooth), comma-separated
+      StrView address = val.token(',');
+      StrView data = val.token(',');
+      StrView time = val.token(',');
+      int address_int, data_int, time_int;
+      FadeEngine::curve_t curve = FadeEngine::curve_t::linear;
+      if (address.toInt(address_int) && data.toInt(data_int) && time.toInt(time_int) && (val.empty() || FadeEngine::parseCurve(val.data, val.length, curve))) {
+        if (address_int >= 0 && address_int < 512 && data_int >= 0 && data_int < 256) {
+          // The fade is queued before the frame with the target is published, so the DMX task always sees the fade first
+          if (time_int == 0 || !fader.fade(address_int, data_int, time_int, curve)) { // Zero time, or the fade queue is full: just snap
+            if (fader.fading(address_int)) cancels[address_int >> 5] |= 1UL << (address_int & 31);
+          } else { // A set earlier in the request mustn't stop this fade
+            cancels[address_int >> 5] &= ~(1UL << (address_int & 31));
+          }
+          DMXArray[address_int] = data_int;
+          DMXbuffer.markDirty(address_int, 1);
+        }
+      }
+    } else if (idx.equalsIgnoreCase("min")) { // Minimum frame length in slots
+      int slots;
+      if (val.toInt(slots) && slots >= 1 && slots <= DMXArraySize) {
+        universe.minSlots = slots;
+      }
+    } else if (idx.equalsIgnoreCase("rate")) { // Frames per second, for all universes, kept over a reboot. 0 (or auto) follows the frame length, free drops the timer
+      int rate = FRAME_RATE_FREE - 1; // Rejected, unless one of these says otherwise
+      if (val.equalsIgnoreCase("auto")) {
+        rate = FRAME_RATE_AUTO;
+      } else if (val.equalsIgnoreCase("free")) {
+        rate = FRAME_RATE_FREE;
+      } else if (!val.toInt(rate)) {
+        rate = FRAME_RATE_FREE - 1;
+      }
+      if (!DMXClock.setRate(rate)) {
+        LOG_WARN("DMX frame rate not set!");
+      }
+    } else if (idx.equalsIgnoreCase("break")) { // Break and mark after break in us, applied together below
+      if (!val.toInt(break_us)) break_us = -1;
+    } else if (idx.equalsIgnoreCase("mab")) {
+      if (!val.toInt(mab_us)) mab_us = -1;
     }
+  }
+  DMXbuffer.endWrite(); // Publish the new frame if we modified anything
+  cancelFades(fader, cancels);
+  if ((break_us != universe.breakLength() || mab_us != universe.mabLength()) && !universe.setTiming(break_us, mab_us)) {
+    LOG_WARN("DMX timing not set!");
+  }
+}
+// POST /DMX writes a block of consecutive channels from the request body in one go, up to a whole universe:
+//   POST /DMX?start=n                  Body is the raw channel values, start is the address (0-511) of the first one (default 0)
+//   POST /DMX?start=n&encoding=hex     Body is two hex digits per channel
+//   POST /DMX?start=n&encoding=base64  Body is base64
+// Add &universe=n for another universe than the first.
+// Anything running past channel 511 is cut off. Like set=, it stops fades on the channels written.
+bool handlePostDMX(StrView action, StrView body) {
+  StrView idx, val;
+  int start = 0;
+  StrView encoding = {"raw", 3};
+  int u = 0;
+  while (action.nextPair(idx, val))
+  {
+    if (idx.equalsIgnoreCase("start")) {
+      if (!val.toInt(start) || start >= DMXArraySize) return false;
+    } else if (idx.equalsIgnoreCase("encoding")) {
+      encoding = val;
+    } else if (idx.equalsIgnoreCase("universe")) { // Unlike GET, a bad one is an error - a program wants to know its data went nowhere
+      if (!val.toInt(u) || u < 1 || u > DMX_UNIVERSES) return false;
+      u--;
+    }
+  }
+  byte data[DMXArraySize]; // Decoded first, so a broken body leaves the universe alone
+  size_t length = 0;
+  if (encoding.equalsIgnoreCase("raw")) {
+    length = min(body.length, (size_t) DMXArraySize);
+    memcpy(data, body.data, length);
+  } else if (encoding.equalsIgnoreCase("hex")) {
+    if (body.length % 2 != 0) return false;
+    length = min(body.length / 2, (size_t) DMXArraySize);
+    for (size_t i = 0; i < length; i++) {
+      char h = body.data[i * 2], l = body.data[i * 2 + 1];
+      if (!isHexadecimalDigit(h) || !isHexadecimalDigit(l)) return false;
+      data[i] = (hexValue(h) << 4) | hexValue(l);
+    }
+  } else if (encoding.equalsIgnoreCase("base64")) {
+    if (mbedtls_base64_decode(data, sizeof(data), &length, (const unsigned char *) body.data, body.length) != 0) return false;
+  } else {
+    return false;
+  }
+  length = min(length, (size_t) (DMXArraySize - start));
+  if (length == 0) {
+    return true;
+  }
 
-    // Step up to the next index=value pair
-    equalsign = -1; // Assume no equal sign found for it yet... (also breaks while loop if no ampersand found)
-    if (ampersand >= 0)
-    {
-      action = action.substring(ampersand + 1, action.length()); // Trim down action string by one pair
-      equalsign = action.indexOf("=");
-      //Serial.println("Next pair to be shaved!");
+  DMXUniverse & universe = universes[u];
+  byte * DMXArray = universe.buffer.beginWrite(1000);
+  if (DMXArray == NULL) {
+    LOG_WARN("DMX response handle timed out!");
+    return false;
+  }
+  memcpy(&DMXArray[start], data, length);
+  universe.buffer.markDirty(start, length);
+  universe.buffer.endWrite();
+  for (size_t i = start; i < start + length; i++) { // Only now the new values are out, see cancelFades()
+    if (universe.fader.fading(i)) universe.fader.cancel(i);
+  }
+  return true;
+}
+int hexValue(char c) {
+  return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+// GET /api/dmx returns the state of a universe, for programs polling it:
+//   {"universe":1,"version":n,"full":true,"values":[value,...]}                 Every slot in use
+//   {"universe":1,"version":n,"full":false,"changes":[[address,value],...]}    With ?since=version, only the slots changed after that version
+// With &format=bin it's the version (4 bytes, big endian) followed by a WebSocket message instead: 0x02 with all values, or 0x01 with the changes.
+// Add &universe=n for another universe than the first. A since= newer than the current version (the bridge restarted meanwhile) gets everything.
+// The version is the ETag as well, so as long as nothing changed If-None-Match gets a bare 304 without the frame even being looked at.
+void sendDMXState(WiFiClient & client, HttpRequestParser & request, bool keepalive) {
+  StrView action = request.query();
+  int u = selectUniverse(action);
+  DMXFrameBuffer & buffer = universes[u].buffer;
+  char etag[24];
+  snprintf(etag, sizeof(etag), "\"%08x-%u\"", (unsigned) BootId, (unsigned) buffer.version());
+  if (etagMatches(request.header("If-None-Match"), etag)) {
+    client.println("HTTP/1.1 304 Not Modified");
+    client.print("ETag: ");
+    client.println(etag);
+    client.println(keepalive ? "Connection: keep-alive" : "Connection: close");
+    client.println();
+    return;
+  }
+
+  StrView idx, val;
+  int since = -1;
+  bool binary = false;
+  while (action.nextPair(idx, val))
+  {
+    if (idx.equalsIgnoreCase("since")) {
+      if (!val.toInt(since)) since = -1;
+    } else if (idx.equalsIgnoreCase("format")) {
+      binary = val.equalsIgnoreCase("bin");
     }
   }
-  // Handle semaphore - did we modify anything?
-  if (updated) {
-    DMXupdate = dmxsemaphore_t::updated;
-    //Serial.println("Leaving DMX Handle. Semaphore set to updated.");
+  byte * DMXArray = buffer.beginWrite(100); // Only for a consistent copy, nothing is changed
+  if (DMXArray == NULL) {
+    sendStatusResponse(client, "503 Service Unavailable", keepalive);
+    return;
+  }
+  uint32_t version = buffer.version();
+  int slots = buffer.slotsUsed(); // Nothing above that ever changed
+  bool full = since < 0 || (uint32_t) since > version;
+  int count = 0;
+  if (full) {
+    memcpy(APIFrame, DMXArray, slots);
+    count = slots;
   } else {
-    DMXupdate = dmxsemaphore_t::free;
-    //Serial.println("Leaving DMX Handle. Semaphore set to free.");
+    for (int i = 0; i < slots; i++) {
+      if (buffer.slotVersion(i) > (uint32_t) since) {
+        APIChanges[count] = i;
+        APIFrame[count] = DMXArray[i];
+        count++;
+      }
+    }
   }
+  buffer.endWrite();
+  snprintf(etag, sizeof(etag), "\"%08x-%u\"", (unsigned) BootId, (unsigned) version); // It may have moved on since the check above
+
+  bool chunked = request.version().equals("HTTP/1.1");
+  client.println("HTTP/1.1 200 OK");
+  client.print("Content-type:");
+  client.println(binary ? "application/octet-stream" : "application/json");
+  client.print("ETag: ");
+  client.println(etag);
+  client.println("Cache-Control: no-cache"); // Keep it, but check back every time - that's what the ETag is for
+  if (chunked) {
+    client.println("Transfer-Encoding: chunked");
+  }
+  client.println(keepalive ? "Connection: keep-alive" : "Connection: close");
+  client.println();
+
+  ChunkedPrint page(client, chunked);
+  if (binary) {
+    byte header[7] = {(byte) (version >> 24), (byte) (version >> 16), (byte) (version >> 8), (byte) version, 0x02, 0, 0};
+    if (full) {
+      page.write(header, 7);
+      page.write(APIFrame, count);
+    } else {
+      header[4] = 0x01;
+      page.write(header, 5);
+      for (int i = 0; i < count; i++) {
+        byte change[3] = {(byte) (APIChanges[i] >> 8), (byte) APIChanges[i], APIFrame[i]};
+        page.write(change, 3);
+      }
+    }
+  } else {
+    page.print("{\"universe\":");
+    page.print(u + 1);
+    page.print(",\"version\":");
+    page.print(version);
+    page.print(full ? ",\"full\":true,\"values\":[" : ",\"full\":false,\"changes\":[");
+    for (int i = 0; i < count; i++) {
+      if (i > 0) page.print(',');
+      if (full) {
+        page.print(APIFrame[i]);
+      } else {
+        page.print('[');
+        page.print(APIChanges[i]);
+        page.print(',');
+        page.print(APIFrame[i]);
+        page.print(']');
+      }
+    }
+    page.print("]}\n");
+  }
+  page.end();
+  HTTPBytesMetric.record(page.bytesSent());
 }
-void sendHTTPResponse(WiFiClient client, String resource) {
+bool etagMatches(StrView header, const char * etag) { // If-None-Match holds a list of ETags, or *
+  if (header.equals("*")) {
+    return true;
+  }
+  return header.find(etag) != NULL;
+}
+void sendStatusResponse(WiFiClient & client, const char * status, bool keepalive) { // Status line and headers only, no body
+  client.print("HTTP/1.1 ");
+  client.println(status);
+  if (strncmp(status, "204", 3) != 0) { // 204 must not have one
+    client.println("Content-Length: 0");
+  }
+  client.println(keepalive ? "Connection: keep-alive" : "Connection: close");
+  client.println();
+}
+void handleResponseScene(StrView action) {
+  // SCENE?save=name stores the current universe, SCENE?recall=name brings it back (add &time=ms, optionally &curve=in/out/smooth, to crossfade), SCENE?delete=name forgets it
+  StrView idx, val, save = {NULL, 0}, recall = {NULL, 0}, remove = {NULL, 0};
+  int time_int = 0;
+  FadeEngine::curve_t curve = FadeEngine::curve_t::linear;
+  while (action.nextPair(idx, val)) // Collect everything first, the order of the pairs doesn't matter
+  {
+    if (idx.equalsIgnoreCase("save")) {
+      save = val;
+    } else if (idx.equalsIgnoreCase("recall")) {
+      recall = val;
+    } else if (idx.equalsIgnoreCase("delete")) {
+      remove = val;
+    } else if (idx.equalsIgnoreCase("time")) {
+      if (!val.toInt(time_int)) time_int = 0;
+    } else if (idx.equalsIgnoreCase("curve")) {
+      FadeEngine::parseCurve(val.data, val.length, curve);
+    }
+  }
+  if (!save.empty() && !saveScene(save)) {
+    LOG_WARN("Scene save failed!");
+  }
+  if (!recall.empty() && !recallScene(recall, time_int, curve)) {
+    LOG_WARN("Scene recall failed!");
+  }
+  if (!remove.empty()) {
+    scenes.remove(remove.data, remove.length);
+  }
+}
+bool saveScene(StrView name) { // Store the first universe under name
+  DMXFrameBuffer & DMXbuffer = universes[0].buffer;
+  byte * DMXArray = DMXbuffer.beginWrite(1000); // Only to get a consistent copy, nothing is changed
+  if (DMXArray == NULL) {
+    return false;
+  }
+  memcpy(SceneFrame, DMXArray, DMXArraySize);
+  DMXbuffer.endWrite();
+  return scenes.save(name.data, name.length, SceneFrame); // Flash is slow, so write it without holding up the other producers
+}
+bool recallScene(StrView name, unsigned long time, FadeEngine::curve_t curve) { // Replace the first universe with a stored scene, crossfading over time ms (0 snaps)
+  DMXFrameBuffer & DMXbuffer = universes[0].buffer;
+  FadeEngine & fader = universes[0].fader;
+  int used = scenes.load(name.data, name.length, SceneFrame); // Decoded before taking the frame, so the swap itself is only a copy
+  if (used < 0) {
+    return false;
+  }
+  byte * DMXArray = DMXbuffer.beginWrite(1000);
+  if (DMXArray == NULL) {
+    return false;
+  }
+  // Queued before the scene is published, like a fade. Stops all running fades too, they would fight the scene otherwise
+  if (!fader.crossfade(time, curve) && time > 0) {
+    fader.crossfade(0, curve);
+  }
+  memcpy(DMXArray, SceneFrame, DMXArraySize);
+  DMXbuffer.markDirty(0, max(used, DMXbuffer.slotsUsed())); // Everything the old look or the scene uses, slots above that are 0 in both
+  DMXbuffer.endWrite();
+  return true;
+}
+void handleResponseCurve(StrView action) {
+  ResponseCurves & curves = universes[selectUniverse(action)].curves;
+  StrView idx, val;
+  int id = -1;
+  ResponseCurves::curve_t c = {100, 0, 255, 0, {0}, {0}};
+  bool valid = true;
+  while (action.nextPair(idx, val)) // Work through each index=value pair. A definition is only made once all its parts are read
+  {
+    int v = 0;
+    if (idx.equalsIgnoreCase("define")) {
+      valid = valid && val.toInt(id);
+    } else if (idx.equalsIgnoreCase("gamma")) {
+      valid = valid && ResponseCurves::parseGamma(val.data, val.length, c.gamma);
+    } else if (idx.equalsIgnoreCase("min")) {
+      valid = valid && val.toInt(v) && v <= 255;
+      c.min = v;
+    } else if (idx.equalsIgnoreCase("max")) {
+      valid = valid && val.toInt(v) && v <= 255;
+      c.max = v;
+    } else if (idx.equalsIgnoreCase("points")) { // in:out,in:out,...
+      c.points = 0;
+      while (!val.empty() && valid) {
+        StrView point = val.token(',');
+        StrView in = point.token(':');
+        int out;
+        valid = c.points < CURVE_POINTS && in.toInt(v) && v <= 255 && point.toInt(out) && out <= 255;
+        if (!valid) { // Too many points, or a broken one. Don't write past the table
+          break;
+        }
+        c.in[c.points] = v;
+        c.out[c.points] = out;
+        c.points++;
+      }
+    } else if (idx.equalsIgnoreCase("assign")) { // address,n or first-last,n
+      StrView range = val.token(',');
+      StrView first = range.token('-');
+      int from, to, n;
+      if (first.toInt(from) && val.toInt(n)) {
+        if (range.empty()) {
+          to = from;
+        } else if (!range.toInt(to)) {
+          continue;
+        }
+        if (!curves.assign(from, to, n)) {
+          LOG_WARN("Curve assign failed!");
+        }
+      }
+    }
+  }
+  if (id >= 0 && (!valid || !curves.define(id, c))) {
+    LOG_WARN("Curve definition failed!");
+  }
+}
+void handleResponsePatch(StrView action) {
+  PatchTable & patch = universes[selectUniverse(action)].patch;
+  StrView idx, val;
+  while (action.nextPair(idx, val)) // Work through each index=value pair
+  {
+    StrView channel = val.token(',');
+    int channel_int;
+    if (!channel.toInt(channel_int)) {
+      continue;
+    }
+    if (idx.equalsIgnoreCase("add")) { // add=channel,address or add=channel,address,16
+      StrView address = val.token(',');
+      int address_int;
+      int bits = 8;
+      if (address.toInt(address_int) && (val.empty() || val.toInt(bits)) && (bits == 8 || bits == 16)) {
+        if (!patch.add(channel_int, address_int, bits / 8)) {
+          LOG_WARN("Patch failed!");
+        }
+      }
+    } else if (idx.equalsIgnoreCase("remove")) {
+      patch.remove(channel_int);
+    } else if (idx.equalsIgnoreCase("set") || idx.equalsIgnoreCase("fade")) { // set=channel,value or fade=channel,value,ms
+      StrView value = val.token(',');
+      int value_int;
+      int time_int = 0;
+      if (value.toInt(value_int) && value_int <= 0xffff && (idx.equalsIgnoreCase("set") || val.toInt(time_int))) {
+        patch.set(channel_int, value_int, time_int);
+      }
+    }
+  }
+}
+void handleResponseADC(StrView action) {
+  StrView idx, val;
+  while (action.nextPair(idx, val)) // Work through each index=value pair
+  {
+    if (idx.equalsIgnoreCase("low")) { // low=vbat,mV or low=vext,mV, 0 turns it off
+      StrView supply = val.token(',');
+      int mv;
+      if (val.toInt(mv)) {
+        if (supply.equalsIgnoreCase("vbat")) {
+          voltages.setLow(VoltageMonitor::channel_t::vbat, mv);
+        } else if (supply.equalsIgnoreCase("vext")) {
+          voltages.setLow(VoltageMonitor::channel_t::vext, mv);
+        }
+      }
+    } else if (idx.equalsIgnoreCase("action")) { // action=blackout or action=scene,name
+      StrView kind = val.token(',');
+      if (kind.equalsIgnoreCase("blackout")) {
+        LowVoltageScene = false;
+      } else if (kind.equalsIgnoreCase("scene")) {
+        LowVoltageScene = false; // Blackout until the scene is in, the monitor may need it meanwhile
+        LowVoltageSlots = scenes.load(val.data, val.length, LowVoltageFrame, false); // Only held ready, the scene to bring back at boot stays what it was
+        if (LowVoltageSlots >= 0) {
+          LowVoltageScene = true;
+        } else {
+          LOG_WARN("Low voltage scene not found!");
+        }
+      }
+    } else if (idx.equalsIgnoreCase("reset")) { // Start minimum and maximum afresh
+      voltages.resetRange();
+    }
+  }
+}
+void handleLowVoltage(VoltageMonitor::channel_t channel, int millivolts) { // Called by the monitor, in the ADC task. Fades to the low voltage look before the supply gives out
+  LOG_WARN("%s down to %d mV, %s", VoltageMonitor::name(channel), millivolts, LowVoltageScene ? "fading to the low voltage scene" : "blacking out");
+  for (int u = 0; u < DMX_UNIVERSES; u++) {
+    DMXUniverse & universe = universes[u];
+    byte * DMXArray = universe.buffer.beginWrite(1000);
+    if (DMXArray == NULL) {
+      continue;
+    }
+    if (!universe.fader.crossfade(LOW_VOLTAGE_FADE, FadeEngine::curve_t::linear)) { // Like a scene recall, the crossfade goes first
+      universe.fader.crossfade(0, FadeEngine::curve_t::linear);
+    }
+    if (u == 0 && LowVoltageScene) {
+      memcpy(DMXArray, LowVoltageFrame, DMXArraySize);
+      universe.buffer.markDirty(0, max(LowVoltageSlots, universe.buffer.slotsUsed()));
+    } else {
+      memset(DMXArray, 0, DMXArraySize);
+      universe.buffer.markDirty(0, universe.buffer.slotsUsed()); // Nothing above that to black out
+    }
+    universe.buffer.endWrite();
+  }
+}
+void handleResponseJitter(StrView action) {
+  StrView idx, val;
+  while (action.nextPair(idx, val)) // Work through each index=value pair
+  {
+    int frames;
+    if (idx.equalsIgnoreCase("frames") && val.toInt(frames) && frames > 0) { // Measure the next frames, the result shows up at /jitter once they're out
+      DMXClock.measure(frames);
+    }
+  }
+}
+// GET /api/status, for the browser UI's status line and scene buttons. frame_rate is what the clock paces at (0 running free), fps what each universe really sent:
+//   {"universes":n,"frame_rate":43,"fps":[...],"slots":[...],"vbat":mV,"vext":mV,"uptime":s,"scenes":["name",...],"last_scene":"name"}
+void printStatus(Print & out) {
+  out.print("{\"universes\":");
+  out.print(DMX_UNIVERSES);
+  out.print(",\"frame_rate\":");
+  out.print(DMXClock.pacedRate());
+  out.print(",\"fps\":[");
+  for (int u = 0; u < DMX_UNIVERSES; u++) {
+    if (u > 0) out.print(',');
+    out.print(universes[u].framesPerSecond());
+  }
+  out.print("],\"slots\":[");
+  for (int u = 0; u < DMX_UNIVERSES; u++) {
+    if (u > 0) out.print(',');
+    out.print(universes[u].buffer.slotsUsed());
+  }
+  out.print("],\"vbat\":");
+  out.print(voltages.latest(VoltageMonitor::channel_t::vbat));
+  out.print(",\"vext\":");
+  out.print(voltages.latest(VoltageMonitor::channel_t::vext));
+  out.print(",\"uptime\":");
+  out.print(millis() / 1000);
+  out.print(",\"scenes\":[");
+  bool first = true;
+  for (int i = 0; i < SCENE_MAX; i++) { // Deleted scenes leave free spots behind, anywhere in the index
+    const char * name = scenes.name(i);
+    if (name[0] == '\0') {
+      continue;
+    }
+    if (!first) out.print(',');
+    first = false;
+    out.print('"');
+    out.print(name); // Names are letters, digits, - and _ only, nothing to escape
+    out.print('"');
+  }
+  out.print("],\"last_scene\":\"");
+  out.print(scenes.last());
+  out.print("\"}\n");
+}
+void printJitter(Print & out) {
+  DMXClock.printMeasurement(out);
+}
+void handleResponseInput(StrView action) {
+  StrView idx, val;
+  while (action.nextPair(idx, val)) // Work through each index=value pair
+  {
+    if (idx.equalsIgnoreCase("merge")) {
+      // Either merge=htp / merge=ltp for all channels, or merge=address,htp for one
+      StrView address = val.token(',');
+      DMXInput::merge_t mode;
+      int address_int;
+      if (val.empty() && DMXInput::parseMerge(address.data, address.length, mode)) {
+        for (int i = 0; i < DMXArraySize; i++) {
+          dmxinput.setMerge(i, mode);
+        }
+      } else if (address.toInt(address_int) && DMXInput::parseMerge(val.data, val.length, mode)) {
+        dmxinput.setMerge(address_int, mode);
+      }
+    } else if (idx.equalsIgnoreCase("reset")) { // Start measuring the worst case merge time afresh
+      dmxinput.resetMergeTime();
+    }
+  }
+}
+void sendHTTPResponse(WiFiClient & client, StrView resource, StrView query, bool chunked, bool keepalive) {
+  if (resource.equalsIgnoreCase("metrics")) { // Plain text for Prometheus, none of the HTML around it
+    sendTextResponse(client, "text/plain; version=0.0.4", printMetrics, chunked, keepalive);
+    return;
+  }
+  if (resource.equalsIgnoreCase("jitter")) { // Frame timing measurement, as JSON
+    sendTextResponse(client, "application/json", printJitter, chunked, keepalive);
+    return;
+  }
+  if (resource.equalsIgnoreCase("api/status")) { // What the browser UI shows besides the faders, as JSON
+    sendTextResponse(client, "application/json", printStatus, chunked, keepalive);
+    return;
+  }
   // HTTP headers always start with a response code (e.g. HTTP/1.1 200 OK)
   // and a content-type so the client knows what's coming, then a blank line:
   client.println("HTTP/1.1 200 OK");
   client.println("Content-type:text/html");
+  if (chunked) {
+    client.println("Transfer-Encoding: chunked");
+  }
+  client.println(keepalive ? "Connection: keep-alive" : "Connection: close");
   client.println();
 
-  // the content of the HTTP response follows the header:
-  client.print("Click <a href=\"/LED?set=on\">here</a> to turn the LED on pin 2 on.<br>");
-  client.print("Click <a href=\"/LED?set=off\">here</a> to turn the LED on pin 2 off.<br>");
-  client.print("Click <a href=\"/DMX\">here</a> to see DMX data.<br>");
-  //client.print("Click <a href=\"/ADC\">here</a> to check ADC voltage readings");
+  // the content of the HTTP response follows the header. It is collected in a small buffer and sent a chunk at a time:
+  ChunkedPrint page(client, chunked);
+  page.print("Faders and scenes in the <a href=\"" WEBUI_PATH "/\">browser UI</a>.<br>");
+  page.print("Click <a href=\"/LED?set=on\">here</a> to turn the LED on pin 2 on.<br>");
+  page.print("Click <a href=\"/LED?set=off\">here</a> to turn the LED on pin 2 off.<br>");
+  page.print("Click <a href=\"/DMX\">here</a> to see DMX data.<br>");
+  page.print("Click <a href=\"/SCENE\">here</a> to see scenes.<br>");
+  page.print("Click <a href=\"/INPUT\">here</a> to see DMX input.<br>");
+  page.print("Click <a href=\"/CURVE\">here</a> to see response curves.<br>");
+  page.print("Click <a href=\"/PATCH\">here</a> to see the patch.<br>");
+  page.print("Metrics for Prometheus at <a href=\"/metrics\">/metrics</a>.<br>");
+  page.print("Measure the DMX frame timing with <a href=\"/jitter?frames=1000\">/jitter?frames=n</a>, put the bridge under load meanwhile and reload <i>/jitter</i> for the percentiles.<br>");
+  page.print("Live DMX data over WebSocket at <i>" WS_PATH "</i>, or poll <a href=\"/api/dmx\">/api/dmx</a> (JSON, add <i>?since=version</i> for only the changes).<br>");
+  page.print("Click <a href=\"/ADC\">here</a> to check the supply voltages.<br>");
   if (resource.equalsIgnoreCase("ADC")) { // Analog voltage monitor page
-    client.print(voltageMonitorToString());
-    client.print("<br>");
-    client.print("Average VBat voltage: <i>");
-    client.print(ADCAverage);
-    client.print("</i> mV.<br><br>");
-    client.print("Last 60 readings: <br>");
-    client.print(voltageMonitorTableToString());
+    for (auto c : {VoltageMonitor::channel_t::vbat, VoltageMonitor::channel_t::vext}) {
+      page.print(c == VoltageMonitor::channel_t::vbat ? "VBat: " : "VExt: ");
+      page.print(voltages.latest(c));
+      page.print(" mV (average ");
+      page.print(voltages.average(c));
+      page.print(", last minute ");
+      page.print(voltages.mean(c));
+      page.print(", lowest ");
+      page.print(voltages.minimum(c));
+      page.print(", highest ");
+      page.print(voltages.maximum(c));
+      page.print(" mV). ");
+      if (voltages.low(c) > 0) {
+        page.print("Low below ");
+        page.print(voltages.low(c));
+        page.print(" mV.<br>");
+      } else {
+        page.print("No low threshold.<br>");
+      }
+    }
+    page.print("Set a threshold with <i>ADC?low=vbat,mV</i> or <i>ADC?low=vext,mV</i> (0 turns it off), what happens then with <i>ADC?action=blackout</i> or <i>ADC?action=scene,name</i>. Now: ");
+    page.print(LowVoltageScene ? "fade to the scene" : "blackout");
+    page.print(", ");
+    page.print(voltages.lowEvents());
+    page.print(" times so far. <a href=\"ADC?reset\">Reset</a> lowest and highest.<br>");
+    printVoltageMonitorTable(page);
   } else if (resource.equalsIgnoreCase("LED")) { // LED page
 
   } else if (resource.equalsIgnoreCase("DMX")) { // DMX page
-    client.print(dmxDataToTableString());
+    int u = selectUniverse(query);
+    DMXUniverse & universe = universes[u];
+    printUniverseLinks(page, "DMX", u);
+    page.print("Sending ");
+    page.print(universe.frameSlots());
+    page.print(" slots at ");
+    page.print(universe.framesPerSecond());
+    page.print(" frames/s (minimum frame length ");
+    page.print(universe.minSlots);
+    page.print(", set with <i>DMX?min=n</i>).<br>");
+    page.print("Frame rate ");
+    page.print(DMXClock.pacedRate());
+    page.print(DMXClock.rate() == FRAME_RATE_AUTO ? "/s, following the frame length" : (DMXClock.rate() == FRAME_RATE_FREE ? "/s, running free" : "/s"));
+    page.print(" (set with <i>DMX?rate=n</i>, <i>auto</i> or <i>free</i>), ");
+    page.print(DMXClock.overruns());
+    page.print(" frames late. Break ");
+    page.print(universe.breakLength());
+    page.print(" us, mark after break ");
+    page.print(universe.mabLength());
+    page.print(" us (set with <i>DMX?break=us&mab=us</i>).<br>");
+    page.print("Fade a channel with <i>DMX?fade=address,value,ms</i>, optionally followed by <i>,in</i>, <i>,out</i> or <i>,smooth</i>. ");
+    page.print(universe.fader.active());
+    page.print(" channels fading.<br>");
+    page.print("Programs can write many channels at once with <i>POST /DMX?start=address</i>, the body holding the values (raw, or hex/base64 with <i>&encoding=hex</i> or <i>&encoding=base64</i>).<br>");
+    if (DMX_UNIVERSES > 1) {
+      page.print("Add <i>&universe=n</i> to any of these for another universe than the first.<br>");
+    }
+    printDMXDataTable(page, u);
+
+  } else if (resource.equalsIgnoreCase("INPUT")) { // DMX input page
+    if (DMX_UNIVERSES > 1) {
+      page.print("DMX input is off, its UART sends universe 2.<br>");
+    } else if (dmxinput.live()) {
+      page.print("Receiving ");
+      page.print(dmxinput.slots());
+      page.print(" slots at ");
+      page.print(dmxinput.framesPerSecond());
+      page.print(" frames/s, merged with the network in ");
+      page.print(dmxinput.mergeTime());
+      page.print(" us (worst ");
+      page.print(dmxinput.mergeTimeMax());
+      page.print(" us, <a href=\"INPUT?reset\">reset</a>).<br>");
+    } else {
+      page.print("No DMX input signal.<br>");
+    }
+    page.print(dmxinput.frames());
+    page.print(" frames received, ");
+    page.print(dmxinput.errors());
+    page.print(" bad ones.<br>");
+    page.print("Set the merge with <i>INPUT?merge=htp</i> or <i>INPUT?merge=ltp</i> for all channels, <i>INPUT?merge=address,ltp</i> for one.<br>");
+    printDMXInputTable(page);
+
+  } else if (resource.equalsIgnoreCase("CURVE")) { // Response curve page
+    int u = selectUniverse(query);
+    ResponseCurves & curves = universes[u].curves;
+    printUniverseLinks(page, "CURVE", u);
+    page.print("Define a curve with <i>CURVE?define=n&gamma=2.2</i> or <i>CURVE?define=n&points=in:out,in:out,...</i> (n from 1 to ");
+    page.print(CURVE_MAX - 1);
+    page.print(", curve 0 is straight), optionally with <i>&min=value&max=value</i> to limit the output. ");
+    page.print("Give channels a curve with <i>CURVE?assign=address,n</i> or <i>CURVE?assign=first-last,n</i>.<br>");
+    page.print(curves.assigned());
+    page.print(" channels have a curve, applied in ");
+    page.print(DMXTransformMetric.last());
+    page.print(" us per frame (worst ");
+    page.print(DMXTransformMetric.peak());
+    page.print(" us).<br>");
+    printCurveTable(page, curves);
+
+  } else if (resource.equalsIgnoreCase("PATCH")) { // Patch page
+    int u = selectUniverse(query);
+    PatchTable & patch = universes[u].patch;
+    printUniverseLinks(page, "PATCH", u);
+    page.print("Patch a channel (0 to ");
+    page.print(PATCH_CHANNELS - 1);
+    page.print(") with <i>PATCH?add=channel,address</i>, or <i>PATCH?add=channel,address,16</i> for 16 bit (fine at address + 1). Add it again to drive more fixtures, unpatch with <i>PATCH?remove=channel</i>.<br>");
+    page.print("Set a channel with <i>PATCH?set=channel,value</i> or fade it with <i>PATCH?fade=channel,value,ms</i>, values 0 to 65535. Patched addresses follow their channel, whatever else sends to them.<br>");
+    page.print(patch.entries());
+    page.print(" of ");
+    page.print(PATCH_MAX);
+    page.print(" patch entries used.<br>");
+    printPatchTable(page, patch);
+
+  } else if (resource.equalsIgnoreCase("SCENE")) { // Scene page
+    page.print("Save the first universe with <i>SCENE?save=name</i>, recall with <i>SCENE?recall=name</i> (add <i>&time=ms</i> to crossfade), delete with <i>SCENE?delete=name</i>.<br>");
+    page.print(scenes.count());
+    page.print(" of ");
+    page.print(SCENE_MAX);
+    page.print(" scenes stored, last one used: <i>");
+    page.print(scenes.last());
+    page.print("</i>.<br>");
+    printSceneTable(page);
 
   } else { // Default page
 
   }
+  page.end();
+  HTTPBytesMetric.record(page.bytesSent());
 
+  LOG_DEBUG("Response: %u bytes, first byte after %lu us. Free heap: %u (lowest ever %u).", (unsigned) page.bytesSent(), (unsigned long) page.firstByteTime(), (unsigned) ESP.getFreeHeap(), (unsigned) ESP.getMinFreeHeap());
 }
-void ADCTaskFunc (void * p) {
-  Serial.println("ADC Task is running");
-  //Serial.print("Running on core: ");
-  //Serial.println(xPortGetCoreID());
-
-  unsigned long currentMillis = millis();
-  unsigned long prevMillis = currentMillis;
-  const unsigned long interval = 1000; 
-  int vbatval = 0;
-  int ADCArrayNext = 0;
-
-  for(int i = 0; i < ADCArraySize; i++) {
-    ADCArray[i] = 0;
+void sendTextResponse(WiFiClient & client, const char * type, void (*body)(Print & out), bool chunked, bool keepalive) { // Response without the HTML page around it, body() prints the content
+  client.println("HTTP/1.1 200 OK");
+  client.print("Content-type:");
+  client.println(type);
+  if (chunked) {
+    client.println("Transfer-Encoding: chunked");
   }
+  client.println(keepalive ? "Connection: keep-alive" : "Connection: close");
+  client.println();
 
+  ChunkedPrint page(client, chunked);
+  body(page);
+  page.end();
+  HTTPBytesMetric.record(page.bytesSent()); // For a metrics scrape, this shows up in the next one
+}
+void ADCTaskFunc (void * p) {
+  LOG_INFO("ADC Task is running");
+  if (!voltages.begin()) {
+    LOG_ERROR("ADC continuous mode failed, no voltage monitor");
+    ADCTask = NULL; // Keeps it out of the metrics
+    vTaskDelete(NULL);
+  }
+  while(true) {
+    voltages.receive(portMAX_DELAY); // The ADC wakes us when it has readings, nothing to do in between
+  }
+}
+void HTTPTaskFunc (void * p) {
+  LOG_INFO("HTTP Task is running");
+  unsigned long lastpush = millis();
+  while(true) {
+    server.poll(); // Never waits for a client, so a slow one doesn't hold up the others
+    if (millis() - lastpush >= WS_PUSH_INTERVAL) {
+      pushWebSockets();
+      lastpush = millis();
+    }
+    vTaskDelay(1);
+  }
+}
+// WebSocket protocol, binary messages only. Addresses are 0-511 like set=, big endian:
+//   0x01 addr_hi addr_lo value [addr_hi addr_lo value ...]   Set one or more channels
+//   0x02 start_hi start_lo value value ...                   Set consecutive channels from start, up to a whole universe
+// Like set=, both stop fades on the channels they write.
+// The bridge sends 0x02 messages to every client: the whole universe when it connects, then only the changed range,
+// at most every WS_PUSH_INTERVAL. A client that hasn't taken the last message yet is skipped, and gets everything that changed in the meantime in one go later.
+void handleWebSocketMessage(int slot, const uint8_t * message, size_t length) {
+  if (message == NULL) { // New client
+    WSFullUpdate[slot] = true;
+    return;
+  }
+  if (length < 3) {
+    return;
+  }
+  DMXFrameBuffer & DMXbuffer = universes[0].buffer; // WebSockets only see the first universe
+  FadeEngine & fader = universes[0].fader;
+  byte * DMXArray = DMXbuffer.beginWrite(100);
+  if (DMXArray == NULL) {
+    return;
+  }
+  uint32_t cancels[DMXArraySize / 32] = {}; // Fades to stop once the frame is out, see cancelFades()
+  if (message[0] == 0x01) {
+    for (size_t i = 1; i + 3 <= length; i += 3) {
+      int address = (message[i] << 8) | message[i + 1];
+      if (address < DMXArraySize) {
+        DMXArray[address] = message[i + 2];
+        DMXbuffer.markDirty(address, 1);
+        if (fader.fading(address)) cancels[address >> 5] |= 1UL << (address & 31); // Like set=, a snap
+      }
+    }
+  } else if (message[0] == 0x02) {
+    int start = (message[1] << 8) | message[2];
+    int count = min((int) length - 3, DMXArraySize - start);
+    if (count > 0) {
+      memcpy(&DMXArray[start], &message[3], count);
+      DMXbuffer.markDirty(start, count);
+      for (int i = start; i < start + count; i++) {
+        if (fader.fading(i)) cancels[i >> 5] |= 1UL << (i & 31);
+      }
+    }
+  }
+  DMXbuffer.endWrite();
+  cancelFades(fader, cancels);
+}
+void pushWebSockets() { // Tell each WebSocket client what changed since we last told it
+  const byte * DMXArray = universes[0].buffer.current();
+  for (int slot = 0; slot < HTTP_MAX_CONNECTIONS; slot++) {
+    if (!server.webSocketWritable(slot)) { // Not a WebSocket, or still busy with the last message - its changes pile up in the meantime
+      continue;
+    }
+    int first = 0;
+    int last = DMXArraySize;
+    if (!WSFullUpdate[slot]) {
+      while (first < DMXArraySize && WSSnapshot[slot][first] == DMXArray[first]) first++;
+      while (last > first && WSSnapshot[slot][last - 1] == DMXArray[last - 1]) last--;
+      if (first == last) { // Nothing new
+        continue;
+      }
+    }
+    WSMessage[0] = 0x02;
+    WSMessage[1] = first >> 8;
+    WSMessage[2] = first & 0xff;
+    memcpy(&WSMessage[3], &DMXArray[first], last - first);
+    if (server.webSocketSend(slot, WSMessage, 3 + last - first)) {
+      memcpy(&WSSnapshot[slot][first], &WSMessage[3], last - first); // What we sent, not what DMXArray holds now - it may have changed while copying
+      WSFullUpdate[slot] = false;
+    }
+  }
+}
+void ArtNetTaskFunc (void * p) {
+  LOG_INFO("Art-Net Task is running");
+  artnet.setPorts(DMX_UNIVERSES); // One output per universe, on consecutive Port-Addresses
+  artnet.begin(ESP_DEVICE_NAME, ESP_MODEL_NAME " " ESP_DEVICE_NAME);
   while(true) {
-    currentMillis = millis();
-    if (currentMillis - prevMillis >= interval) {
-      //Serial.println("Doing a new ADC measurement");
-      // Read battery voltage and convert to actual mV (50/50 voltage divider)
-      vbatval = analogReadMilliVolts(VBAT) << 1;
-
-      // Store it in the next location of the storage array
-      ADCArray[ADCArrayNext] = vbatval;
-      ADCArrayNext++;
-      if (ADCArrayNext > ADCArraySize) {
-        ADCArrayNext = 0;
+    if (artnet.receive() > 0) { // An ArtDmx for one of our universes is waiting
+      DMXFrameBuffer & DMXbuffer = universes[artnet.port()].buffer;
+      byte * DMXArray = DMXbuffer.beginWrite(50);
+      if (DMXArray != NULL) {
+        DMXbuffer.markDirty(0, artnet.readDMX(DMXArray, DMXArraySize)); // Straight from the UDP buffer into the frame
+        DMXbuffer.endWrite();
       }
-
-      // Calculate average
-      int sum = 0;
-      for (int i = 0; i < ADCArraySize; i++) {
-        sum += ADCArray[i];
+    } else {
+      vTaskDelay(1); // Nothing for us, give the rest of the system a go. Go straight back for more if we did get something, packets may be queued up
+    }
+  }
+}
+void E131TaskFunc (void * p) {
+  LOG_INFO("sACN Task is running");
+  e131.begin();
+  while(true) {
+    bool changed = false;
+    for (int i = 0; i < E131_MAX_SOURCES; i++) { // Up to one packet per source per tick, more than enough for 44 Hz streams
+      changed |= e131.receive();
+    }
+    changed |= e131.expire();
+    if (changed) { // Merge once for everything that came in, so the cost per frame stays fixed however many consoles are talking
+      DMXFrameBuffer & DMXbuffer = universes[0].buffer; // sACN feeds the first universe only
+      byte * DMXArray = DMXbuffer.beginWrite(50);
+      if (DMXArray != NULL) {
+        int length = e131.merge(DMXArray); // Rewrites all 512 slots, so a source that got shorter or went away changed slots past the new length as well
+        if (length > 0) {
+          DMXbuffer.markDirty(0, max(length, DMXbuffer.slotsUsed())); // Only slots whose value really changed get published
+        }
+        DMXbuffer.endWrite();
       }
-      ADCAverage = sum / ADCArraySize;
-
-      prevMillis = currentMillis;
     }
-
     vTaskDelay(1);
   }
-  
 }
-void LEDTaskFunc (void * p) {
-  Serial.println("LED Task is running");
+void DMXInputTaskFunc (void * p) {
+  LOG_INFO("DMX Input Task is running");
   while(true) {
-    leds.tick();
-    vTaskDelay(1);
+    dmxinput.receive(DMX_TIMEOUT_TICK); // Blocks until a frame arrives, or the line has been quiet for a while
   }
-  
 }
 void DMXTaskFunc (void * p ) {
-  //unsigned long lastrun = millis();
-  Serial.println("DMX Task is running");
+  LOG_INFO("DMX Task is running");
+  DMXClock.begin(xTaskGetCurrentTaskHandle(), DMX_FRAME_RATE);
   while(true) {
-    if(DMXupdate == dmxsemaphore_t::updated) {
-      //Serial.println("DMXTask found semaphore set to Updated. Will now copy memory.");
-      memcpy(&DMXdata[1], DMXArray, DMXArraySize); // Copy to DMXdata + 1, because DMXdata[0] contains magic
-      dmx_write(dmxPort, DMXdata, DMX_PACKET_SIZE);
-      DMXupdate = dmxsemaphore_t::free; // Unset semaphore
-      //Serial.println("DMXTask set semaphore back to Free.");
-    }
-    //Serial.println("DMX Task: Sending packet.");
-    dmx_send_num(dmxPort, DMX_PACKET_SIZE);
-    //Serial.println("DMX Task: Packet sent to driver.");
-    dmx_wait_sent(dmxPort, DMX_TIMEOUT_TICK);
-    //Serial.println("DMX Task: Driver reports packet sent.");
-    vTaskDelay(1);
-    //while (millis() - lastrun < 1000) {
-    //  NOP();
-    //}
-    //lastrun = millis();
-    //Serial.print("-");
+    for (int u = 0; u < DMX_UNIVERSES; u++) { // Frames for every universe are ready before the tick, so they go out right on it
+      universes[u].prepare(u == 0 && DMX_UNIVERSES == 1 ? &dmxinput : NULL, DMXTransformMetric); // Only a lone universe has the input, see DMX_UNIVERSES
+    }
+    uint32_t frame_us = 0;
+    for (auto& u : universes) { // They go out side by side, the longest one sets the pace
+      frame_us = max(frame_us, u.frameTime());
+    }
+    DMXClock.fit(frame_us);
+    DMXIntervalMetric.record(DMXClock.wait());
+    DMXJitterMetric.record(DMXClock.jitter());
+    unsigned long start = micros();
+    for (auto& u : universes) { // Each UART does its own break, MAB and slots, so the ports transmit side by side
+      u.send();
+    }
+    for (auto& u : universes) {
+      u.wait();
+    }
+    DMXSendMetric.record(micros() - start);
   }
-}
\ No newline at end of file
+}
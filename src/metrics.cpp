@@ -0,0 +1,120 @@
+//metrics.cpp
+// Counters for the hot paths, printed in the Prometheus text format.
+// Usage:
+//      - Create a MetricTiming per thing to measure, with an array of bucket bounds if you want a histogram as well
+//      - record() a value (usually a time in us) each time it happens. Only ever from one task, record() is not safe against itself
+//      - Any task: print() writes it out as a summary (_count and _sum, plus _max and _last gauges), or a histogram if it has buckets. printValue() does a single counter or gauge
+// No locks: record() is a handful of relaxed stores bracketed by a sequence number, print() simply retries if it caught the writer halfway.
+// That keeps it cheap enough to leave on in the DMX task, and the DMX task never waits for someone reading the metrics.
+
+#include "metrics.h"
+
+MetricTiming::MetricTiming() : MetricTiming(NULL, 0) {}
+
+MetricTiming::MetricTiming(const uint32_t * bounds, int buckets) : bounds(bounds) {
+    bucket_count = min(buckets, METRIC_MAX_BUCKETS);
+    seq = 0;
+    count = 0;
+    sum_low = 0;
+    sum_high = 0;
+    maximum = 0;
+    latest = 0;
+    for (auto& b : this->buckets) {
+        b = 0;
+    }
+}
+
+void MetricTiming::record(uint32_t value) { // Writer only
+    uint32_t s = seq.load(std::memory_order_relaxed);
+    seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    uint32_t low = sum_low.load(std::memory_order_relaxed);
+    sum_low.store(low + value, std::memory_order_relaxed);
+    if (low + value < low) { // Carry
+        sum_high.store(sum_high.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    if (value > maximum.load(std::memory_order_relaxed)) {
+        maximum.store(value, std::memory_order_relaxed);
+    }
+    latest.store(value, std::memory_order_relaxed);
+    for (int i = 0; i < bucket_count; i++) { // Only the bucket it falls in, print() adds them up
+        if (value <= bounds[i]) {
+            buckets[i].store(buckets[i].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            break;
+        }
+    }
+    seq.store(s + 2, std::memory_order_release);
+}
+
+uint32_t MetricTiming::last() {
+    return latest.load(std::memory_order_relaxed);
+}
+
+uint32_t MetricTiming::peak() {
+    return maximum.load(std::memory_order_relaxed);
+}
+
+void MetricTiming::printHeader(Print & out, const char * name, const char * type, const char * help) {
+    out.print("# HELP ");
+    out.print(name);
+    out.print(' ');
+    out.println(help);
+    out.print("# TYPE ");
+    out.print(name);
+    out.print(' ');
+    out.println(type);
+}
+
+void MetricTiming::printValue(Print & out, const char * name, const char * type, const char * help, int64_t value) { // A single counter or gauge
+    printHeader(out, name, type, help);
+    out.print(name);
+    out.print(' ');
+    out.println(value);
+}
+
+void MetricTiming::print(Print & out, const char * name, const char * help) {
+    uint32_t n, high, low, top, now;
+    uint32_t snapshot[METRIC_MAX_BUCKETS];
+    uint32_t s;
+    do { // Take a consistent copy, retrying if record() ran in the meantime
+        s = seq.load(std::memory_order_acquire);
+        n = count.load(std::memory_order_relaxed);
+        low = sum_low.load(std::memory_order_relaxed);
+        high = sum_high.load(std::memory_order_relaxed);
+        top = maximum.load(std::memory_order_relaxed);
+        now = latest.load(std::memory_order_relaxed);
+        for (int i = 0; i < bucket_count; i++) {
+            snapshot[i] = buckets[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((s & 1) || s != seq.load(std::memory_order_relaxed));
+
+    printHeader(out, name, bucket_count > 0 ? "histogram" : "summary", help);
+    uint32_t total = 0;
+    for (int i = 0; i < bucket_count; i++) {
+        total += snapshot[i];
+        out.print(name);
+        out.print("_bucket{le=\"");
+        out.print(bounds[i]);
+        out.print("\"} ");
+        out.println(total);
+    }
+    if (bucket_count > 0) {
+        out.print(name);
+        out.print("_bucket{le=\"+Inf\"} ");
+        out.println(n);
+    }
+    out.print(name);
+    out.print("_sum ");
+    out.println(((uint64_t) high << 32) | low);
+    out.print(name);
+    out.print("_count ");
+    out.println(n);
+    // Worst case and latest as gauges of their own, a summary or histogram has no place for them
+    char gauge[64];
+    snprintf(gauge, sizeof(gauge), "%s_max", name);
+    printValue(out, gauge, "gauge", "Largest value since boot", top);
+    snprintf(gauge, sizeof(gauge), "%s_last", name);
+    printValue(out, gauge, "gauge", "Latest value", now);
+}
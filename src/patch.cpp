@@ -0,0 +1,176 @@
+//patch.cpp
+// Patch: logical channels (fixture attributes) mapped onto DMX slots, with 16 bit values so moving heads fade smoothly.
+// Usage:
+//      - Create with the NVS namespace to use (one per universe), call begin() once in setup(), it reads the patch from NVS (flash)
+//      - HTTP task: add() patches a channel to an address as 8 or 16 bit (coarse and fine slot), more than once to drive several fixtures from one channel. remove() unpatches a channel. Both are stored right away
+//      - Any task: set() snaps or fades a channel to a 16 bit value (8 bit addresses get the top byte)
+//      - DMX task, every frame: apply() after the fades, writing every patched slot of the output frame. Patched slots follow their channel, whatever the network sends for them
+// Changes to the patch are resolved once into a flat table sorted by slot. The DMX task switches to a new table between frames, so per frame it's one linear pass with no lookups.
+
+#include "patch.h"
+
+PatchTable::PatchTable() : PatchTable("patch") {}
+
+PatchTable::PatchTable(const char * name) {
+    prefs_name = name;
+    count = 0;
+    queue = NULL;
+    resolved[0].count = resolved[1].count = 0;
+    resolved[0].slots = resolved[1].slots = 0;
+    active.store(0, std::memory_order_relaxed);
+    pending.store(-1, std::memory_order_relaxed);
+    slot_count.store(0, std::memory_order_relaxed);
+    for (int i = 0; i < PATCH_CHANNELS; i++) {
+        levels[i] = 0;
+        targets[i] = 0;
+        fades[i].duration = 0;
+    }
+}
+
+void PatchTable::begin() {
+    queue = xQueueCreate(PATCH_QUEUE_SIZE, sizeof(command_t));
+    prefs.begin(prefs_name, false);
+    size_t size = prefs.getBytesLength("table");
+    if (size % sizeof(entry_t) == 0 && size <= sizeof(table)) {
+        prefs.getBytes("table", table, size);
+        count = size / sizeof(entry_t);
+    }
+    int n = 0;
+    for (int i = 0; i < count; i++) { // Don't trust flash blindly
+        entry_t& e = table[i];
+        if (e.channel < PATCH_CHANNELS && (e.width == 1 || e.width == 2) && e.address + e.width <= DMXArraySize)
+            table[n++] = e;
+    }
+    count = n;
+    resolve();
+    active.store(pending.exchange(-1), std::memory_order_relaxed); // The DMX task isn't running yet, take the table straight away
+}
+
+bool PatchTable::resolve() { // Build the flat table from the patch and hand it to the DMX task. Returns false if the DMX task hasn't picked up the last one in time
+    for (int wait = 0; pending.load(std::memory_order_acquire) >= 0; wait++) { // The spare table is only free once the DMX task has switched
+        if (wait == 100) return false;
+        vTaskDelay(1);
+    }
+    resolved_t& r = resolved[1 - active.load(std::memory_order_relaxed)]; // Not the one in use
+    r.count = 0;
+    r.slots = 0;
+    for (int i = 0; i < count; i++) { // Insertion sort by slot, it's small and only runs when the patch changes
+        map_t m = {(uint16_t) (table[i].address + 1), table[i].channel, table[i].width};
+        int j = r.count++;
+        while (j > 0 && r.map[j - 1].slot > m.slot) {
+            r.map[j] = r.map[j - 1];
+            j--;
+        }
+        r.map[j] = m;
+        r.slots = max(r.slots, (int) (table[i].address + table[i].width));
+    }
+    slot_count.store(r.slots, std::memory_order_relaxed);
+    pending.store(&r - resolved, std::memory_order_release);
+    return true;
+}
+
+void PatchTable::store() {
+    if (count > 0) {
+        prefs.putBytes("table", table, count * sizeof(entry_t));
+    } else {
+        prefs.remove("table");
+    }
+}
+
+bool PatchTable::add(int channel, int address, int width) { // Patch channel to address (both 0 based), width 1 or 2 slots. Returns false if it's invalid, overlaps another entry or the table is full
+    if (channel < 0 || channel >= PATCH_CHANNELS || (width != 1 && width != 2) || address < 0 || address + width > DMXArraySize || count == PATCH_MAX) {
+        return false;
+    }
+    for (int i = 0; i < count; i++) { // One slot, one channel
+        if (address < table[i].address + table[i].width && table[i].address < address + width)
+            return false;
+    }
+    table[count++] = {(uint8_t) channel, (uint8_t) width, (uint16_t) address};
+    store();
+    return resolve();
+}
+
+bool PatchTable::remove(int channel) { // Unpatch every entry of channel. Its slots keep their last value until something else writes them
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        if (table[i].channel != channel)
+            table[n++] = table[i];
+    }
+    if (n == count) {
+        return false;
+    }
+    count = n;
+    store();
+    return resolve();
+}
+
+int PatchTable::entries() {
+    return count;
+}
+
+const PatchTable::entry_t & PatchTable::entry(int i) {
+    return table[i];
+}
+
+bool PatchTable::set(int channel, uint16_t value, unsigned long duration) { // Queue channel going to value, over duration ms (0 snaps). Returns false if it couldn't be queued
+    if (channel < 0 || channel >= PATCH_CHANNELS) {
+        return false;
+    }
+    command_t c = {(uint8_t) channel, value, (uint32_t) duration};
+    if (xQueueSend(queue, &c, 10) != pdTRUE) {
+        return false;
+    }
+    targets[channel] = value;
+    return true;
+}
+
+uint16_t PatchTable::level(int channel) { // Value the channel was last set to (or is fading to)
+    return targets[channel];
+}
+
+int PatchTable::slots() { // Frame length the patch needs
+    return slot_count.load(std::memory_order_relaxed);
+}
+
+void PatchTable::apply(uint8_t * output, unsigned long now) { // DMX task: update levels and write all patched slots of output (start code at 0)
+    int8_t p = pending.load(std::memory_order_acquire);
+    if (p >= 0) { // New patch, switch before touching anything. Only once active points at it is the other table free to be rebuilt
+        active.store(p, std::memory_order_relaxed);
+        pending.store(-1, std::memory_order_release);
+    }
+    command_t c;
+    while (xQueueReceive(queue, &c, 0) == pdTRUE) {
+        fade_t& f = fades[c.channel];
+        f.start = levels[c.channel]; // From wherever it is now, even halfway through another fade
+        f.target = c.target;
+        f.start_time = now;
+        f.duration = c.duration;
+        f.rate = c.duration > 1 ? 0xffffffffUL / c.duration : 0xffffffffUL;
+        if (c.duration == 0) {
+            levels[c.channel] = c.target;
+        }
+    }
+    for (int i = 0; i < PATCH_CHANNELS; i++) {
+        fade_t& f = fades[i];
+        if (f.duration == 0) {
+            continue;
+        }
+        uint32_t elapsed = now - f.start_time;
+        if (elapsed >= f.duration) {
+            levels[i] = f.target;
+            f.duration = 0;
+        } else {
+            uint32_t progress = ((uint64_t) elapsed * f.rate) >> 16; // 0-65535
+            levels[i] = f.start + ((((int32_t) f.target - f.start) * (int64_t) progress) >> 16);
+        }
+    }
+    const resolved_t& r = resolved[active.load(std::memory_order_relaxed)];
+    for (int i = 0; i < r.count; i++) { // The hot part, front to back through the frame
+        const map_t& m = r.map[i];
+        uint16_t v = levels[m.channel];
+        output[m.slot] = v >> 8;
+        if (m.width == 2) {
+            output[m.slot + 1] = v & 0xff;
+        }
+    }
+}
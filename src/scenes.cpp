@@ -0,0 +1,192 @@
+//scenes.cpp
+// Named DMX scenes, stored in NVS (flash).
+// Usage:
+//      - Call begin() once in setup(). It reads the scene index into RAM, all lookups use that
+//      - save() stores a universe under a name (1-15 characters: letters, digits, - and _), replacing any scene already called that
+//      - load() decodes a scene into a 512 slot frame, remove() deletes one. last() is the name of the scene saved or loaded last, for recalling at boot.
+//        Pass remember = false to load() for a scene that is only kept at hand, not put on stage
+// Scenes are stored sparse: only runs of non-zero slots, each as start and length (2 bytes each, big endian) followed by the values.
+// Zero gaps shorter than a run header are kept inside the run, so even the worst case is never bigger than the whole universe plus a few bytes.
+
+#include "scenes.h"
+
+SceneStore::SceneStore() {
+    memset(names, 0, sizeof(names));
+    memset(sizes, 0, sizeof(sizes));
+    last_name[0] = '\0';
+}
+
+void SceneStore::begin() {
+    prefs.begin("scenes", false);
+    if (prefs.getBytesLength("index") == sizeof(names)) {
+        prefs.getBytes("index", names, sizeof(names));
+    }
+    char key[12];
+    for (int i = 0; i < SCENE_MAX; i++) {
+        names[i][SCENE_NAME_SIZE - 1] = '\0'; // Don't trust flash blindly
+        if (names[i][0] != '\0') {
+            snprintf(key, sizeof(key), "s%d", i);
+            sizes[i] = prefs.getBytesLength(key);
+        }
+    }
+    prefs.getString("last", last_name, SCENE_NAME_SIZE);
+}
+
+bool SceneStore::validName(const char * name, size_t length) { // 1-15 characters, letters, digits, - and _ only. Keeps names safe to put in links and pages
+    if (length == 0 || length >= SCENE_NAME_SIZE) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (!isalnum(name[i]) && name[i] != '-' && name[i] != '_')
+            return false;
+    }
+    return true;
+}
+
+int SceneStore::find(const char * name, size_t length) { // Index of the named scene, -1 if there is none
+    for (int i = 0; i < SCENE_MAX; i++) {
+        if (strlen(names[i]) == length && strncmp(names[i], name, length) == 0)
+            return i;
+    }
+    return -1;
+}
+
+int SceneStore::count() { // Number of stored scenes
+    int n = 0;
+    for (auto& s : names) {
+        if (s[0] != '\0') n++;
+    }
+    return n;
+}
+
+const char * SceneStore::name(int i) { // Name of the scene at index i (0 to SCENE_MAX - 1), empty if that spot is free
+    return names[i];
+}
+
+int SceneStore::size(int i) { // Bytes of flash the scene at index i takes
+    return sizes[i];
+}
+
+const char * SceneStore::last() {
+    return last_name;
+}
+
+void SceneStore::setLast(const char * name) {
+    if (strcmp(last_name, name) != 0) { // Spare the flash if nothing changed
+        strncpy(last_name, name, SCENE_NAME_SIZE - 1);
+        last_name[SCENE_NAME_SIZE - 1] = '\0';
+        prefs.putString("last", last_name);
+    }
+}
+
+size_t SceneStore::encode(const uint8_t * frame, uint8_t * out) { // Sparse encoding of a 512 slot frame, returns the size
+    size_t n = 0;
+    int i = 0;
+    while (i < DMXArraySize) {
+        if (frame[i] == 0) {
+            i++;
+            continue;
+        }
+        int start = i;
+        int end = i; // One past the last non-zero slot of the run
+        while (i < DMXArraySize) {
+            if (frame[i] != 0) {
+                end = i + 1;
+            } else if (i - end >= 3) { // 4 zeros in a row cost as much as starting a new run
+                break;
+            }
+            i++;
+        }
+        int length = end - start;
+        out[n++] = start >> 8;
+        out[n++] = start & 0xff;
+        out[n++] = length >> 8;
+        out[n++] = length & 0xff;
+        memcpy(&out[n], &frame[start], length);
+        n += length;
+        i = end;
+    }
+    return n;
+}
+
+int SceneStore::decode(const uint8_t * in, size_t size, uint8_t * frame) { // Unpack into a 512 slot frame, everything not in the scene is 0. Returns the highest slot used + 1
+    memset(frame, 0, DMXArraySize);
+    int used = 0;
+    size_t n = 0;
+    while (n + 4 <= size) {
+        int start = (in[n] << 8) | in[n + 1];
+        int length = (in[n + 2] << 8) | in[n + 3];
+        n += 4;
+        if (start + length > DMXArraySize || n + length > size) { // Corrupt, keep what we have
+            break;
+        }
+        memcpy(&frame[start], &in[n], length);
+        n += length;
+        used = max(used, start + length);
+    }
+    return used;
+}
+
+bool SceneStore::save(const char * name, size_t length, const uint8_t * frame) { // Store frame (512 slots) as the named scene. Returns false if the name is invalid, the store is full or flash write failed
+    if (!validName(name, length)) {
+        return false;
+    }
+    int i = find(name, length);
+    if (i < 0) { // New one, find a free spot
+        i = find("", 0);
+        if (i < 0) {
+            return false;
+        }
+    }
+    char key[12];
+    snprintf(key, sizeof(key), "s%d", i);
+    size_t n = encode(frame, blob);
+    if (n == 0) { // All zeros. NVS doesn't like empty blobs, a single zero slot does the same job
+        blob[0] = blob[1] = blob[2] = 0;
+        blob[3] = 1;
+        blob[4] = 0;
+        n = 5;
+    }
+    if (prefs.putBytes(key, blob, n) != n) {
+        return false;
+    }
+    sizes[i] = n;
+    if (names[i][0] == '\0') { // Index only needs writing for new scenes
+        memcpy(names[i], name, length);
+        names[i][length] = '\0';
+        prefs.putBytes("index", names, sizeof(names));
+    }
+    setLast(names[i]);
+    return true;
+}
+
+int SceneStore::load(const char * name, size_t length, uint8_t * frame, bool remember) { // Decode the named scene into frame (512 slots). Returns the highest slot used + 1, or -1 if there's no such scene. remember makes it last()
+    int i = find(name, length);
+    if (length == 0 || i < 0) {
+        return -1;
+    }
+    char key[12];
+    snprintf(key, sizeof(key), "s%d", i);
+    size_t n = prefs.getBytes(key, blob, SCENE_BLOB_SIZE);
+    if (remember) {
+        setLast(names[i]);
+    }
+    return decode(blob, n, frame);
+}
+
+bool SceneStore::remove(const char * name, size_t length) {
+    int i = find(name, length);
+    if (length == 0 || i < 0) {
+        return false;
+    }
+    char key[12];
+    snprintf(key, sizeof(key), "s%d", i);
+    prefs.remove(key);
+    if (strcmp(last_name, names[i]) == 0) {
+        setLast("");
+    }
+    names[i][0] = '\0';
+    sizes[i] = 0;
+    prefs.putBytes("index", names, sizeof(names));
+    return true;
+}
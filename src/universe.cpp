@@ -0,0 +1,130 @@
+//universe.cpp
+// One DMX output: its frame buffer, fades, patch and response curves, and the UART driving it.
+// Usage:
+//      - Create one per output port, with the pins of its transceiver and NVS names for its curves and patch. Call begin() once in setup()
+//      - setTiming() changes the break and mark after break, for fixtures that are picky about them. Any task, it takes effect from the next frame
+//      - Producers write through buffer, fades go through fader, and so on - see the classes of the parts
+//      - DMX task, every frame: prepare() every universe first, then send() all of them, then wait() for all of them.
+//        The ports run side by side - each one's break, MAB and slots are timed by its own UART, so a second universe costs the task no more time than one
+// Only one universe can be merged with the DMX input, pass NULL to prepare() for the others.
+
+#include "universe.h"
+
+DMXUniverse::DMXUniverse(dmx_port_t port, int tx_pin, int enable_pin, const char * curves_name, const char * patch_name) : curves(curves_name), patch(patch_name) {
+    dmx_port = port;
+    this->tx_pin = tx_pin;
+    this->enable_pin = enable_pin;
+    break_len = DMX_BREAK_DEFAULT;
+    mab_len = DMX_MAB_DEFAULT;
+    minSlots = DMX_MIN_SLOTS;
+    memset(output, 0, sizeof(output));
+    memset(merge_frame, 0, sizeof(merge_frame));
+    input_slots = 0;
+    frame_slots = 0;
+    frames_per_second = 0;
+    frames = 0;
+    fps_start = 0;
+    handoff_time = 0;
+}
+
+void DMXUniverse::begin() {
+    buffer.begin();
+    fader.begin();
+    curves.begin();
+    patch.begin();
+    dmx_config_t config = DMX_CONFIG_DEFAULT;
+    dmx_driver_install(dmx_port, &config, NULL, 0);
+    dmx_set_pin(dmx_port, tx_pin, DMX_PIN_NO_CHANGE, enable_pin); // Output only, receiving is the input port's job
+    dmx_set_break_len(dmx_port, break_len);
+    dmx_set_mab_len(dmx_port, mab_len);
+    fps_start = millis();
+}
+
+void DMXUniverse::prepare(DMXInput * input, MetricTiming & transform) { // DMX task: build the next frame and hand it to the driver
+    int first, last;
+    const uint8_t * data = buffer.acquire(first, last); // Newest complete frame, and the slots that changed since last time
+    if (last > first) {
+        handoff_time = micros();
+    }
+    fader.update(output); // Start new fades from what is going out now, before the frame with their targets is written
+    if (input != NULL && input->live()) { // Merge with the input every frame, either side may have changed anything
+        input_slots = input->merge(data, buffer.slotsUsed(), merge_frame);
+        memcpy(&output[1], &merge_frame[1], input_slots);
+        data = merge_frame;
+    } else {
+        if (input_slots > 0) { // Input just went away, the network frame gets everything back
+            first = 0;
+            last = max(input_slots, buffer.slotsUsed());
+            input_slots = 0;
+        }
+        if (last > first) {
+            memcpy(&output[first + 1], &data[first + 1], last - first); // Only the changed slots are copied. + 1, because data[0] contains magic
+        }
+    }
+    unsigned long now = millis();
+    fader.apply(output, data, now); // Fading channels get their value for this frame on top
+    patch.apply(output, now); // Patched slots follow their logical channels, over everything else
+    // Frames only need to be as long as the highest slot anyone uses - shorter frames mean a higher refresh rate
+    int slots = max(max(max(buffer.slotsUsed(), input_slots), patch.slots()), minSlots);
+    frame_slots = slots;
+    unsigned long start = micros();
+    dmx_write_offset(dmx_port, 1, &curves.apply(output, slots)[1], slots); // Response curves on the way to the driver, one table lookup per slot
+    transform.record(micros() - start);
+}
+
+void DMXUniverse::send() { // DMX task: start sending the prepared frame, returns right away
+    dmx_send_num(dmx_port, frame_slots + 1);
+}
+
+void DMXUniverse::wait() { // DMX task: wait for the frame to be out
+    dmx_wait_sent(dmx_port, DMX_TIMEOUT_TICK);
+    frames++;
+    unsigned long now = millis();
+    if (now - fps_start >= 1000) { // Frame rate, for the DMX page
+        frames_per_second = frames;
+        frames = 0;
+        fps_start += 1000;
+        if (now - fps_start >= 1000) { // Way behind, e.g. nothing was sent for a while
+            fps_start = now;
+        }
+    }
+}
+
+bool DMXUniverse::setTiming(int break_us, int mab_us) { // Both in us. Returns false, changing nothing, if either is out of range
+    if (break_us < DMX_BREAK_MIN || break_us > DMX_BREAK_MAX || mab_us < DMX_MAB_MIN || mab_us > DMX_MAB_MAX) {
+        return false;
+    }
+    break_len = break_us;
+    mab_len = mab_us;
+    dmx_set_break_len(dmx_port, break_us);
+    dmx_set_mab_len(dmx_port, mab_us);
+    return true;
+}
+
+int DMXUniverse::breakLength() {
+    return break_len;
+}
+
+int DMXUniverse::mabLength() {
+    return mab_len;
+}
+
+dmx_port_t DMXUniverse::port() {
+    return dmx_port;
+}
+
+int DMXUniverse::frameSlots() {
+    return frame_slots;
+}
+
+uint32_t DMXUniverse::frameTime() { // us the prepared frame takes on the wire, break to last slot
+    return break_len + mab_len + (frame_slots + 1) * DMX_SLOT_TIME;
+}
+
+int DMXUniverse::framesPerSecond() {
+    return frames_per_second;
+}
+
+unsigned long DMXUniverse::handoffTime() {
+    return handoff_time;
+}
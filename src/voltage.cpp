@@ -0,0 +1,174 @@
+//voltage.cpp
+// Battery (VBAT) and external supply (VEXT) monitor, on the ADC's continuous mode so the sampling and oversampling happen in hardware and DMA.
+// Usage:
+//      - Create object with the two ADC pins (ADC1 only, the WiFi driver owns ADC2). From the task that will run it, call begin() once, then receive() in a loop
+//      - receive() blocks until the driver has a new set of readings (VOLTAGE_OVERSAMPLE conversions averaged per channel), nothing polls in between
+//      - Every VOLTAGE_INTERVAL the readings are averaged into the history and the statistics: mean over the history, moving average (EWMA), minimum and maximum
+//      - setLow() sets a channel's threshold, onLow() the function called (from the monitor's task) when a channel drops below it. It triggers once, and again only after coming back VOLTAGE_HYSTERESIS above it
+//      - Any task can read the statistics
+// Every step is O(1): the history sum is updated as entries are replaced, rather than added up again each time.
+
+#include "voltage.h"
+
+VoltageMonitor * VoltageMonitor::instance = NULL;
+
+VoltageMonitor::VoltageMonitor(int vbat_pin, int vext_pin) {
+    pins[(int) channel_t::vbat] = vbat_pin;
+    pins[(int) channel_t::vext] = vext_pin;
+    for (auto& s : stats) {
+        memset(s.history, 0, sizeof(s.history));
+        s.history_sum = 0;
+        s.latest = 0;
+        s.ewma = 0;
+        s.minimum = 0;
+        s.maximum = 0;
+        s.low = 0;
+        s.below = false;
+        s.interval_sum = 0;
+        s.interval_count = 0;
+    }
+    next = 0;
+    used = 0;
+    interval_start = 0;
+    low_events = 0;
+    reset_range = false;
+    low_handler = NULL;
+    task = NULL;
+}
+
+bool VoltageMonitor::begin() { // Start converting. The calling task is the one woken by receive()
+    task = xTaskGetCurrentTaskHandle();
+    instance = this;
+    interval_start = millis();
+    if (!analogContinuous(pins, VOLTAGE_CHANNELS, VOLTAGE_OVERSAMPLE, VOLTAGE_SAMPLE_RATE, converted)) {
+        return false;
+    }
+    return analogContinuousStart();
+}
+
+void ARDUINO_ISR_ATTR VoltageMonitor::converted() { // Interrupt: the driver has averaged a new set of readings
+    BaseType_t woken = pdFALSE;
+    vTaskNotifyGiveFromISR(instance->task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+bool VoltageMonitor::receive(TickType_t wait) { // Wait for the next readings and take them in. Returns false if none came
+    if (ulTaskNotifyTake(pdTRUE, wait) == 0) {
+        return false;
+    }
+    adc_continuous_data_t * data = NULL;
+    if (!analogContinuousRead(&data, 0)) {
+        return false;
+    }
+    for (int i = 0; i < VOLTAGE_CHANNELS; i++) { // In the order the pins were given
+        int mv = scale(i, data[i].avg_read_mv);
+        stats[i].latest = mv;
+        stats[i].interval_sum += mv;
+        stats[i].interval_count++;
+    }
+    if (millis() - interval_start >= VOLTAGE_INTERVAL) {
+        interval_start += VOLTAGE_INTERVAL;
+        commit();
+    }
+    return true;
+}
+
+int VoltageMonitor::scale(int channel, int millivolts) { // From the pin to the supply, through the dividers on the Olimex board
+    if (channel == (int) channel_t::vbat) {
+        return millivolts << 1; // 50/50
+    }
+    return millivolts + (millivolts >> 1); // 2/3
+}
+
+void VoltageMonitor::commit() { // One history entry per channel from this interval's readings, statistics and thresholds follow
+    if (stats[0].interval_count == 0) {
+        return;
+    }
+    bool first = used == 0;
+    bool reset = reset_range;
+    reset_range = false;
+    for (int i = 0; i < VOLTAGE_CHANNELS; i++) {
+        stats_t& s = stats[i];
+        int mv = s.interval_sum / s.interval_count;
+        s.interval_sum = 0;
+        s.interval_count = 0;
+        if (used == VOLTAGE_HISTORY) { // The oldest entry makes way
+            s.history_sum -= s.history[next];
+        }
+        s.history[next] = mv;
+        s.history_sum += mv;
+        s.ewma = first ? mv * 16 : s.ewma + (mv * 16 - s.ewma) / (1 << VOLTAGE_EWMA_SHIFT);
+        if (first || reset || mv < s.minimum) s.minimum = mv;
+        if (first || reset || mv > s.maximum) s.maximum = mv;
+        if (s.low > 0 && !s.below && mv < s.low) {
+            s.below = true;
+            low_events++;
+            if (low_handler != NULL) {
+                low_handler((channel_t) i, mv);
+            }
+        } else if (s.below && (s.low == 0 || mv >= s.low + VOLTAGE_HYSTERESIS)) {
+            s.below = false;
+        }
+    }
+    next = next + 1 == VOLTAGE_HISTORY ? 0 : next + 1;
+    if (used < VOLTAGE_HISTORY) {
+        used = used + 1;
+    }
+}
+
+void VoltageMonitor::setLow(channel_t channel, int millivolts) { // 0 turns the threshold off
+    stats[(int) channel].low = millivolts;
+}
+
+int VoltageMonitor::low(channel_t channel) {
+    return stats[(int) channel].low;
+}
+
+void VoltageMonitor::onLow(void (*handler)(channel_t channel, int millivolts)) { // Set before begin()
+    low_handler = handler;
+}
+
+void VoltageMonitor::resetRange() { // Minimum and maximum start over from the next history entry
+    reset_range = true;
+}
+
+int VoltageMonitor::latest(channel_t channel) { // mV, last set of readings
+    return stats[(int) channel].latest;
+}
+
+int VoltageMonitor::mean(channel_t channel) { // mV, over the history
+    int n = used;
+    return n > 0 ? stats[(int) channel].history_sum / n : stats[(int) channel].latest;
+}
+
+int VoltageMonitor::average(channel_t channel) { // mV, moving average
+    return stats[(int) channel].ewma / 16;
+}
+
+int VoltageMonitor::minimum(channel_t channel) {
+    return stats[(int) channel].minimum;
+}
+
+int VoltageMonitor::maximum(channel_t channel) {
+    return stats[(int) channel].maximum;
+}
+
+int VoltageMonitor::history(channel_t channel, int age) { // mV, age 0 is the newest entry. 0 for entries not filled yet
+    if (age < 0 || age >= used) {
+        return 0;
+    }
+    int i = next - 1 - age;
+    return stats[(int) channel].history[i < 0 ? i + VOLTAGE_HISTORY : i];
+}
+
+int VoltageMonitor::historySize() { // Entries filled so far
+    return used;
+}
+
+uint32_t VoltageMonitor::lowEvents() { // Times a threshold was crossed since boot
+    return low_events;
+}
+
+const char * VoltageMonitor::name(channel_t channel) {
+    return channel == channel_t::vbat ? "vbat" : "vext";
+}
@@ -0,0 +1,226 @@
+//websocket.cpp
+// Server side of a WebSocket (RFC 6455) connection, after the HTTP upgrade handshake.
+// Usage:
+//      - acceptKey() turns the client's Sec-WebSocket-Key into the Sec-WebSocket-Accept value for the 101 response
+//      - feed() received bytes in. It stops as soon as a complete message is ready(), then read it with opcode()/message()/messageLength() and call next() before feeding the rest
+//      - Pings are answered and close frames replied to internally. Once closed() the connection should be dropped after a last flush()
+//      - send() queues a frame in a fixed buffer and returns false if there's no room, i.e. the client isn't keeping up. flush() writes what it can without waiting
+// Nothing is allocated, and nothing here ever waits for the client.
+
+#include "websocket.h"
+#include <mbedtls/version.h>
+#include <mbedtls/sha1.h>
+#include <mbedtls/base64.h>
+#include <lwip/sockets.h>
+
+static const char ws_guid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+bool WebSocket::acceptKey(StrView key, char * accept) { // accept = base64(sha1(key + GUID)), needs WS_ACCEPT_SIZE bytes. Returns false if the key is obviously bogus
+    if (key.length == 0 || key.length > 32) { // Keys are 16 bytes base64 encoded (24 characters)
+        return false;
+    }
+    uint8_t buf[32 + sizeof(ws_guid)];
+    memcpy(buf, key.data, key.length);
+    memcpy(&buf[key.length], ws_guid, sizeof(ws_guid) - 1);
+    uint8_t hash[20];
+#if MBEDTLS_VERSION_NUMBER >= 0x03000000
+    mbedtls_sha1(buf, key.length + sizeof(ws_guid) - 1, hash);
+#else
+    mbedtls_sha1_ret(buf, key.length + sizeof(ws_guid) - 1, hash);
+#endif
+    size_t n = 0;
+    return mbedtls_base64_encode((unsigned char *) accept, WS_ACCEPT_SIZE, &n, hash, sizeof(hash)) == 0;
+}
+
+WebSocket::WebSocket() {
+    reset();
+}
+
+void WebSocket::reset() { // Fresh connection
+    state = state_t::header;
+    header_used = 0;
+    in_used = 0;
+    message_op = opcode_t::continuation;
+    out_used = 0;
+    out_sent = 0;
+}
+
+bool WebSocket::ready() {
+    return state == state_t::ready;
+}
+
+bool WebSocket::closed() {
+    return state == state_t::closed;
+}
+
+WebSocket::opcode_t WebSocket::opcode() {
+    return message_op;
+}
+
+const uint8_t * WebSocket::message() {
+    return in;
+}
+
+size_t WebSocket::messageLength() {
+    return in_used;
+}
+
+void WebSocket::next() { // Done with the current message, go on receiving
+    if (state == state_t::ready) {
+        state = state_t::header;
+        in_used = 0;
+        message_op = opcode_t::continuation;
+    }
+}
+
+size_t WebSocket::headerNeeded() { // Size of the frame header, as far as we can tell from what we have of it
+    if (header_used < 2) {
+        return 2;
+    }
+    uint8_t len7 = header[1] & 0x7f;
+    return 2 + (len7 == 126 ? 2 : (len7 == 127 ? 8 : 0)) + ((header[1] & 0x80) ? 4 : 0);
+}
+
+void WebSocket::startPayload() { // Header complete, work out what is coming
+    fin = header[0] & 0x80;
+    frame_op = (opcode_t) (header[0] & 0x0f);
+    uint8_t len7 = header[1] & 0x7f;
+    size_t pos = 2;
+    if (len7 == 126) {
+        payload_length = (header[2] << 8) | header[3];
+        pos = 4;
+    } else if (len7 == 127) {
+        uint64_t l = 0;
+        for (int i = 2; i < 10; i++) {
+            l = (l << 8) | header[i];
+        }
+        payload_length = l > WS_MAX_MESSAGE ? WS_MAX_MESSAGE + 1 : (size_t) l; // Way too long for us either way, don't let it wrap around
+        pos = 10;
+    } else {
+        payload_length = len7;
+    }
+    if (!(header[1] & 0x80)) { // Clients must mask everything they send
+        fail(1002);
+        return;
+    }
+    memcpy(mask_key, &header[pos], 4);
+    payload_done = 0;
+    if ((uint8_t) frame_op & 0x08) { // Control frame: short and never fragmented
+        if (payload_length > sizeof(control) || !fin) {
+            fail(1002);
+            return;
+        }
+    } else {
+        if (frame_op == opcode_t::continuation ? message_op == opcode_t::continuation : message_op != opcode_t::continuation) { // Continuation without a start, or a new message in the middle of one
+            fail(1002);
+            return;
+        }
+        if (payload_length > WS_MAX_MESSAGE - in_used) {
+            fail(1009); // Message too big
+            return;
+        }
+        if (frame_op != opcode_t::continuation) {
+            message_op = frame_op;
+        }
+    }
+    state = state_t::payload;
+    if (payload_length == 0) {
+        endFrame();
+    }
+}
+
+void WebSocket::endFrame() { // Whole frame received
+    header_used = 0;
+    state = state_t::header;
+    switch (frame_op) {
+        case opcode_t::ping:
+            send(opcode_t::pong, control, payload_length);
+            break;
+        case opcode_t::close:
+            send(opcode_t::close, control, min(payload_length, (size_t) 2)); // Echo the status code back, then we're done
+            state = state_t::closed;
+            break;
+        case opcode_t::pong:
+            break;
+        default: // Data
+            in_used += payload_length;
+            if (fin) {
+                state = state_t::ready;
+            }
+            break;
+    }
+}
+
+void WebSocket::fail(uint16_t code) { // Protocol error: tell the client why, and stop
+    uint8_t reason[2] = {(uint8_t) (code >> 8), (uint8_t) (code & 0xff)};
+    send(opcode_t::close, reason, 2);
+    state = state_t::closed;
+}
+
+size_t WebSocket::feed(const uint8_t * data, size_t length) { // Run received bytes through the frame decoder. Returns the number of bytes used - it stops once a message is ready
+    size_t i = 0;
+    while (i < length && (state == state_t::header || state == state_t::payload)) {
+        if (state == state_t::header) {
+            header[header_used++] = data[i++];
+            if (header_used == headerNeeded()) {
+                startPayload();
+            }
+        } else {
+            size_t n = min(length - i, payload_length - payload_done);
+            uint8_t * dest = ((uint8_t) frame_op & 0x08) ? control : &in[in_used];
+            for (size_t k = 0; k < n; k++) { // Unmask while copying
+                dest[payload_done + k] = data[i + k] ^ mask_key[(payload_done + k) & 0x03];
+            }
+            i += n;
+            payload_done += n;
+            if (payload_done == payload_length) {
+                endFrame();
+            }
+        }
+    }
+    return i;
+}
+
+bool WebSocket::send(opcode_t op, const uint8_t * data, size_t length) { // Queue one unfragmented frame. Returns false if it doesn't fit behind what the client hasn't taken yet
+    if (out_sent > 0) { // Move what's left to the front to make room
+        memmove(out, &out[out_sent], out_used - out_sent);
+        out_used -= out_sent;
+        out_sent = 0;
+    }
+    size_t headerlength = length < 126 ? 2 : 4;
+    if (length > 0xffff || out_used + headerlength + length > WS_OUT_BUFFER) {
+        return false;
+    }
+    uint8_t * p = &out[out_used];
+    p[0] = 0x80 | (uint8_t) op; // FIN, we never fragment. Server frames are not masked
+    if (length < 126) {
+        p[1] = length;
+    } else {
+        p[1] = 126;
+        p[2] = length >> 8;
+        p[3] = length & 0xff;
+    }
+    memcpy(&p[headerlength], data, length);
+    out_used += headerlength + length;
+    return true;
+}
+
+bool WebSocket::flush(int fd) { // Write as much of the queue as the socket takes right now. Returns false if the connection is broken
+    if (out_sent == out_used) {
+        return true;
+    }
+    int n = ::send(fd, &out[out_sent], out_used - out_sent, MSG_DONTWAIT);
+    if (n < 0) {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    out_sent += n;
+    if (out_sent == out_used) {
+        out_sent = 0;
+        out_used = 0;
+    }
+    return true;
+}
+
+bool WebSocket::writable() { // Everything sent so far has gone out - safe to send more without piling up
+    return out_used == 0;
+}
@@ -0,0 +1,131 @@
+//webui.cpp
+// The browser UI (faders, scenes, status), served from flash. The files in web/ are gzipped at build time by tools/webui.py into webui_assets.h.
+// Usage:
+//      - Call serve() for every GET request. It returns false if the path isn't under WEBUI_PATH, so the caller can carry on with its own pages
+//      - /ui redirects to /ui/ (so the relative links in index.html work), /ui/ is index.html, /ui/<name> the other files, anything else a 404
+// The files are sent gzipped as they are stored, straight from flash to the client: nothing is compressed, copied or allocated per request.
+// Every file has an ETag from its content, so a browser checking back gets a bare 304. index.html is checked every time, the others are
+// only ever asked for with ?v=hash (added by the build) and cached for good.
+
+#include "webui.h"
+#include "webui_assets.h"
+
+const WebUI::asset_t * WebUI::find(StrView name) { // The file called name (without WEBUI_PATH), NULL if there's none
+    for (const asset_t& asset : WEBUI_ASSETS) {
+        if (name.equals(asset.name)) {
+            return &asset;
+        }
+    }
+    return NULL;
+}
+
+bool WebUI::acceptsGzip(StrView header) { // Accept-Encoding allows gzip. No header at all means anything goes
+    if (header.empty()) {
+        return true;
+    }
+    const char * coding = header.find("gzip");
+    size_t skip = 4;
+    if (coding == NULL) {
+        coding = header.find("*");
+        skip = 1;
+        if (coding == NULL) {
+            return false;
+        }
+    }
+    StrView rest = {coding + skip, header.length - (coding + skip - header.data)};
+    return !refused(rest.token(','));
+}
+
+bool WebUI::refused(StrView params) { // The parameters after a coding (";q=0.5") give it a quality of 0: q=0, q=0., q=0.0 up to q=0.000
+    const char * q = params.find("q=");
+    if (q == NULL) {
+        return false;
+    }
+    const char * end = params.data + params.length;
+    const char * p = q + 2;
+    if (p == end || *p != '0') { // 1, 1.0 or something we don't understand
+        return false;
+    }
+    p++;
+    if (p < end && *p == '.') {
+        p++;
+        while (p < end && *p == '0') {
+            p++;
+        }
+    }
+    return p == end || *p < '1' || *p > '9'; // Any other digit, and it's 0.5 or 0.001 - not much, but accepted
+}
+
+bool WebUI::serve(WiFiClient & client, HttpRequestParser & request, bool keepalive) {
+    StrView path = request.path();
+    size_t prefix = strlen(WEBUI_PATH);
+    if (path.length < prefix || strncasecmp(path.data, WEBUI_PATH, prefix) != 0) {
+        return false;
+    }
+    StrView name = {path.data + prefix, path.length - prefix};
+    if (name.empty()) {
+        client.println("HTTP/1.1 301 Moved Permanently");
+        client.println("Location: " WEBUI_PATH "/");
+        client.println("Content-Length: 0");
+        client.println(keepalive ? "Connection: keep-alive" : "Connection: close");
+        client.println();
+        return true;
+    }
+    if (name.data[0] != '/') { // Something like /uix, not ours
+        return false;
+    }
+    name.data++;
+    name.length--;
+    const asset_t * asset = find(name.empty() ? StrView{"index.html", 10} : name);
+    if (asset == NULL) {
+        sendHeaders(client, "404 Not Found", NULL, keepalive);
+        return true;
+    }
+    StrView match = request.header("If-None-Match");
+    if (match.equals("*") || match.find(asset->etag) != NULL) {
+        sendHeaders(client, "304 Not Modified", asset, keepalive);
+        return true;
+    }
+    if (!acceptsGzip(request.header("Accept-Encoding"))) { // There's only the gzipped copy. Every browser takes it, so this is for odd clients
+        sendHeaders(client, "406 Not Acceptable", NULL, keepalive);
+        return true;
+    }
+    sendHeaders(client, "200 OK", asset, keepalive);
+    client.write(asset->data, asset->length); // From flash as it is, the network stack takes it from there
+    return true;
+}
+
+void WebUI::sendHeaders(WiFiClient & client, const char * status, const asset_t * asset, bool keepalive) { // Without an asset it's an empty error response
+    client.print("HTTP/1.1 ");
+    client.println(status);
+    if (asset != NULL) {
+        client.print("ETag: ");
+        client.println(asset->etag);
+        client.print("Cache-Control: ");
+        client.println(asset->versioned ? WEBUI_CACHE_VERSIONED : WEBUI_CACHE_INDEX);
+        client.println("Vary: Accept-Encoding");
+    }
+    if (strncmp(status, "200", 3) == 0) {
+        client.print("Content-Type: ");
+        client.println(asset->type);
+        client.println("Content-Encoding: gzip");
+        client.print("Content-Length: ");
+        client.println(asset->length);
+    } else if (strncmp(status, "304", 3) != 0) { // 304 must not have a body, or say how long it would be
+        client.println("Content-Length: 0");
+    }
+    client.println(keepalive ? "Connection: keep-alive" : "Connection: close");
+    client.println();
+}
+
+size_t WebUI::count() {
+    return WEBUI_ASSET_COUNT;
+}
+
+size_t WebUI::totalSize() { // Flash used by the gzipped files
+    size_t total = 0;
+    for (const asset_t& asset : WEBUI_ASSETS) {
+        total += asset.length;
+    }
+    return total;
+}
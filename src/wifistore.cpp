@@ -0,0 +1,70 @@
+//wifistore.cpp
+// WiFi credentials of the last network we got onto, stored in NVS (flash) so a reboot doesn't need WPS again.
+// Usage:
+//      - Call begin() once in setup(), then check valid() to see if there's anything to connect to
+//      - Connect with WiFi.begin(ssid(), psk(), channel(), bssid()). With channel and BSSID given the ESP32 goes straight for that access point, no scan
+//      - save() once connected. It only writes to flash when something changed, so calling it on every connect is fine (and keeps the BSSID and channel current when the access point moves)
+//      - clear() forgets the network, the next boot starts WPS
+
+#include "wifistore.h"
+
+WiFiStore::WiFiStore() {
+    memset(&stored, 0, sizeof(stored));
+}
+
+void WiFiStore::begin() {
+    prefs.begin("wifi", false);
+    if (prefs.getBytesLength("creds") == sizeof(stored)) {
+        prefs.getBytes("creds", &stored, sizeof(stored));
+    }
+    stored.ssid[WIFI_SSID_SIZE - 1] = '\0'; // Don't trust flash blindly
+    stored.psk[WIFI_PSK_SIZE - 1] = '\0';
+}
+
+bool WiFiStore::valid() { // True if there's a network to connect to
+    return stored.ssid[0] != '\0';
+}
+
+bool WiFiStore::save(const char * ssid, const char * psk, const uint8_t * bssid, int32_t channel) { // Remember the network we're connected to. Returns false if it couldn't be stored
+    if (ssid == NULL || strlen(ssid) == 0 || strlen(ssid) >= WIFI_SSID_SIZE || psk == NULL || strlen(psk) >= WIFI_PSK_SIZE) {
+        return false;
+    }
+    credentials_t c;
+    memset(&c, 0, sizeof(c)); // Padding and unused bytes too, so comparing the whole struct works
+    strcpy(c.ssid, ssid);
+    strcpy(c.psk, psk);
+    if (bssid != NULL) {
+        memcpy(c.bssid, bssid, 6);
+    }
+    c.channel = (channel > 0 && channel <= 14) ? channel : 0; // 0 means unknown, scan all
+    if (memcmp(&c, &stored, sizeof(c)) == 0) { // Nothing new, spare the flash
+        return true;
+    }
+    if (prefs.putBytes("creds", &c, sizeof(c)) != sizeof(c)) {
+        return false;
+    }
+    stored = c;
+    return true;
+}
+
+void WiFiStore::clear() {
+    prefs.remove("creds");
+    memset(&stored, 0, sizeof(stored));
+}
+
+const char * WiFiStore::ssid() {
+    return stored.ssid;
+}
+
+const char * WiFiStore::psk() {
+    return stored.psk;
+}
+
+const uint8_t * WiFiStore::bssid() { // NULL if not known
+    static const uint8_t none[6] = {0, 0, 0, 0, 0, 0};
+    return memcmp(stored.bssid, none, 6) == 0 ? NULL : stored.bssid;
+}
+
+int32_t WiFiStore::channel() { // 0 if not known
+    return stored.channel;
+}
@@ -0,0 +1,188 @@
+//benchmark.cpp
+// Micro-benchmarks of the hot paths, run on the host against lib/NativeHAL and reported as JSON.
+// Usage:
+//      - Create object with where the JSON should go, run() each benchmark with a name, the number of iterations, the limit for the mean time in us and a function (lambda) doing one iteration
+//      - result() adds a measurement taken some other way. end() closes the JSON, passed() says whether everything stayed within its limit
+//      - allocations() is how many allocations the last run() made, for paths that must not allocate at all
+// The output is a single JSON object: {"results":[{"name":...,"iterations":...,"mean_us":...,"per_second":...,"max_us":...,"limit_us":...,"allocations":...,"peak_alloc_bytes":...,"pass":...},...],"pass":...}
+// allocations counts every malloc() and operator new during the run, peak_alloc_bytes is the most the heap grew above where it started at any point of it.
+// Both come from the allocation wrappers below, which is why this only runs on the host (glibc).
+// Save the output per firmware version and diff them, a limit going red means a regression worth looking at before it goes out.
+
+#include "benchmark.h"
+#include <atomic>
+#include <malloc.h>
+#include <new>
+
+extern "C" void * __libc_malloc(size_t size);
+extern "C" void * __libc_calloc(size_t count, size_t size);
+extern "C" void * __libc_realloc(void * p, size_t size);
+extern "C" void __libc_free(void * p);
+
+static std::atomic<uint32_t> alloc_count(0);
+static std::atomic<size_t> alloc_current(0);
+static std::atomic<size_t> alloc_peak(0);
+
+static void allocated(void * p) {
+    if (p == NULL) {
+        return;
+    }
+    alloc_count++;
+    size_t now = alloc_current += malloc_usable_size(p);
+    size_t peak = alloc_peak.load();
+    while (now > peak && !alloc_peak.compare_exchange_weak(peak, now)) {}
+}
+
+static void freeing(void * p) {
+    if (p != NULL) {
+        alloc_current -= malloc_usable_size(p);
+    }
+}
+
+extern "C" void * malloc(size_t size) {
+    void * p = __libc_malloc(size);
+    allocated(p);
+    return p;
+}
+
+extern "C" void * calloc(size_t count, size_t size) {
+    void * p = __libc_calloc(count, size);
+    allocated(p);
+    return p;
+}
+
+extern "C" void * realloc(void * p, size_t size) {
+    size_t old = p != NULL ? malloc_usable_size(p) : 0;
+    void * q = __libc_realloc(p, size);
+    if (q != NULL || size == 0) { // Otherwise it failed, and the old block is still there
+        alloc_current -= old;
+        allocated(q);
+    }
+    return q;
+}
+
+extern "C" void free(void * p) {
+    freeing(p);
+    __libc_free(p);
+}
+
+void * operator new(size_t size) { // The C++ runtime's own goes to malloc() as well, but don't rely on that
+    void * p = malloc(size);
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void * operator new[](size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void * p) noexcept {
+    free(p);
+}
+
+void operator delete[](void * p) noexcept {
+    free(p);
+}
+
+void operator delete(void * p, size_t) noexcept {
+    free(p);
+}
+
+void operator delete[](void * p, size_t) noexcept {
+    free(p);
+}
+
+alloc_stats_t allocStats() {
+    return {alloc_count.load(), alloc_current.load(), alloc_peak.load()};
+}
+
+void resetAllocPeak() {
+    alloc_peak = alloc_current.load();
+}
+
+Benchmark::Benchmark(Print & out) : out(out) {
+    count = 0;
+    pass = true;
+    last_allocations = 0;
+    out.print("{\"results\":[");
+}
+
+bool Benchmark::result(const char * name, int iterations, double mean, unsigned long worst, unsigned long limit, uint32_t allocations, size_t peak) {
+    bool ok = mean <= limit;
+    pass &= ok;
+    if (count++ > 0) {
+        out.print(',');
+    }
+    out.print("\n{\"name\":\"");
+    out.print(name);
+    out.print("\",\"iterations\":");
+    out.print(iterations);
+    out.print(",\"mean_us\":");
+    out.print(mean, 2);
+    out.print(",\"per_second\":");
+    out.print(mean > 0 ? (unsigned long) (1000000.0 / mean) : 0);
+    out.print(",\"max_us\":");
+    out.print(worst);
+    out.print(",\"limit_us\":");
+    out.print(limit);
+    out.print(",\"allocations\":");
+    out.print(allocations);
+    out.print(",\"peak_alloc_bytes\":");
+    out.print(peak);
+    out.print(",\"pass\":");
+    out.print(ok ? "true" : "false");
+    out.print('}');
+    return ok;
+}
+
+void Benchmark::end() {
+    out.print("\n],\"pass\":");
+    out.print(pass ? "true" : "false");
+    out.print("}\n");
+}
+
+bool Benchmark::passed() {
+    return pass;
+}
+
+uint32_t Benchmark::allocations() {
+    return last_allocations;
+}
+
+NullPrint::NullPrint() {
+    bytes = 0;
+}
+
+size_t NullPrint::write(uint8_t c) {
+    bytes++;
+    return 1;
+}
+
+size_t NullPrint::write(const uint8_t * data, size_t size) {
+    bytes += size;
+    return size;
+}
+
+FilePrint::FilePrint(const char * path) {
+    file = fopen(path, "w");
+}
+
+FilePrint::~FilePrint() {
+    if (file != NULL) {
+        fclose(file);
+    }
+}
+
+size_t FilePrint::write(uint8_t c) {
+    return file != NULL && fputc(c, file) != EOF ? 1 : 0;
+}
+
+size_t FilePrint::write(const uint8_t * data, size_t size) {
+    return file != NULL ? fwrite(data, 1, size, file) : 0;
+}
+
+bool FilePrint::ok() {
+    return file != NULL;
+}
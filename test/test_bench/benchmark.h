@@ -0,0 +1,65 @@
+#ifndef _BENCHMARK_H_
+#define _BENCHMARK_H_
+#include <Arduino.h>
+
+struct alloc_stats_t { // Heap use of the program, kept up to date by the malloc() and operator new wrappers in benchmark.cpp
+    uint32_t allocations; // Since start
+    size_t current; // Bytes allocated now
+    size_t peak; // Highest current since the last resetPeak()
+};
+alloc_stats_t allocStats();
+void resetAllocPeak();
+
+class Benchmark {
+    public:
+        Benchmark(Print & out);
+        template <typename F> bool run(const char * name, int iterations, unsigned long limit, F f) { // Time f() iterations times, the mean must stay within limit us. Returns whether it did
+            resetAllocPeak();
+            alloc_stats_t before = allocStats();
+            unsigned long worst = 0;
+            unsigned long start = micros();
+            for (int i = 0; i < iterations; i++) {
+                unsigned long t = micros();
+                f();
+                t = micros() - t;
+                if (t > worst) worst = t;
+            }
+            unsigned long total = micros() - start;
+            alloc_stats_t after = allocStats();
+            last_allocations = after.allocations - before.allocations;
+            return result(name, iterations, (double) total / iterations, worst, limit, last_allocations, after.peak - before.current);
+        }
+        bool result(const char * name, int iterations, double mean, unsigned long worst, unsigned long limit, uint32_t allocations, size_t peak);
+        void end();
+        bool passed();
+        uint32_t allocations();
+
+    protected:
+        Print & out;
+        int count; // Results written so far
+        bool pass; // All within their limits
+        uint32_t last_allocations; // Made during the last run()
+};
+
+class NullPrint : public Print { // Swallows everything, counting the bytes. For timing output without the network in the way
+    public:
+        NullPrint();
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t * data, size_t size) override;
+        using Print::write;
+        size_t bytes;
+};
+
+class FilePrint : public Print { // Into a file, for the results
+    public:
+        FilePrint(const char * path);
+        ~FilePrint();
+        size_t write(uint8_t c) override;
+        size_t write(const uint8_t * data, size_t size) override;
+        using Print::write;
+        bool ok();
+
+    protected:
+        FILE * file;
+};
+#endif
@@ -0,0 +1,156 @@
+// Benchmarks of the hot paths, on the host against lib/NativeHAL. Each one is a test that fails when it goes over its limit.
+// pio test -e native -f test_bench
+// The results go to BENCH_OUTPUT as JSON as well (see benchmark.cpp), for keeping per firmware version and diffing.
+// Everything runs on the first universe of this test program, which has nothing to do with a bridge on stage. setup() never runs.
+
+#include <unity.h>
+#include "main.h"
+#include "benchmark.h"
+
+#define BENCH_OUTPUT "bench_results.json" // In the directory the tests run in, the project's with pio test
+
+extern DMXUniverse universes[];
+void printDMXDataTable(Print & out, int universe); // main.cpp, not in main.h
+
+static FilePrint * output;
+static Benchmark * bench;
+
+void setUp() {}
+void tearDown() {}
+
+void test_http_parse() { // Only the parser, on a request the way browsers send them. per_second in the results is requests/s. Runs for every request, so it must not allocate
+    static HttpRequestParser parser;
+    const char * request = "GET /DMX?set=12,255&set=13,128 HTTP/1.1\r\n"
+                           "Host: 192.168.4.1\r\n"
+                           "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+                           "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+                           "Accept-Language: en-GB,en;q=0.5\r\n"
+                           "Accept-Encoding: gzip, deflate\r\n"
+                           "Connection: keep-alive\r\n"
+                           "If-None-Match: \"0badf00d-42\"\r\n"
+                           "\r\n";
+    size_t length = strlen(request);
+    TEST_ASSERT_TRUE(bench->run("http_parse", 20000, 20, [&] {
+        parser.reset();
+        parser.feed(request, length);
+    }));
+    TEST_ASSERT_EQUAL_UINT32(0, bench->allocations());
+    TEST_ASSERT_TRUE(parser.done());
+    TEST_ASSERT_TRUE(parser.query().equals("set=12,255&set=13,128"));
+    TEST_ASSERT_TRUE(parser.header("connection").equals("keep-alive"));
+}
+
+void test_http_dmx_set_1() { // A single set= request, from the raw request to the frame being published
+    static HttpRequestParser parser; // Too big for the stack
+    const char * request = "GET /DMX?set=0,255 HTTP/1.1\r\nHost: bench\r\n\r\n";
+    size_t length = strlen(request);
+    TEST_ASSERT_TRUE(bench->run("http_dmx_set_1", 2000, 300, [&] {
+        parser.reset();
+        parser.feed(request, length);
+        readHTTPResponse(parser);
+    }));
+}
+
+void test_dmx_set_512() { // A whole universe of set= pairs. That doesn't fit in a request line (HTTP_REQUEST_BUFFER_SIZE), so this goes straight to the handler
+    static char query[DMXArraySize * 12];
+    int length = 0;
+    for (int i = 0; i < DMXArraySize; i++) {
+        length += sprintf(&query[length], "%sset=%d,%d", i > 0 ? "&" : "", i, i & 0xff);
+    }
+    TEST_ASSERT_TRUE(bench->run("dmx_set_512", 200, 10000, [&] {
+        handleResponseDMX({query, (size_t) length});
+    }));
+}
+
+void test_dmx_table_render() { // The DMX page's table, printed to nowhere so only the rendering counts
+    NullPrint sink;
+    TEST_ASSERT_TRUE(bench->run("dmx_table_render", 100, 50000, [&] {
+        printDMXDataTable(sink, 0);
+    }));
+}
+
+void test_led_output() {
+    StatusLed leds(20, 21, 22);
+    leds.flash(20, 100, 100);
+    leds.pattern(21, StatusLed::double_blink);
+    TEST_ASSERT_TRUE(bench->run("led_output", 10000, 20, [&] {
+        leds.output();
+    }));
+}
+
+void test_fade_512() { // One frame's worth of fading with the whole universe on the move, the worst case for the DMX task
+    static FadeEngine fader;
+    static uint8_t output[DMX_PACKET_SIZE];
+    static uint8_t frame[DMX_PACKET_SIZE];
+    fader.begin();
+    for (int i = 0; i < DMXArraySize; i++) {
+        TEST_ASSERT_TRUE(fader.fade(i, 255 - (i & 0xff), 60000, (FadeEngine::curve_t) (i & 3))); // All four curves, long enough to outlast the run
+        if ((i + 1) % FADE_QUEUE_SIZE == 0) {
+            fader.update(output); // Start them before the queue is full
+        }
+    }
+    fader.update(output);
+    TEST_ASSERT_EQUAL_INT(DMXArraySize, fader.active());
+    TEST_ASSERT_TRUE(bench->run("fade_512", 10000, 50, [&] {
+        fader.apply(output, frame, millis());
+    }));
+}
+
+static void freeRunningDMXTask(void * p) { // Stands in for the firmware's DMX task, running free
+    MetricTiming transform;
+    while (true) {
+        universes[0].prepare(NULL, transform);
+        universes[0].send();
+        universes[0].wait();
+    }
+}
+
+void test_frame_handoff() { // From publishing a frame until the DMX task picks it up. The DMX task notes when that happens, we wait for it to change
+    DMXUniverse & universe = universes[0];
+    unsigned long total = 0, worst = 0;
+    int handoffs = 0;
+    for (int i = 0; i < 50; i++) {
+        byte * frame = universe.buffer.beginWrite(100);
+        TEST_ASSERT_NOT_NULL(frame);
+        unsigned long before = universe.handoffTime();
+        unsigned long start = micros();
+        frame[0] ^= 1;
+        universe.buffer.markDirty(0, 1);
+        universe.buffer.endWrite();
+        while (universe.handoffTime() == before && micros() - start < 100000) {
+            vTaskDelay(1);
+        }
+        if (universe.handoffTime() != before) {
+            unsigned long t = universe.handoffTime() - start;
+            total += t;
+            if (t > worst) worst = t;
+            handoffs++;
+        }
+    }
+    TEST_ASSERT_EQUAL_INT(50, handoffs);
+    TEST_ASSERT_TRUE(bench->result("frame_handoff", handoffs, (double) total / handoffs, worst, 50000, 0, 0)); // Waits for the frame on the wire (22.7 ms for a full universe), so up to two of them
+}
+
+int main(int argc, char ** argv) {
+    universes[0].begin();
+    output = new FilePrint(BENCH_OUTPUT);
+    bench = new Benchmark(*output);
+
+    UNITY_BEGIN();
+    RUN_TEST(test_http_parse);
+    RUN_TEST(test_http_dmx_set_1);
+    RUN_TEST(test_dmx_set_512);
+    RUN_TEST(test_dmx_table_render);
+    RUN_TEST(test_led_output);
+    RUN_TEST(test_fade_512);
+    TaskHandle_t task;
+    xTaskCreatePinnedToCore(freeRunningDMXTask, "DMX Task", 2048, NULL, 1, &task, 1); // Only for the hand-off, the others call prepare() themselves or don't need it
+    RUN_TEST(test_frame_handoff);
+    bench->end();
+    if (!output->ok()) {
+        printf("Could not write %s\n", BENCH_OUTPUT);
+    }
+    delete bench;
+    delete output;
+    return UNITY_END();
+}
@@ -0,0 +1,975 @@
+// Unit tests of the parts that run without hardware, on the host against lib/NativeHAL.
+// pio test -e native
+// The firmware sources are linked in (test_build_src), so main.cpp's handlers and globals are here as well. Its setup() never runs.
+
+#include <unity.h>
+#include "main.h"
+
+extern DMXUniverse universes[];
+extern SceneStore scenes;
+
+void setUp() {}
+void tearDown() {}
+
+static StrView view(const char * s) {
+    return {s, strlen(s)};
+}
+
+// StrView
+
+void test_strview_compare() {
+    StrView v = view("DMX");
+    TEST_ASSERT_TRUE(v.equals("DMX"));
+    TEST_ASSERT_FALSE(v.equals("dmx"));
+    TEST_ASSERT_TRUE(v.equalsIgnoreCase("dmx"));
+    TEST_ASSERT_FALSE(v.equalsIgnoreCase("dmx2"));
+    TEST_ASSERT_TRUE(view("").empty());
+}
+
+void test_strview_toint_is_strict() {
+    int v = -1;
+    TEST_ASSERT_TRUE(view("0").toInt(v));
+    TEST_ASSERT_EQUAL_INT(0, v);
+    TEST_ASSERT_TRUE(view("511").toInt(v));
+    TEST_ASSERT_EQUAL_INT(511, v);
+    TEST_ASSERT_FALSE(view("").toInt(v));
+    TEST_ASSERT_FALSE(view("12a").toInt(v));
+    TEST_ASSERT_FALSE(view("-1").toInt(v));
+    TEST_ASSERT_FALSE(view(" 1").toInt(v));
+    TEST_ASSERT_FALSE(view("1234567890").toInt(v)); // Might not fit
+}
+
+void test_strview_pairs() {
+    StrView query = view("set=1,255&fade=2,0,500&flag&=x");
+    StrView name, value;
+    TEST_ASSERT_TRUE(query.nextPair(name, value));
+    TEST_ASSERT_TRUE(name.equals("set"));
+    TEST_ASSERT_TRUE(value.equals("1,255"));
+    StrView address = value.token(',');
+    TEST_ASSERT_TRUE(address.equals("1"));
+    TEST_ASSERT_TRUE(value.equals("255"));
+    TEST_ASSERT_TRUE(query.nextPair(name, value));
+    TEST_ASSERT_TRUE(name.equals("fade"));
+    TEST_ASSERT_TRUE(value.equals("2,0,500"));
+    TEST_ASSERT_TRUE(query.nextPair(name, value));
+    TEST_ASSERT_TRUE(name.equals("flag"));
+    TEST_ASSERT_TRUE(value.empty());
+    TEST_ASSERT_TRUE(query.nextPair(name, value));
+    TEST_ASSERT_TRUE(name.empty());
+    TEST_ASSERT_TRUE(value.equals("x"));
+    TEST_ASSERT_FALSE(query.nextPair(name, value));
+}
+
+// HttpRequestParser
+
+static HttpRequestParser parser; // Too big for a stack
+
+void test_parser_get() {
+    const char * request = "GET /DMX?set=1,2 HTTP/1.1\r\nHost: bridge\r\nIf-None-Match: \"x\"\r\n\r\n";
+    parser.reset();
+    TEST_ASSERT_EQUAL_UINT(strlen(request), parser.feed(request, strlen(request)));
+    TEST_ASSERT_TRUE(parser.done());
+    TEST_ASSERT_FALSE(parser.failed());
+    TEST_ASSERT_TRUE(parser.method().equals("GET"));
+    TEST_ASSERT_TRUE(parser.path().equals("/DMX"));
+    TEST_ASSERT_TRUE(parser.query().equals("set=1,2"));
+    TEST_ASSERT_TRUE(parser.version().equals("HTTP/1.1"));
+    TEST_ASSERT_TRUE(parser.header("host").equals("bridge"));
+    TEST_ASSERT_TRUE(parser.header("If-None-Match").equals("\"x\""));
+    TEST_ASSERT_TRUE(parser.header("Accept").empty());
+    TEST_ASSERT_TRUE(parser.body().empty());
+}
+
+void test_parser_byte_at_a_time() { // Requests arrive in whatever pieces TCP makes of them
+    const char * request = "GET /SCENE HTTP/1.0\r\nConnection: keep-alive\r\n\r\n";
+    parser.reset();
+    for (size_t i = 0; i < strlen(request); i++) {
+        TEST_ASSERT_FALSE(parser.done());
+        TEST_ASSERT_EQUAL_UINT(1, parser.feed(&request[i], 1));
+    }
+    TEST_ASSERT_TRUE(parser.done());
+    TEST_ASSERT_TRUE(parser.path().equals("/SCENE"));
+    TEST_ASSERT_TRUE(parser.query().empty());
+    TEST_ASSERT_TRUE(parser.header("Connection").equals("keep-alive"));
+}
+
+void test_parser_stops_at_request_end() { // Pipelined requests: the second one is left for after reset()
+    const char * requests = "GET /a HTTP/1.1\r\n\r\nGET /b HTTP/1.1\r\n\r\n";
+    parser.reset();
+    size_t used = parser.feed(requests, strlen(requests));
+    TEST_ASSERT_EQUAL_UINT(19, used);
+    TEST_ASSERT_TRUE(parser.path().equals("/a"));
+    parser.reset();
+    parser.feed(&requests[used], strlen(requests) - used);
+    TEST_ASSERT_TRUE(parser.done());
+    TEST_ASSERT_TRUE(parser.path().equals("/b"));
+}
+
+void test_parser_body() {
+    const char * request = "POST /DMX?start=10 HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc";
+    parser.reset();
+    parser.feed(request, strlen(request));
+    TEST_ASSERT_TRUE(parser.done());
+    TEST_ASSERT_TRUE(parser.method().equals("POST"));
+    TEST_ASSERT_TRUE(parser.body().equals("abc"));
+}
+
+void test_parser_rejects() {
+    const char * garbage = "NONSENSE\r\n\r\n";
+    parser.reset();
+    parser.feed(garbage, strlen(garbage));
+    TEST_ASSERT_TRUE(parser.failed());
+
+    char line[HTTP_REQUEST_BUFFER_SIZE + 64]; // Request line longer than the buffer
+    int n = snprintf(line, sizeof(line), "GET /");
+    memset(&line[n], 'a', sizeof(line) - n - 1);
+    line[sizeof(line) - 1] = '\0';
+    parser.reset();
+    parser.feed(line, strlen(line));
+    TEST_ASSERT_TRUE(parser.failed());
+    TEST_ASSERT_FALSE(parser.tooLarge());
+
+    char body[64];
+    snprintf(body, sizeof(body), "POST /DMX HTTP/1.1\r\nContent-Length: %d\r\n\r\n", HTTP_MAX_BODY + 1);
+    parser.reset();
+    parser.feed(body, strlen(body));
+    TEST_ASSERT_TRUE(parser.tooLarge());
+}
+
+// handleResponseDMX
+
+static MetricTiming transform; // prepare() wants somewhere to put its timing
+
+static int readSlot(int address) { // What the first universe last gave the driver, address 0-511
+    return dmx_read_slot(universes[0].port(), address + 1);
+}
+
+void test_dmx_set() {
+    DMXFrameBuffer & buffer = universes[0].buffer;
+    uint32_t version = buffer.version();
+    handleResponseDMX(view("set=5,200&set=6,7"));
+    TEST_ASSERT_EQUAL_UINT8(200, buffer.current()[5]);
+    TEST_ASSERT_EQUAL_UINT8(7, buffer.current()[6]);
+    TEST_ASSERT_GREATER_OR_EQUAL(7, buffer.slotsUsed());
+    TEST_ASSERT_EQUAL_UINT32(version + 1, buffer.version()); // Both in one frame
+    universes[0].prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(200, readSlot(5));
+    TEST_ASSERT_EQUAL_INT(7, readSlot(6));
+}
+
+void test_dmx_set_ignores_bad_pairs() {
+    DMXFrameBuffer & buffer = universes[0].buffer;
+    handleResponseDMX(view("set=20,1"));
+    uint32_t version = buffer.version();
+    handleResponseDMX(view("set=512,1&set=20,256&set=20&set=x,1&set=20,1x"));
+    TEST_ASSERT_EQUAL_UINT8(1, buffer.current()[20]);
+    TEST_ASSERT_EQUAL_UINT32(version, buffer.version()); // Nothing published
+}
+
+void test_dmx_fade() {
+    DMXUniverse & universe = universes[0];
+    handleResponseDMX(view("set=30,0"));
+    universe.prepare(NULL, transform);
+    handleResponseDMX(view("fade=30,200,400"));
+    TEST_ASSERT_EQUAL_UINT8(200, universe.buffer.current()[30]); // The target is in the frame right away
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_TRUE(universe.fader.fading(30));
+    TEST_ASSERT_LESS_THAN(100, readSlot(30)); // But the output starts from where it was
+    delay(200);
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_GREATER_THAN(50, readSlot(30));
+    TEST_ASSERT_LESS_THAN(150, readSlot(30));
+    delay(250);
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(200, readSlot(30));
+    TEST_ASSERT_FALSE(universe.fader.fading(30));
+}
+
+void test_dmx_set_stops_fade() {
+    DMXUniverse & universe = universes[0];
+    handleResponseDMX(view("set=31,0"));
+    universe.prepare(NULL, transform);
+    handleResponseDMX(view("fade=31,255,10000"));
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_TRUE(universe.fader.fading(31));
+    handleResponseDMX(view("set=31,100"));
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_FALSE(universe.fader.fading(31));
+    TEST_ASSERT_EQUAL_INT(100, readSlot(31)); // A snap
+}
+
+void test_dmx_set_to_fade_target() { // The frame already holds the target, so nothing gets published. The fade still has to stop
+    DMXUniverse & universe = universes[0];
+    handleResponseDMX(view("set=32,0"));
+    universe.prepare(NULL, transform);
+    handleResponseDMX(view("fade=32,255,10000"));
+    universe.prepare(NULL, transform);
+    uint32_t version = universe.buffer.version();
+    handleResponseDMX(view("set=32,255"));
+    TEST_ASSERT_EQUAL_UINT32(version, universe.buffer.version());
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_FALSE(universe.fader.fading(32));
+    TEST_ASSERT_EQUAL_INT(255, readSlot(32));
+}
+
+void test_dmx_fade_then_set() { // In the same request, before the DMX task has even seen the fade
+    DMXUniverse & universe = universes[0];
+    handleResponseDMX(view("set=33,100"));
+    universe.prepare(NULL, transform);
+    handleResponseDMX(view("fade=33,255,3000&set=33,0"));
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_FALSE(universe.fader.fading(33));
+    TEST_ASSERT_EQUAL_INT(0, readSlot(33));
+    delay(50);
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(0, readSlot(33));
+}
+
+void test_dmx_set_then_fade() { // The set's cancel goes out after the frame, it mustn't catch the fade behind it
+    DMXUniverse & universe = universes[0];
+    handleResponseDMX(view("set=36,0"));
+    universe.prepare(NULL, transform);
+    handleResponseDMX(view("fade=36,255,10000"));
+    universe.prepare(NULL, transform);
+    handleResponseDMX(view("set=36,10&fade=36,200,10000"));
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_TRUE(universe.fader.fading(36));
+    TEST_ASSERT_EQUAL_UINT8(200, universe.buffer.current()[36]);
+    handleResponseDMX(view("set=36,0"));
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_FALSE(universe.fader.fading(36));
+}
+
+void test_websocket_stops_fade() {
+    DMXUniverse & universe = universes[0];
+    handleResponseDMX(view("set=34,0&set=35,0"));
+    universe.prepare(NULL, transform);
+    handleResponseDMX(view("fade=34,255,10000&fade=35,255,10000"));
+    universe.prepare(NULL, transform);
+    const uint8_t set[] = {0x01, 0, 34, 50};
+    handleWebSocketMessage(0, set, sizeof(set));
+    const uint8_t block[] = {0x02, 0, 35, 60};
+    handleWebSocketMessage(0, block, sizeof(block));
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_FALSE(universe.fader.fading(34));
+    TEST_ASSERT_FALSE(universe.fader.fading(35));
+    TEST_ASSERT_EQUAL_INT(50, readSlot(34));
+    TEST_ASSERT_EQUAL_INT(60, readSlot(35));
+}
+
+// handleResponsePatch
+
+static int patchedAt(int address) { // 16 bit value of a coarse/fine pair in the output, address 0-510
+    return readSlot(address) << 8 | readSlot(address + 1);
+}
+
+void test_patch_coarse_fine() {
+    DMXUniverse & universe = universes[0];
+    handleResponsePatch(view("add=0,400,16"));
+    universe.prepare(NULL, transform); // Switches to the new table
+    handleResponsePatch(view("add=1,402"));
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(403, universe.patch.slots());
+    handleResponsePatch(view("set=0,4660&set=1,43981")); // 0x1234 and 0xabcd
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(0x12, readSlot(400));
+    TEST_ASSERT_EQUAL_INT(0x34, readSlot(401));
+    TEST_ASSERT_EQUAL_INT(0xab, readSlot(402)); // 8 bit gets the top byte
+    TEST_ASSERT_EQUAL_UINT16(0xabcd, universe.patch.level(1));
+    handleResponsePatch(view("set=0,65536&set=1,x")); // Out of range, nothing changes
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(0x1234, patchedAt(400));
+    handleResponsePatch(view("remove=0"));
+    universe.prepare(NULL, transform);
+    handleResponsePatch(view("remove=1"));
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(0, universe.patch.entries());
+}
+
+void test_patch_overlap_rejected() { // One slot, one channel
+    DMXUniverse & universe = universes[0];
+    handleResponsePatch(view("add=2,410,16"));
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_FALSE(universe.patch.add(3, 410, 1)); // Its coarse slot
+    TEST_ASSERT_FALSE(universe.patch.add(3, 411, 1)); // Its fine slot
+    TEST_ASSERT_FALSE(universe.patch.add(3, 409, 2)); // Fine slot on its coarse one
+    TEST_ASSERT_FALSE(universe.patch.add(2, 410, 2)); // Not even the same channel again
+    TEST_ASSERT_FALSE(universe.patch.add(3, 511, 2)); // Fine slot past the end
+    TEST_ASSERT_FALSE(universe.patch.add(PATCH_CHANNELS, 420, 1));
+    handleResponsePatch(view("add=3,412,24")); // Only 8 or 16 bit
+    TEST_ASSERT_EQUAL_INT(1, universe.patch.entries());
+    TEST_ASSERT_TRUE(universe.patch.add(3, 409, 1)); // Right up against it is fine
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_TRUE(universe.patch.add(3, 412, 1));
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(3, universe.patch.entries());
+    handleResponsePatch(view("remove=2"));
+    universe.prepare(NULL, transform);
+    handleResponsePatch(view("remove=3"));
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(0, universe.patch.entries());
+}
+
+void test_patch_one_to_many() { // Several identical fixtures on one channel, given out of slot order
+    DMXUniverse & universe = universes[0];
+    handleResponsePatch(view("add=4,430,16"));
+    universe.prepare(NULL, transform);
+    handleResponsePatch(view("add=4,420"));
+    universe.prepare(NULL, transform);
+    handleResponsePatch(view("add=4,425"));
+    universe.prepare(NULL, transform);
+    handleResponsePatch(view("set=4,32769")); // 0x8001
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(0x80, readSlot(420));
+    TEST_ASSERT_EQUAL_INT(0x80, readSlot(425));
+    TEST_ASSERT_EQUAL_INT(0x8001, patchedAt(430));
+    TEST_ASSERT_EQUAL_INT(432, universe.patch.slots());
+    handleResponsePatch(view("remove=4")); // All three at once
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(0, universe.patch.entries());
+    handleResponsePatch(view("set=4,0"));
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(0x80, readSlot(420)); // Unpatched slots keep their last value
+}
+
+void test_patch_fade() { // 16 bit, both ways
+    DMXUniverse & universe = universes[0];
+    handleResponsePatch(view("add=5,440,16"));
+    universe.prepare(NULL, transform);
+    handleResponsePatch(view("set=5,0"));
+    universe.prepare(NULL, transform);
+    handleResponsePatch(view("fade=5,65535,400"));
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_LESS_THAN(0x2000, patchedAt(440)); // Starts from where it was
+    delay(200);
+    universe.prepare(NULL, transform);
+    int up = patchedAt(440);
+    TEST_ASSERT_GREATER_THAN(0x4000, up);
+    TEST_ASSERT_LESS_THAN(0xc000, up);
+    TEST_ASSERT_NOT_EQUAL(0, up & 0xff); // The fine byte moves as well
+    delay(250);
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(0xffff, patchedAt(440)); // Lands on the target exactly
+    handleResponsePatch(view("fade=5,4096,400")); // Down, the difference is negative
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_GREATER_THAN(0xe000, patchedAt(440));
+    delay(200);
+    universe.prepare(NULL, transform);
+    int down = patchedAt(440);
+    TEST_ASSERT_GREATER_THAN(0x5000, down);
+    TEST_ASSERT_LESS_THAN(0xb000, down);
+    handleResponsePatch(view("fade=5,8192,10000")); // Taken over halfway, from where it is now
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_INT_WITHIN(0x1000, down, patchedAt(440));
+    handleResponsePatch(view("set=5,1000")); // A set snaps, the fade is dropped
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(1000, patchedAt(440));
+    delay(50);
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(1000, patchedAt(440));
+    handleResponsePatch(view("remove=5"));
+    universe.prepare(NULL, transform);
+}
+
+static std::atomic<bool> dmx_running;
+static std::atomic<bool> dmx_stopped;
+
+static void dmxTask(void * p) { // Stands in for the DMX task, so the patch has someone to hand its tables to
+    while (dmx_running) {
+        universes[0].prepare(NULL, transform);
+        vTaskDelay(1);
+    }
+    dmx_stopped = true;
+    vTaskDelete(NULL);
+}
+
+void test_patch_table_handoff() {
+    DMXUniverse & universe = universes[0];
+    handleResponsePatch(view("set=10,32512")); // 0x7f00
+    handleResponsePatch(view("add=10,450"));
+    TEST_ASSERT_EQUAL_INT(451, universe.patch.slots()); // Known straight away, for the frame length
+    TEST_ASSERT_EQUAL_INT(0, readSlot(450)); // But the DMX task only takes the table between frames
+    universe.prepare(NULL, transform);
+    TEST_ASSERT_EQUAL_INT(0x7f, readSlot(450));
+    dmx_running = true;
+    dmx_stopped = false;
+    xTaskCreatePinnedToCore(dmxTask, "DMX", 4096, NULL, 1, NULL, 1);
+    handleResponsePatch(view("add=11,452&add=12,453,16&set=11,256&set=12,258")); // Each add waits for the DMX task to free the spare table
+    TEST_ASSERT_EQUAL_INT(3, universe.patch.entries());
+    delay(20);
+    dmx_running = false;
+    while (!dmx_stopped) {
+        delay(1);
+    }
+    TEST_ASSERT_EQUAL_INT(0x7f, readSlot(450));
+    TEST_ASSERT_EQUAL_INT(0x01, readSlot(452));
+    TEST_ASSERT_EQUAL_INT(0x0102, patchedAt(453));
+    TEST_ASSERT_EQUAL_INT(455, universe.patch.slots());
+    for (int channel = 10; channel <= 12; channel++) {
+        TEST_ASSERT_TRUE(universe.patch.remove(channel));
+        universe.prepare(NULL, transform);
+    }
+    TEST_ASSERT_FALSE(universe.patch.remove(10));
+    TEST_ASSERT_EQUAL_INT(0, universe.patch.slots());
+}
+
+// handleResponseCurve
+
+void test_curve_points() {
+    ResponseCurves & curves = universes[0].curves;
+    handleResponseCurve(view("define=1&points=0:0,255:128"));
+    TEST_ASSERT_EQUAL_UINT8(2, curves.curve(1).points);
+    handleResponseCurve(view("define=1&points=0:0,10:1,20:2,30:3,40:4,50:5,60:6,70:7,80:8")); // One too many
+    TEST_ASSERT_EQUAL_UINT8(2, curves.curve(1).points);
+    handleResponseCurve(view("define=1&points=0:0,x:5,255:255"));
+    TEST_ASSERT_EQUAL_UINT8(2, curves.curve(1).points);
+    handleResponseCurve(view("define=1&points=0:0,128:256"));
+    TEST_ASSERT_EQUAL_UINT8(2, curves.curve(1).points);
+    handleResponseCurve(view("define=1&points=0:0,10:1,20:2,30:3,40:4,50:5,60:6,255:255")); // As many as fit
+    TEST_ASSERT_EQUAL_UINT8(CURVE_POINTS, curves.curve(1).points);
+    TEST_ASSERT_EQUAL_UINT8(255, curves.curve(1).out[CURVE_POINTS - 1]);
+}
+
+// DMXFrameBuffer
+
+static DMXFrameBuffer frame;
+
+static void publish(int first, int count, uint8_t value) {
+    uint8_t * working = frame.beginWrite(100);
+    TEST_ASSERT_NOT_NULL(working);
+    memset(&working[first], value, count);
+    frame.markDirty(first, count);
+    frame.endWrite();
+}
+
+void test_frame_publish_and_acquire() {
+    int first, last;
+    publish(10, 5, 0x55);
+    const uint8_t * packet = frame.acquire(first, last);
+    TEST_ASSERT_EQUAL_INT(10, first);
+    TEST_ASSERT_EQUAL_INT(15, last);
+    TEST_ASSERT_EQUAL_UINT8(0, packet[0]); // Start code
+    TEST_ASSERT_EQUAL_UINT8(0x55, packet[11]);
+    TEST_ASSERT_EQUAL_UINT8(0, packet[16]);
+    TEST_ASSERT_EQUAL_INT(15, frame.slotsUsed());
+
+    packet = frame.acquire(first, last); // Nothing new
+    TEST_ASSERT_TRUE(last <= first);
+    TEST_ASSERT_EQUAL_UINT8(0x55, packet[11]);
+}
+
+void test_frame_keeps_earlier_changes() { // Every one of the three frames has to catch up on what the others got
+    int first, last;
+    for (int i = 0; i < 6; i++) {
+        publish(i * 20, 4, i + 1);
+        const uint8_t * packet = frame.acquire(first, last);
+        TEST_ASSERT_EQUAL_INT(i * 20, first);
+        TEST_ASSERT_EQUAL_INT(i * 20 + 4, last);
+        for (int j = 0; j <= i; j++) {
+            TEST_ASSERT_EQUAL_UINT8(j + 1, packet[j * 20 + 1]);
+        }
+    }
+}
+
+void test_frame_changes_add_up() { // Several publishes between two acquires come out as one range
+    int first, last;
+    publish(100, 1, 1);
+    publish(300, 2, 2);
+    const uint8_t * packet = frame.acquire(first, last);
+    TEST_ASSERT_EQUAL_INT(100, first);
+    TEST_ASSERT_EQUAL_INT(302, last);
+    TEST_ASSERT_EQUAL_UINT8(1, packet[101]);
+    TEST_ASSERT_EQUAL_UINT8(2, packet[302]);
+}
+
+void test_frame_versions() {
+    uint32_t version = frame.version();
+    uint8_t * working = frame.beginWrite(100);
+    frame.endWrite(); // Nothing marked, nothing published
+    TEST_ASSERT_EQUAL_UINT32(version, frame.version());
+    working = frame.beginWrite(100);
+    working[400] = 9;
+    frame.markDirty(400, 1);
+    frame.endWrite();
+    TEST_ASSERT_EQUAL_UINT32(version + 1, frame.version());
+    frame.beginWrite(100);
+    TEST_ASSERT_EQUAL_UINT32(version + 1, frame.slotVersion(400));
+    TEST_ASSERT_TRUE(frame.slotVersion(401) <= version);
+    frame.endWrite();
+}
+
+void test_frame_same_values_not_published() { // Senders refresh the whole universe all the time, only real changes count
+    int first, last;
+    publish(200, 50, 3);
+    frame.acquire(first, last);
+    uint32_t version = frame.version();
+    publish(200, 50, 3);
+    TEST_ASSERT_EQUAL_UINT32(version, frame.version());
+    frame.acquire(first, last);
+    TEST_ASSERT_TRUE(last <= first);
+    uint8_t * working = frame.beginWrite(100);
+    working[230] = 4;
+    frame.markDirty(200, 50); // All of it written, one slot different
+    frame.endWrite();
+    TEST_ASSERT_EQUAL_UINT32(version + 1, frame.version());
+    const uint8_t * packet = frame.acquire(first, last);
+    TEST_ASSERT_EQUAL_INT(230, first);
+    TEST_ASSERT_EQUAL_INT(231, last);
+    TEST_ASSERT_EQUAL_UINT8(4, packet[231]);
+    frame.beginWrite(100);
+    TEST_ASSERT_EQUAL_UINT32(version + 1, frame.slotVersion(230));
+    TEST_ASSERT_TRUE(frame.slotVersion(229) <= version);
+    frame.endWrite();
+}
+
+static DMXFrameBuffer stressed;
+static std::atomic<bool> stress_done;
+
+static void stressWriter(void * p) { // Publishes as fast as it can. Each frame changes a random range, and the last slot makes every frame add up to 0, so the reader can tell a torn one
+    uint32_t random = 1;
+    while (!stress_done) {
+        uint8_t * working = stressed.beginWrite(100);
+        if (working == NULL) {
+            continue;
+        }
+        random = random * 1103515245 + 12345;
+        int first = (random >> 8) % (DMXArraySize - 1);
+        int count = 1 + (random >> 20) % (DMXArraySize - 1 - first);
+        for (int i = first; i < first + count; i++) {
+            working[i] += (random >> 16) | 1;
+        }
+        uint8_t sum = 0;
+        for (int i = 0; i < DMXArraySize - 1; i++) {
+            sum += working[i];
+        }
+        working[DMXArraySize - 1] = -sum;
+        stressed.markDirty(first, count);
+        stressed.markDirty(DMXArraySize - 1, 1);
+        stressed.endWrite();
+    }
+    vTaskDelete(NULL);
+}
+
+void test_frame_never_torn() { // The reader checks every frame it acquires while the writer keeps publishing
+    stressed.begin();
+    stress_done = false;
+    xTaskCreatePinnedToCore(stressWriter, "Writer", 2048, NULL, 1, NULL, 0);
+    int first, last, torn = 0, fresh = 0;
+    unsigned long start = millis();
+    while (fresh < 10000 && millis() - start < 1000) {
+        const uint8_t * packet = stressed.acquire(first, last);
+        if (last > first) {
+            fresh++;
+        }
+        uint8_t sum = 0;
+        for (int i = 1; i <= DMXArraySize; i++) {
+            sum += packet[i];
+        }
+        if (sum != 0) {
+            torn++;
+        }
+    }
+    stress_done = true;
+    delay(10);
+    TEST_ASSERT_EQUAL_INT(0, torn);
+    TEST_ASSERT_GREATER_THAN(10, fresh); // Far more with a core each, on one they only take turns every few ms
+}
+
+// FrameClock
+
+static void idleTask(void * p) { // Somewhere for the clock's ticks to go, the main thread can't take notifications
+    while (true) {
+        vTaskDelay(1000);
+    }
+}
+
+void test_clock_rate_kept() {
+    static FrameClock clock, rebooted; // Share the NVS namespace, like the same clock before and after a reboot
+    TaskHandle_t task;
+    xTaskCreatePinnedToCore(idleTask, "Idle", 1024, NULL, 1, &task, 1);
+    clock.begin(task, FRAME_RATE_AUTO);
+    TEST_ASSERT_EQUAL_INT(FRAME_RATE_AUTO, clock.rate()); // Nothing stored yet, the default
+    TEST_ASSERT_TRUE(clock.setRate(25));
+    TEST_ASSERT_FALSE(clock.setRate(FRAME_RATE_MAX + 1));
+    TEST_ASSERT_FALSE(clock.setRate(FRAME_RATE_FREE - 1));
+    TEST_ASSERT_EQUAL_INT(25, clock.rate());
+    rebooted.begin(task, FRAME_RATE_AUTO);
+    TEST_ASSERT_EQUAL_INT(25, rebooted.rate());
+    TEST_ASSERT_TRUE(clock.setRate(FRAME_RATE_AUTO));
+}
+
+static FrameClock paced;
+static volatile uint32_t paced_periods[4];
+static volatile bool paced_done;
+
+static void pacedTask(void * p) { // wait() takes the DMX task's notifications, so this has to run in a task of its own
+    paced.begin(xTaskGetCurrentTaskHandle(), FRAME_RATE_AUTO);
+    paced.setRate(FRAME_RATE_AUTO);
+    paced.fit(2000); // A short frame
+    paced.wait();
+    paced_periods[0] = paced.period();
+    paced.fit(22000); // About a full universe
+    paced.wait();
+    paced_periods[1] = paced.period();
+    paced.setRate(40);
+    paced.wait();
+    paced_periods[2] = paced.period();
+    paced.setRate(FRAME_RATE_FREE);
+    paced.wait();
+    paced_periods[3] = paced.period();
+    paced.setRate(FRAME_RATE_AUTO);
+    paced_done = true;
+    idleTask(NULL);
+}
+
+void test_clock_follows_frame_length() {
+    paced_done = false;
+    xTaskCreatePinnedToCore(pacedTask, "Paced", 2048, NULL, 1, NULL, 1);
+    unsigned long start = millis();
+    while (!paced_done && millis() - start < 2000) {
+        delay(10);
+    }
+    TEST_ASSERT_TRUE(paced_done);
+    TEST_ASSERT_EQUAL_UINT32(2000 + FRAME_CLOCK_MARGIN, paced_periods[0]);
+    TEST_ASSERT_EQUAL_UINT32(22000 + FRAME_CLOCK_MARGIN, paced_periods[1]);
+    TEST_ASSERT_EQUAL_UINT32(25000, paced_periods[2]);
+    TEST_ASSERT_EQUAL_UINT32(0, paced_periods[3]);
+}
+
+// StatusLed
+
+#define TEST_LED 33
+
+static bool ledAt(StatusLed & led, unsigned long ms) { // Pin state once the clock reads ms
+    nativeSetMillis(ms);
+    led.output();
+    return digitalRead(TEST_LED) == HIGH;
+}
+
+void test_led_static() {
+    StatusLed led;
+    led.add(TEST_LED);
+    led.on(TEST_LED);
+    TEST_ASSERT_EQUAL_INT(HIGH, digitalRead(TEST_LED));
+    led.off();
+    TEST_ASSERT_EQUAL_INT(LOW, digitalRead(TEST_LED));
+}
+
+void test_led_pattern_across_millis_wrap() { // double_blink is 100 on, 150 off, 100 on, 650 off. Started 60 ms before millis() wraps at 2^32
+    StatusLed led;
+    led.add(TEST_LED);
+    unsigned long start = 0xffffffffUL - 60;
+    nativeSetMillis(start);
+    led.pattern(TEST_LED, StatusLed::double_blink);
+    TEST_ASSERT_TRUE(ledAt(led, start + 50));
+    TEST_ASSERT_FALSE(ledAt(led, start + 150)); // Past the wrap from here on
+    TEST_ASSERT_TRUE(ledAt(led, start + 300));
+    TEST_ASSERT_FALSE(ledAt(led, start + 400));
+    TEST_ASSERT_FALSE(ledAt(led, start + 950));
+    TEST_ASSERT_TRUE(ledAt(led, start + 1050)); // And round again
+    TEST_ASSERT_FALSE(ledAt(led, start + 1150));
+    nativeSetMillis(millis() - start); // Back to about where the clock was
+}
+
+void test_led_catches_up() { // An LED nobody looked at for a while picks the pattern up where it would be by now
+    StatusLed led;
+    led.add(TEST_LED);
+    unsigned long start = 1000000;
+    nativeSetMillis(start);
+    led.flash(TEST_LED, 100, 100);
+    TEST_ASSERT_TRUE(ledAt(led, start + 10 * 200 + 50));
+    TEST_ASSERT_FALSE(ledAt(led, start + 10 * 200 + 150));
+}
+
+// SceneStore
+
+static SceneStore store;
+static uint8_t scene_in[DMXArraySize];
+static uint8_t scene_out[DMXArraySize];
+
+static int sceneSize(const char * name) { // Bytes the scene takes in flash
+    for (int i = 0; i < SCENE_MAX; i++) {
+        if (strcmp(store.name(i), name) == 0)
+            return store.size(i);
+    }
+    return -1;
+}
+
+void test_scene_round_trip() {
+    memset(scene_in, 0, sizeof(scene_in));
+    for (int i = 0; i < 4; i++) scene_in[i] = i + 1; // Run at the start
+    scene_in[100] = 255; // Lone slot
+    scene_in[200] = 1; // Short gaps stay inside the run
+    scene_in[202] = 2;
+    scene_in[205] = 3;
+    scene_in[511] = 9; // Last slot
+    TEST_ASSERT_TRUE(store.save("show", 4, scene_in));
+    TEST_ASSERT_EQUAL_INT(512, store.load("show", 4, scene_out));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(scene_in, scene_out, DMXArraySize);
+    TEST_ASSERT_EQUAL_INT(4 * 4 + 4 + 1 + 6 + 1, sceneSize("show"));
+    TEST_ASSERT_EQUAL_STRING("show", store.last());
+}
+
+void test_scene_used_slots() {
+    memset(scene_in, 0, sizeof(scene_in));
+    scene_in[23] = 10;
+    TEST_ASSERT_TRUE(store.save("short", 5, scene_in));
+    memset(scene_out, 0xff, sizeof(scene_out));
+    TEST_ASSERT_EQUAL_INT(24, store.load("short", 5, scene_out));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(scene_in, scene_out, DMXArraySize); // Everything else comes back 0
+}
+
+void test_scene_empty_and_worst_case() {
+    memset(scene_in, 0, sizeof(scene_in));
+    TEST_ASSERT_TRUE(store.save("dark", 4, scene_in));
+    TEST_ASSERT_TRUE(store.load("dark", 4, scene_out) <= 1);
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(scene_in, scene_out, DMXArraySize);
+
+    for (int i = 0; i < DMXArraySize; i++) scene_in[i] = (i % 5 == 0) ? 0 : i; // No gap long enough to split a run
+    TEST_ASSERT_TRUE(store.save("busy", 4, scene_in));
+    TEST_ASSERT_EQUAL_INT(512, store.load("busy", 4, scene_out));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(scene_in, scene_out, DMXArraySize);
+    TEST_ASSERT_LESS_OR_EQUAL(SCENE_BLOB_SIZE, sceneSize("busy"));
+}
+
+void test_scene_names() {
+    memset(scene_in, 1, sizeof(scene_in));
+    TEST_ASSERT_FALSE(store.save("", 0, scene_in));
+    TEST_ASSERT_FALSE(store.save("no spaces", 9, scene_in));
+    TEST_ASSERT_FALSE(store.save("sixteen_chars_xx", 16, scene_in));
+    TEST_ASSERT_EQUAL_INT(-1, store.load("missing", 7, scene_out));
+    TEST_ASSERT_TRUE(store.save("gone", 4, scene_in));
+    TEST_ASSERT_TRUE(store.remove("gone", 4));
+    TEST_ASSERT_EQUAL_INT(-1, store.load("gone", 4, scene_out));
+}
+
+void test_scene_load_without_remembering() {
+    memset(scene_in, 2, sizeof(scene_in));
+    TEST_ASSERT_TRUE(store.save("stage", 5, scene_in));
+    TEST_ASSERT_TRUE(store.save("standby", 7, scene_in));
+    TEST_ASSERT_EQUAL_INT(512, store.load("stage", 5, scene_out));
+    TEST_ASSERT_EQUAL_STRING("stage", store.last());
+    TEST_ASSERT_EQUAL_INT(512, store.load("standby", 7, scene_out, false));
+    TEST_ASSERT_EQUAL_STRING("stage", store.last());
+}
+
+// ChunkedPrint
+
+class StalledPrint : public Print { // A client that stops taking data after limit bytes, like a write timing out
+    public:
+        size_t limit;
+        size_t taken = 0;
+        int writes = 0;
+        StalledPrint(size_t limit) : limit(limit) {}
+        size_t write(uint8_t c) override {
+            return write(&c, 1);
+        }
+        size_t write(const uint8_t * data, size_t size) override {
+            writes++;
+            size_t n = min(size, limit - taken);
+            taken += n;
+            return n;
+        }
+        using Print::write;
+};
+
+void test_chunked_gives_up_on_stalled_client() { // One write timeout per response, not one per chunk
+    StalledPrint client(HTTP_CHUNK_SIZE + 100);
+    ChunkedPrint page(client, true);
+    for (int i = 0; i < 8 * HTTP_CHUNK_SIZE; i++) {
+        page.write('x');
+    }
+    page.end();
+    int writes = client.writes;
+    TEST_ASSERT_LESS_THAN(12, writes); // Framing of the first chunk, then the second chunk comes up short
+    page.print("more");
+    page.end();
+    TEST_ASSERT_EQUAL_INT(writes, client.writes);
+}
+
+// printStatus
+
+class TextPrint : public Print { // Collects the output as a string, for looking through
+    public:
+        char text[2048];
+        size_t length = 0;
+        size_t write(uint8_t c) override {
+            if (length + 1 < sizeof(text)) {
+                text[length++] = c;
+                text[length] = '\0';
+            }
+            return 1;
+        }
+        using Print::write;
+};
+
+void test_status_scenes_after_remove() { // Deleting a scene leaves a free spot in the middle of the index
+    scenes.begin();
+    for (int i = 0; i < SCENE_MAX; i++) { // Whatever the scene tests left behind
+        const char * name = scenes.name(i);
+        if (name[0] != '\0') {
+            TEST_ASSERT_TRUE(scenes.remove(name, strlen(name)));
+        }
+    }
+    memset(scene_in, 3, sizeof(scene_in));
+    TEST_ASSERT_TRUE(scenes.save("one", 3, scene_in));
+    TEST_ASSERT_TRUE(scenes.save("two", 3, scene_in));
+    TEST_ASSERT_TRUE(scenes.save("three", 5, scene_in));
+    TEST_ASSERT_TRUE(scenes.remove("two", 3));
+    TextPrint out;
+    printStatus(out);
+    TEST_ASSERT_NOT_NULL(strstr(out.text, "\"scenes\":[\"one\",\"three\"]"));
+}
+
+// WebUI
+
+void test_webui_accepts_gzip() {
+    TEST_ASSERT_TRUE(WebUI::acceptsGzip(view("")));
+    TEST_ASSERT_TRUE(WebUI::acceptsGzip(view("gzip, deflate, br")));
+    TEST_ASSERT_TRUE(WebUI::acceptsGzip(view("deflate, gzip;q=1.0")));
+    TEST_ASSERT_TRUE(WebUI::acceptsGzip(view("gzip;q=0.5, identity")));
+    TEST_ASSERT_TRUE(WebUI::acceptsGzip(view("gzip;q=0.001")));
+    TEST_ASSERT_TRUE(WebUI::acceptsGzip(view("*")));
+    TEST_ASSERT_FALSE(WebUI::acceptsGzip(view("identity")));
+    TEST_ASSERT_FALSE(WebUI::acceptsGzip(view("gzip;q=0")));
+    TEST_ASSERT_FALSE(WebUI::acceptsGzip(view("gzip;q=0.")));
+    TEST_ASSERT_FALSE(WebUI::acceptsGzip(view("gzip;q=0.0, deflate")));
+    TEST_ASSERT_FALSE(WebUI::acceptsGzip(view("deflate, gzip; q=0.000")));
+    TEST_ASSERT_FALSE(WebUI::acceptsGzip(view("identity, *;q=0")));
+}
+
+// ArtNetNode, replaying packets at it over loopback
+
+static ArtNetNode node(0, 1, 2); // Port-Address 0:1:2, with two outputs 0:1:2 and 0:1:3
+static WiFiUDP sender;
+static uint8_t packet[ARTNET_HEADER_SIZE + DMXArraySize];
+
+static size_t artDmx(uint8_t sequence, uint16_t portaddress, uint16_t length, uint8_t value) { // Build an ArtDmx in packet, returns its size
+    memcpy(packet, "Art-Net", 8);
+    packet[8] = 0x00; // OpCode 0x5000, low byte first
+    packet[9] = 0x50;
+    packet[10] = 0; // ProtVer 14
+    packet[11] = ARTNET_PROTOCOL_VERSION;
+    packet[12] = sequence;
+    packet[13] = 0; // Physical
+    packet[14] = portaddress & 0xff; // SubUni
+    packet[15] = portaddress >> 8; // Net
+    packet[16] = length >> 8; // Length, high byte first
+    packet[17] = length & 0xff;
+    memset(&packet[ARTNET_HEADER_SIZE], value, length);
+    return ARTNET_HEADER_SIZE + length;
+}
+
+static uint16_t replay(size_t size) { // Send packet to the node and let it receive() it
+    sender.beginPacket(IPAddress(127, 0, 0, 1), ARTNET_PORT);
+    sender.write(packet, size);
+    sender.endPacket();
+    delay(5);
+    return node.receive();
+}
+
+void test_artnet_dmx() {
+    uint8_t data[8] = {};
+    unsigned long packets = node.dmxPackets();
+    TEST_ASSERT_EQUAL_UINT16(4, replay(artDmx(1, 0x012, 4, 7)));
+    TEST_ASSERT_EQUAL_INT(0, node.port());
+    TEST_ASSERT_EQUAL_INT(4, node.readDMX(data, sizeof(data)));
+    TEST_ASSERT_EQUAL_UINT8(7, data[3]);
+    TEST_ASSERT_EQUAL_UINT8(0, data[4]);
+    TEST_ASSERT_EQUAL_UINT16(6, replay(artDmx(1, 0x013, 6, 8))); // Second output
+    TEST_ASSERT_EQUAL_INT(1, node.port());
+    TEST_ASSERT_EQUAL_INT(6, node.readDMX(data, sizeof(data)));
+    TEST_ASSERT_EQUAL_UINT8(8, data[5]);
+    TEST_ASSERT_EQUAL_UINT32(packets + 2, node.dmxPackets());
+}
+
+void test_artnet_truncated() {
+    size_t size = artDmx(2, 0x012, 4, 7);
+    TEST_ASSERT_EQUAL_UINT16(0, replay(ARTNET_HEADER_SIZE - 1)); // Cut off in the header
+    TEST_ASSERT_EQUAL_UINT16(2, replay(size - 2)); // Fewer slots than Length says, only the ones that are there
+}
+
+void test_artnet_opcode_byte_order() {
+    artDmx(3, 0x012, 4, 7);
+    packet[8] = 0x50; // 0x5000 sent big endian, which is OpCode 0x0050
+    packet[9] = 0x00;
+    TEST_ASSERT_EQUAL_UINT16(0, replay(ARTNET_HEADER_SIZE + 4));
+    ArtNetNode::header_t header;
+    TEST_ASSERT_FALSE(ArtNetNode::decodeHeader(packet, ARTNET_HEADER_SIZE + 4, header));
+}
+
+void test_artnet_port_address() {
+    TEST_ASSERT_EQUAL_UINT16(0, replay(artDmx(4, 0x011, 4, 7))); // Just below our first
+    TEST_ASSERT_EQUAL_UINT16(0, replay(artDmx(4, 0x014, 4, 7))); // Just past our last
+    TEST_ASSERT_EQUAL_UINT16(0, replay(artDmx(4, 0x112, 4, 7))); // Same subnet and universe, other net
+    TEST_ASSERT_EQUAL_UINT16(4, replay(artDmx(4, 0x012, 4, 7)));
+}
+
+void test_artnet_late_sequence() {
+    TEST_ASSERT_EQUAL_UINT16(4, replay(artDmx(10, 0x012, 4, 7)));
+    TEST_ASSERT_EQUAL_UINT16(0, replay(artDmx(9, 0x012, 4, 7))); // Overtaken by 10
+    TEST_ASSERT_EQUAL_UINT16(0, replay(artDmx(10, 0x012, 4, 7))); // Twice
+    TEST_ASSERT_EQUAL_UINT16(4, replay(artDmx(9, 0x013, 4, 7))); // The other output counts on its own
+    TEST_ASSERT_EQUAL_UINT16(4, replay(artDmx(11, 0x012, 4, 7)));
+    TEST_ASSERT_EQUAL_UINT16(4, replay(artDmx(200, 0x012, 4, 7))); // Too far behind to be late, the sender restarted
+    TEST_ASSERT_EQUAL_UINT16(4, replay(artDmx(0, 0x012, 4, 7))); // 0 is no sequencing at all
+    TEST_ASSERT_EQUAL_UINT16(4, replay(artDmx(0, 0x012, 4, 7)));
+}
+
+int main(int argc, char ** argv) {
+    universes[0].begin();
+    frame.begin();
+    store.begin();
+    node.setPorts(2);
+    node.begin("test", "test");
+    sender.begin(0); // Any free port
+
+    UNITY_BEGIN();
+    RUN_TEST(test_strview_compare);
+    RUN_TEST(test_strview_toint_is_strict);
+    RUN_TEST(test_strview_pairs);
+    RUN_TEST(test_parser_get);
+    RUN_TEST(test_parser_byte_at_a_time);
+    RUN_TEST(test_parser_stops_at_request_end);
+    RUN_TEST(test_parser_body);
+    RUN_TEST(test_parser_rejects);
+    RUN_TEST(test_dmx_set);
+    RUN_TEST(test_dmx_set_ignores_bad_pairs);
+    RUN_TEST(test_dmx_fade);
+    RUN_TEST(test_dmx_set_stops_fade);
+    RUN_TEST(test_dmx_set_to_fade_target);
+    RUN_TEST(test_dmx_fade_then_set);
+    RUN_TEST(test_dmx_set_then_fade);
+    RUN_TEST(test_websocket_stops_fade);
+    RUN_TEST(test_patch_coarse_fine);
+    RUN_TEST(test_patch_overlap_rejected);
+    RUN_TEST(test_patch_one_to_many);
+    RUN_TEST(test_patch_fade);
+    RUN_TEST(test_patch_table_handoff);
+    RUN_TEST(test_curve_points);
+    RUN_TEST(test_frame_publish_and_acquire);
+    RUN_TEST(test_frame_keeps_earlier_changes);
+    RUN_TEST(test_frame_changes_add_up);
+    RUN_TEST(test_frame_versions);
+    RUN_TEST(test_frame_same_values_not_published);
+    RUN_TEST(test_frame_never_torn);
+    RUN_TEST(test_clock_rate_kept);
+    RUN_TEST(test_clock_follows_frame_length);
+    RUN_TEST(test_led_static);
+    RUN_TEST(test_led_pattern_across_millis_wrap);
+    RUN_TEST(test_led_catches_up);
+    RUN_TEST(test_scene_round_trip);
+    RUN_TEST(test_scene_used_slots);
+    RUN_TEST(test_scene_empty_and_worst_case);
+    RUN_TEST(test_scene_names);
+    RUN_TEST(test_scene_load_without_remembering);
+    RUN_TEST(test_chunked_gives_up_on_stalled_client);
+    RUN_TEST(test_status_scenes_after_remove);
+    RUN_TEST(test_webui_accepts_gzip);
+    RUN_TEST(test_artnet_dmx);
+    RUN_TEST(test_artnet_truncated);
+    RUN_TEST(test_artnet_opcode_byte_order);
+    RUN_TEST(test_artnet_port_address);
+    RUN_TEST(test_artnet_late_sequence);
+    return UNITY_END();
+}
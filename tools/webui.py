@@ -0,0 +1,101 @@
+# Builds the web UI in web/ into include/webui_assets.h: every file gzipped (deterministically, so the
+# same sources give the same bytes and ETags) and turned into a constexpr byte array that stays in flash.
+# index.html refers to the other files with ?v=<hash>, so those can be cached forever by the browser.
+#
+# Runs before every build as a PlatformIO extra script (see platformio.ini), only regenerating when
+# something in web/ is newer than the header or files were added, deleted or renamed. Can be run by hand as well: python3 tools/webui.py
+
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    ROOT = env["PROJECT_DIR"]  # noqa: F821
+except NameError:
+    ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+WEB = os.path.join(ROOT, "web")
+OUTPUT = os.path.join(ROOT, "include", "webui_assets.h")
+INDEX = "index.html"
+FILES = "// Files: "  # Header line listing what went in, so a deleted or renamed file is noticed
+TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".js": "text/javascript; charset=utf-8",
+    ".css": "text/css; charset=utf-8",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".ico": "image/x-icon",
+}
+
+
+def built_from():
+    with open(OUTPUT) as f:
+        for line in f:
+            if line.startswith(FILES):
+                return line[len(FILES):].strip().split(" ")
+    return None
+
+
+def up_to_date(names):
+    if not os.path.exists(OUTPUT) or built_from() != names:
+        return False
+    built = os.path.getmtime(OUTPUT)
+    return all(os.path.getmtime(os.path.join(WEB, n)) <= built for n in names) and os.path.getmtime(__file__) <= built
+
+
+def array(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def build():
+    names = sorted(n for n in os.listdir(WEB) if os.path.splitext(n)[1] in TYPES)
+    if INDEX not in names:
+        raise SystemExit("webui: no %s in %s" % (INDEX, WEB))
+    if up_to_date(names):
+        return
+    sources = {}
+    for n in names:
+        with open(os.path.join(WEB, n), "rb") as f:
+            sources[n] = f.read()
+    hashes = {n: hashlib.sha256(d).hexdigest()[:12] for n, d in sources.items()}
+    index = sources[INDEX].decode("utf-8")
+    for n in names:  # Versioned references, a new build gets a new URL rather than a stale cached copy
+        if n != INDEX:
+            index = index.replace('"%s"' % n, '"%s?v=%s"' % (n, hashes[n]))
+    sources[INDEX] = index.encode("utf-8")
+    hashes[INDEX] = hashlib.sha256(sources[INDEX]).hexdigest()[:12]
+
+    out = [
+        "// Generated by tools/webui.py from web/ - do not edit, and don't commit it either",
+        FILES + " ".join(names),
+        "#ifndef _WEBUI_ASSETS_H_",
+        "#define _WEBUI_ASSETS_H_",
+        '#include "webui.h"',
+        "",
+    ]
+    table = []
+    for i, n in enumerate(names):
+        data = gzip.compress(sources[n], 9, mtime=0)
+        out.append("// %s: %d bytes, %d gzipped" % (n, len(sources[n]), len(data)))
+        out.append("static constexpr uint8_t WEBUI_ASSET_%d[] = {" % i)
+        out.append(array(data))
+        out.append("};")
+        table.append('    {"%s", "%s", WEBUI_ASSET_%d, sizeof(WEBUI_ASSET_%d), "\\"%s\\"", %s},'
+                     % (n, TYPES[os.path.splitext(n)[1]], i, i, hashes[n], "false" if n == INDEX else "true"))
+    out.append("")
+    out.append("#define WEBUI_ASSET_COUNT %d" % len(names))
+    out.append("static constexpr WebUI::asset_t WEBUI_ASSETS[WEBUI_ASSET_COUNT] = {")
+    out.extend(table)
+    out.append("};")
+    out.append("#endif")
+    out.append("")
+    with open(OUTPUT, "w") as f:
+        f.write("\n".join(out))
+    print("webui: %d files from web/ into %s" % (len(names), os.path.relpath(OUTPUT, ROOT)))
+
+
+build()
@@ -0,0 +1,136 @@
+// DMX Remote control UI. Everything goes through the bridge's own API:
+//   /api/status for the status line, universes and scenes
+//   /api/dmx?since=version polled for the channel values - only the changes come back, and nothing at all (304) while nothing changes
+//   POST /DMX to set a channel, /SCENE to save and recall scenes
+'use strict';
+
+const PAGE = 16; // Faders shown at once
+const POLL = 500; // ms between polls of the channel values
+const STATUS = 2000; // ms between polls of the status
+const SEND = 50; // ms fader moves are collected for before they're sent
+
+const $ = id => document.getElementById(id);
+let universe = 1;
+let first = 0; // Address (0 based) of the first fader shown
+let version = -1; // Of the values we have, -1 for none yet
+const values = new Uint8Array(512);
+const pending = new Map(); // Address -> value, waiting to be sent
+let sendTimer = null;
+
+function build() { // Faders for the current page
+  const faders = $('faders');
+  faders.textContent = '';
+  for (let a = first; a < first + PAGE; a++) {
+    const row = document.createElement('label');
+    row.className = 'fader';
+    const name = document.createElement('span');
+    name.textContent = a + 1;
+    const input = document.createElement('input');
+    input.type = 'range';
+    input.min = 0;
+    input.max = 255;
+    input.value = values[a];
+    input.id = 'ch' + a;
+    const out = document.createElement('output');
+    out.value = values[a];
+    input.oninput = () => {
+      out.value = input.value;
+      values[a] = +input.value;
+      pending.set(a, values[a]);
+      if (!sendTimer) sendTimer = setTimeout(send, SEND);
+    };
+    row.append(name, input, out);
+    faders.append(row);
+  }
+  $('range').textContent = (first + 1) + '-' + (first + PAGE);
+}
+
+function show(a) { // A value came in from the bridge, unless the fader is being dragged
+  const input = $('ch' + a);
+  if (input && document.activeElement !== input && !pending.has(a)) {
+    input.value = values[a];
+    input.nextSibling.value = values[a];
+  }
+}
+
+async function send() {
+  sendTimer = null;
+  const changes = [...pending];
+  pending.clear();
+  for (const [a, v] of changes) {
+    await fetch('/DMX?universe=' + universe + '&start=' + a, {method: 'POST', body: new Uint8Array([v])});
+  }
+}
+
+async function poll() {
+  try {
+    const r = await fetch('/api/dmx?universe=' + universe + (version >= 0 ? '&since=' + version : ''));
+    const state = await r.json();
+    if (state.universe === universe) {
+      if (state.full) {
+        values.fill(0);
+        state.values.forEach((v, a) => values[a] = v);
+        for (let a = first; a < first + PAGE; a++) show(a);
+      } else {
+        for (const [a, v] of state.changes) {
+          values[a] = v;
+          show(a);
+        }
+      }
+      version = state.version;
+    }
+  } catch (e) {
+    version = -1; // Start over once the bridge is back
+  }
+  setTimeout(poll, POLL);
+}
+
+async function status(again = true) { // again keeps the poll going, a one-off refresh leaves that to the poll already running
+  try {
+    const s = await (await fetch('/api/status')).json();
+    $('status').textContent = s.fps[universe - 1] + ' frames/s, ' + s.slots[universe - 1] + ' slots. VBat ' + (s.vbat / 1000).toFixed(2) + ' V, VExt ' + (s.vext / 1000).toFixed(2) + ' V';
+    const select = $('universe');
+    if (select.options.length !== s.universes) {
+      select.textContent = '';
+      for (let u = 1; u <= s.universes; u++) select.add(new Option('Universe ' + u, u));
+      select.value = universe;
+    }
+    select.hidden = s.universes < 2;
+    const scenes = $('scenes');
+    scenes.textContent = '';
+    for (const name of s.scenes) {
+      const b = document.createElement('button');
+      b.textContent = name;
+      b.className = name === s.last_scene ? 'last' : '';
+      b.onclick = () => fetch('/SCENE?recall=' + name + ($('fade').checked ? '&time=3000' : '')).then(() => status(false));
+      scenes.append(b);
+    }
+  } catch (e) {
+    $('status').textContent = 'Bridge not reachable';
+  }
+  if (again) setTimeout(status, STATUS);
+}
+
+$('universe').onchange = e => {
+  universe = +e.target.value;
+  version = -1;
+  values.fill(0);
+  build();
+};
+$('prev').onclick = () => {
+  first = Math.max(0, first - PAGE);
+  build();
+};
+$('next').onclick = () => {
+  first = Math.min(512 - PAGE, first + PAGE);
+  build();
+};
+$('save').onsubmit = e => {
+  e.preventDefault();
+  fetch('/SCENE?save=' + $('name').value);
+  $('name').value = '';
+};
+
+build();
+poll();
+status();